@@ -7,8 +7,16 @@ enum Column
     MD5,
     SHA1,
     SHA256,
+    TREEHASH,
+    SAMPLED,
+    SSDEEP,
+    SIMILAR,
+    DIRHASH,
     YARA,
+    KNOWN,
+    VERIFY,
     FILESIZE,
+    ENTROPY,
     FILE_EXTENSION,
     MIMETYPE,
     FILETYPE,
@@ -1,4 +1,4 @@
-QT       += core gui concurrent svg svgwidgets
+QT       += core gui concurrent network svg svgwidgets
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
 CONFIG += c++17
@@ -9,25 +9,63 @@ win32:RC_FILE = HashLookup.rc # embedding own manifest file
 DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000
 
 SOURCES += \
+    archivereader.cpp \
+    columnsorter.cpp \
+    commandline.cpp \
     customdelegate.cpp \
     customsortfilterproxymodel.cpp \
     customtableview.cpp \
+    daemon.cpp \
+    digest.cpp \
+    digestitem.cpp \
+    dirhasher.cpp \
+    dirwatcher.cpp \
     fileprocessor.cpp \
+    hashdatabase.cpp \
     headersortingadapter.cpp \
     itemprocessor.cpp \
+    knownhashloader.cpp \
     main.cpp \
+    manifest.cpp \
+    pathitem.cpp \
+    pathtable.cpp \
+    searchindex.cpp \
+    similarityindex.cpp \
+    tableexporter.cpp \
+    tablesnapshot.cpp \
+    tarwriter.cpp \
+    treehasher.cpp \
     widget.cpp \
     yaraprocessor.cpp \
     zipper.cpp
 
 HEADERS += \
     Column.h \
+    archivereader.h \
+    columnsorter.h \
+    commandline.h \
     customdelegate.h \
     customsortfilterproxymodel.h \
     customtableview.h \
+    daemon.h \
+    digest.h \
+    digestitem.h \
+    dirhasher.h \
+    dirwatcher.h \
     fileprocessor.h \
+    hashdatabase.h \
     headersortingadapter.h \
     itemprocessor.h \
+    knownhashloader.h \
+    manifest.h \
+    pathitem.h \
+    pathtable.h \
+    searchindex.h \
+    similarityindex.h \
+    tableexporter.h \
+    tablesnapshot.h \
+    tarwriter.h \
+    treehasher.h \
     widget.h \
     yaraprocessor.h \
     zipper.h
@@ -40,11 +78,11 @@ INCLUDEPATH += $$PWD/include/yara
 INCLUDEPATH += $$PWD/include/zlib
 
 #CONFIG (debug) {
-#    LIBS += -L$$PWD/lib/debug -lmagic -llibyara -lAdvapi32 -llibcrypto -lquazip1-qt6d
+#    LIBS += -L$$PWD/lib/debug -lmagic -llibyara -lAdvapi32 -llibcrypto -lquazip1-qt6d -lzlibd -lzstd -lfuzzy
 #}
 
 CONFIG (release) {
-    LIBS += -L$$PWD/lib/release -lmagic -llibyara -lAdvapi32 -llibcrypto -lquazip1-qt6
+    LIBS += -L$$PWD/lib/release -lmagic -llibyara -lAdvapi32 -llibcrypto -lquazip1-qt6 -lzlib -lzstd -lfuzzy
 }
 
 RESOURCES += \
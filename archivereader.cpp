@@ -0,0 +1,435 @@
+#include "archivereader.h"
+
+#include <quazip/quazip.h>
+#include <quazip/quazipfile.h>
+
+#include <QBuffer>
+#include <QFileInfo>
+
+#include <zlib.h>
+#include <cstring>
+
+
+static const qint64 CHUNK_SIZE = 1024 * 1024;
+static const qint64 TAR_RECORD_SIZE = 512;
+static const qint64 MAX_TAR_HEADER_SIZE = 1024 * 1024;    // pax and GNU long name headers
+
+
+// octal with optional spaces, or base-256 with the high bit set for sizes over 8 GB
+static qint64 tarNumber(const char *field, int width)
+{
+    qint64 value = 0;
+
+    if(uchar(field[0]) & 0x80)
+    {
+        value = uchar(field[0]) & 0x7f;
+        for(int i = 1; i < width; ++i)
+            value = (value << 8) | uchar(field[i]);
+        return value;
+    }
+
+    for(int i = 0; i < width && field[i] != '\0'; ++i)
+    {
+        if(field[i] == ' ')
+            continue;
+        if(field[i] < '0' || field[i] > '7')
+            break;
+        value = value * 8 + (field[i] - '0');
+    }
+
+    return value;
+}
+
+
+static bool tarChecksumValid(const char *header)
+{
+    qint64 sum = 0;
+    for(int i = 0; i < TAR_RECORD_SIZE; ++i)
+        sum += (i >= 148 && i < 156) ? ' ' : uchar(header[i]);
+
+    return sum == tarNumber(header + 148, 8);
+}
+
+
+ArchiveReader::Format ArchiveReader::format(QIODevice &device)
+{
+    const QByteArray header = device.peek(TAR_RECORD_SIZE);
+
+    if(header.startsWith("PK\x03\x04") || header.startsWith("PK\x05\x06"))
+        return Zip;
+
+    if(header.startsWith("\x1f\x8b"))
+        return Gzip;
+
+    if(header.size() == TAR_RECORD_SIZE && std::memcmp(header.constData() + 257, "ustar", 5) == 0 && tarChecksumValid(header.constData()))
+        return Tar;
+
+    return None;
+}
+
+
+void ArchiveReader::readMembers(QIODevice &device, const QString &archive_path, int depth, qint64 max_member_size, const Visitor &visit)
+{
+    if(depth < 1)
+        return;
+
+    switch(format(device))
+    {
+    case Zip:
+        readZip(device, archive_path, depth, max_member_size, visit);
+        break;
+    case Tar:
+        readTar(device, archive_path, depth, max_member_size, visit);
+        break;
+    case Gzip:
+        readGzip(device, archive_path, depth, max_member_size, visit);
+        break;
+    case None:
+        break;
+    }
+}
+
+
+void ArchiveReader::readZip(QIODevice &device, const QString &archive_path, int depth, qint64 max_member_size, const Visitor &visit)
+{
+    QuaZip zip(&device);
+    if(!zip.open(QuaZip::mdUnzip))
+    {
+        qWarning("ArchiveReader: zip.open(): %d in %s", zip.getZipError(), qPrintable(archive_path));
+        return;
+    }
+
+    for(bool more = zip.goToFirstFile(); more; more = zip.goToNextFile())
+    {
+        QuaZipFileInfo64 info;
+        if(!zip.getCurrentFileInfo(&info) || info.name.endsWith('/'))
+            continue;
+
+        const QString member_path = archive_path + "!/" + info.name;
+
+        if(info.uncompressedSize > quint64(max_member_size))
+        {
+            qWarning("ArchiveReader: skipping %s, larger than the member limit", qPrintable(member_path));
+            continue;
+        }
+
+        // encrypted members and unsupported methods fail here
+        QuaZipFile file(&zip);
+        if(!file.open(QIODevice::ReadOnly))
+        {
+            qWarning("ArchiveReader: can't open %s: %d", qPrintable(member_path), file.getZipError());
+            continue;
+        }
+
+        const QByteArray data = file.readAll();
+        file.close();
+
+        // the crc is checked when the member is closed
+        if(file.getZipError() != UNZ_OK)
+        {
+            qWarning("ArchiveReader: %s is damaged: %d", qPrintable(member_path), file.getZipError());
+            continue;
+        }
+
+        visitMember(member_path, data, depth, max_member_size, visit);
+    }
+
+    zip.close();
+}
+
+
+void ArchiveReader::readTar(QIODevice &device, const QString &archive_path, int depth, qint64 max_member_size, const Visitor &visit)
+{
+    char header[TAR_RECORD_SIZE];
+
+    // set by a pax or GNU long name header for the entry that follows it
+    QString long_name;
+    qint64 pax_size = -1;
+
+    while(device.read(header, TAR_RECORD_SIZE) == TAR_RECORD_SIZE)
+    {
+        // the archive ends with empty records
+        if(header[0] == '\0')
+            break;
+
+        if(!tarChecksumValid(header))
+        {
+            qWarning("ArchiveReader: broken tar header in %s", qPrintable(archive_path));
+            break;
+        }
+
+        qint64 size = tarNumber(header + 124, 12);
+        const qint64 padding = (TAR_RECORD_SIZE - size % TAR_RECORD_SIZE) % TAR_RECORD_SIZE;
+        const char type = header[156];
+
+        if(type == 'x' || type == 'g' || type == 'L')
+        {
+            if(size > MAX_TAR_HEADER_SIZE)
+                break;
+
+            const QByteArray extension = device.read(size);
+            device.skip(padding);
+
+            if(type == 'L')
+            {
+                long_name = QString::fromUtf8(extension.constData(), qstrnlen(extension.constData(), size_t(extension.size())));
+            }
+            else if(type == 'x')
+            {
+                // "<length> <key>=<value>\n" records
+                qsizetype pos = 0;
+                while(pos < extension.size())
+                {
+                    const qsizetype space = extension.indexOf(' ', pos);
+                    const qsizetype length = space > pos ? extension.mid(pos, space - pos).toLongLong() : 0;
+                    if(length <= 0 || pos + length > extension.size())
+                        break;
+
+                    const QByteArray record = extension.mid(space + 1, pos + length - space - 2);
+                    const qsizetype equals = record.indexOf('=');
+                    if(equals > 0)
+                    {
+                        const QByteArray key = record.left(equals);
+                        if(key == "path")
+                            long_name = QString::fromUtf8(record.mid(equals + 1));
+                        else if(key == "size")
+                            pax_size = record.mid(equals + 1).toLongLong();
+                    }
+
+                    pos += length;
+                }
+            }
+            continue;
+        }
+
+        QString name = long_name;
+        if(name.isEmpty())
+        {
+            name = QString::fromUtf8(header, qstrnlen(header, 100));
+
+            const qsizetype prefix_length = qstrnlen(header + 345, 155);
+            if(std::memcmp(header + 257, "ustar", 5) == 0 && prefix_length > 0)
+                name = QString::fromUtf8(header + 345, prefix_length) + '/' + name;
+        }
+
+        if(pax_size >= 0)
+            size = pax_size;
+
+        long_name.clear();
+        pax_size = -1;
+
+        const qint64 data_padding = (TAR_RECORD_SIZE - size % TAR_RECORD_SIZE) % TAR_RECORD_SIZE;
+
+        // regular files only, directories, links and devices carry no data of their own
+        if(type != '0' && type != '\0' && type != '7')
+        {
+            device.skip(size + data_padding);
+            continue;
+        }
+
+        if(name.startsWith("./"))
+            name.remove(0, 2);
+
+        const QString member_path = archive_path + "!/" + name;
+
+        if(size > max_member_size)
+        {
+            qWarning("ArchiveReader: skipping %s, larger than the member limit", qPrintable(member_path));
+            device.skip(size + data_padding);
+            continue;
+        }
+
+        const QByteArray data = device.read(size);
+        if(data.size() != size)
+        {
+            qWarning("ArchiveReader: %s is truncated", qPrintable(member_path));
+            break;
+        }
+        device.skip(data_padding);
+
+        visitMember(member_path, data, depth, max_member_size, visit);
+    }
+}
+
+
+// inflates a gzip stream while it is read, so a .tar.gz is walked without holding more than
+// the member at hand. Concatenated gzip members continue the same data
+class GzipDevice : public QIODevice
+{
+public:
+    explicit GzipDevice(QIODevice &source)
+        : source(source),
+          input(CHUNK_SIZE, Qt::Uninitialized)
+    {
+        initialized = inflateInit2(&stream, 16 + MAX_WBITS) == Z_OK;
+    }
+
+    ~GzipDevice() override
+    {
+        if(initialized)
+            inflateEnd(&stream);
+    }
+
+    bool isSequential() const override
+    {
+        return true;
+    }
+
+    // the stream ended early or is corrupt, known once everything was read
+    bool damaged() const
+    {
+        return finished && (error != Z_OK || !member_complete);
+    }
+
+    int zlibError() const
+    {
+        return error;
+    }
+
+protected:
+    qint64 readData(char *data, qint64 max_size) override
+    {
+        if(!initialized)
+            return -1;
+
+        qint64 total = 0;
+
+        while(total < max_size && !finished)
+        {
+            // a full output buffer means inflate may still have output without new input
+            if(stream.avail_in == 0 && !output_full)
+            {
+                const qint64 bytes_read = source.read(input.data(), CHUNK_SIZE);
+                if(bytes_read <= 0)
+                {
+                    finished = true;
+                    break;
+                }
+
+                stream.next_in = reinterpret_cast<Bytef *>(input.data());
+                stream.avail_in = uInt(bytes_read);
+            }
+
+            const uInt out_size = uInt(qMin(max_size - total, CHUNK_SIZE));
+            stream.next_out = reinterpret_cast<Bytef *>(data + total);
+            stream.avail_out = out_size;
+
+            const int result = inflate(&stream, Z_NO_FLUSH);
+            total += out_size - stream.avail_out;
+            output_full = stream.avail_out == 0;
+
+            if(result == Z_BUF_ERROR)
+                continue;
+
+            // trailing garbage after a complete stream is ignored, like gzip -d does
+            if(result != Z_OK && result != Z_STREAM_END)
+            {
+                if(!member_complete)
+                    error = result;
+                finished = true;
+                break;
+            }
+
+            member_complete = result == Z_STREAM_END;
+            if(member_complete)
+                inflateReset(&stream);
+        }
+
+        return (total > 0 || !finished) ? total : -1;
+    }
+
+    // skipped tar members are inflated in large steps instead of the small default buffer
+    qint64 skipData(qint64 max_size) override
+    {
+        QByteArray scratch(qMin(max_size, CHUNK_SIZE), Qt::Uninitialized);
+
+        qint64 skipped = 0;
+        while(skipped < max_size)
+        {
+            const qint64 bytes_read = readData(scratch.data(), qMin(max_size - skipped, CHUNK_SIZE));
+            if(bytes_read <= 0)
+                break;
+            skipped += bytes_read;
+        }
+
+        return skipped;
+    }
+
+    qint64 writeData(const char *, qint64) override
+    {
+        return -1;
+    }
+
+private:
+    QIODevice &source;
+    QByteArray input;
+    z_stream stream = {};
+    bool initialized = false;
+    bool finished = false;
+    bool output_full = false;
+    bool member_complete = false;
+    int error = Z_OK;
+};
+
+
+// a gzip stream holds one file, .tar.gz and .tgz are read as the tar inside. The member limit
+// applies to every tar member on its own, the decompressed tar as a whole is never buffered
+void ArchiveReader::readGzip(QIODevice &device, const QString &archive_path, int depth, qint64 max_member_size, const Visitor &visit)
+{
+    GzipDevice gzip(device);
+    if(!gzip.open(QIODevice::ReadOnly))
+        return;
+
+    if(format(gzip) == Tar)
+    {
+        readTar(gzip, archive_path, depth, max_member_size, visit);
+
+        if(gzip.damaged())
+            qWarning("ArchiveReader: %s is damaged or truncated: %d", qPrintable(archive_path), gzip.zlibError());
+        return;
+    }
+
+    QByteArray data;
+    forever
+    {
+        const QByteArray chunk = gzip.read(CHUNK_SIZE);
+        if(chunk.isEmpty())
+            break;
+
+        data.append(chunk);
+
+        if(data.size() > max_member_size)
+        {
+            qWarning("ArchiveReader: skipping %s, larger than the member limit", qPrintable(archive_path));
+            return;
+        }
+    }
+
+    if(gzip.damaged())
+    {
+        qWarning("ArchiveReader: %s is damaged or truncated: %d", qPrintable(archive_path), gzip.zlibError());
+        return;
+    }
+
+    QString name = QFileInfo(archive_path).fileName();
+    if(name.endsWith(".tgz", Qt::CaseInsensitive))
+        name = name.chopped(4) + ".tar";
+    else if(name.endsWith(".gz", Qt::CaseInsensitive))
+        name.chop(3);
+
+    visitMember(archive_path + "!/" + name, data, depth, max_member_size, visit);
+}
+
+
+void ArchiveReader::visitMember(const QString &member_path, const QByteArray &data, int depth, qint64 max_member_size, const Visitor &visit)
+{
+    visit(member_path, data);
+
+    if(depth <= 1)
+        return;
+
+    QBuffer buffer;
+    buffer.setData(data);
+    if(buffer.open(QIODevice::ReadOnly))
+        readMembers(buffer, member_path, depth - 1, max_member_size, visit);
+}
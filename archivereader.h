@@ -0,0 +1,34 @@
+#ifndef ARCHIVEREADER_H
+#define ARCHIVEREADER_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QString>
+
+#include <functional>
+
+// Walks the members of zip, tar and gzip (including .tar.gz) archives in memory. Members get
+// virtual paths like "outer.zip!/inner/file.exe", archives found among the members are
+// entered again until the nesting depth is used up. Nothing is written to disk, gzip is
+// inflated while it is read, so a .tar.gz only holds one member at a time.
+class ArchiveReader
+{
+public:
+    enum Format { None, Zip, Tar, Gzip };
+
+    typedef std::function<void(const QString &member_path, const QByteArray &data)> Visitor;
+
+    static Format format(QIODevice &device);
+
+    // depth 1 lists the members of the archive itself, members larger than max_member_size are skipped
+    static void readMembers(QIODevice &device, const QString &archive_path, int depth, qint64 max_member_size, const Visitor &visit);
+
+private:
+    static void readZip(QIODevice &device, const QString &archive_path, int depth, qint64 max_member_size, const Visitor &visit);
+    static void readTar(QIODevice &device, const QString &archive_path, int depth, qint64 max_member_size, const Visitor &visit);
+    static void readGzip(QIODevice &device, const QString &archive_path, int depth, qint64 max_member_size, const Visitor &visit);
+
+    static void visitMember(const QString &member_path, const QByteArray &data, int depth, qint64 max_member_size, const Visitor &visit);
+};
+
+#endif // ARCHIVEREADER_H
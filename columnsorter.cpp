@@ -0,0 +1,216 @@
+#include "columnsorter.h"
+#include "tablesnapshot.h"
+
+#include <QCollator>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <numeric>
+
+
+QList<int> ColumnSorter::ranks(const TableSnapshot &snapshot, int column, const Options &options, QPromise<QList<int>> &promise)
+{
+    const int row_count = snapshot.rowCount();
+    if(row_count == 0)
+        return QList<int>();
+
+    auto compare_texts = [&](const quint32 &left, const quint32 &right)
+    {
+        return QString::compare(snapshot.text(int(left), column), snapshot.text(int(right), column), options.sensitivity) < 0;
+    };
+
+    std::vector<Entry> entries(row_count);
+
+    if(options.locale_aware && !(options.numeric && snapshot.hasNumbers(column)))
+    {
+        QCollator collator;
+        collator.setCaseSensitivity(options.sensitivity);
+
+        QList<QCollatorSortKey> sort_keys;
+        sort_keys.reserve(row_count);
+        for(int row = 0; row < row_count; ++row)
+            sort_keys.append(collator.sortKey(snapshot.text(row, column)));
+
+        for(int row = 0; row < row_count; ++row)
+            entries[row] = {0, quint32(row)};
+
+        auto compare_keys = [&](const Entry &left, const Entry &right)
+        {
+            return sort_keys.at(left.row).compare(sort_keys.at(right.row)) < 0;
+        };
+
+        // parallel merge sort: sorted chunks, merged pairwise
+        const int chunk_count = qMax(1, qMin(QThread::idealThreadCount(), row_count / 65536 + 1));
+        const int chunk_size = (row_count + chunk_count - 1) / qMax(1, chunk_count);
+
+        QList<int> chunk_starts;
+        for(int start = 0; start < row_count; start += chunk_size)
+            chunk_starts.append(start);
+
+        QtConcurrent::blockingMap(chunk_starts, [&](const int &start)
+        {
+            std::stable_sort(entries.begin() + start, entries.begin() + qMin(start + chunk_size, row_count), compare_keys);
+        });
+
+        for(int width = chunk_size; width < row_count; width *= 2)
+        {
+            if(promise.isCanceled())
+                return QList<int>();
+
+            for(int start = 0; start + width < row_count; start += 2 * width)
+                std::inplace_merge(entries.begin() + start, entries.begin() + start + width, entries.begin() + qMin(start + 2 * width, row_count), compare_keys);
+        }
+    }
+    else
+    {
+        const bool numeric = options.numeric && snapshot.hasNumbers(column);
+
+        auto character = [&](const QString &text, const int &i) -> quint64
+        {
+            if(i >= text.size())
+                return 0;
+            return (options.sensitivity == Qt::CaseInsensitive) ? text.at(i).toCaseFolded().unicode() : text.at(i).unicode();
+        };
+
+        // texts get 8 bits per character if the whole column allows it, else 16 bits
+        int characters = 8;
+        for(int row = 0; !numeric && row < row_count && characters == 8; ++row)
+        {
+            const QString &text = snapshot.text(row, column);
+            for(int i = 0; i < 8; ++i)
+            {
+                if(character(text, i) > 0xff)
+                {
+                    characters = 4;
+                    break;
+                }
+            }
+        }
+
+        for(int row = 0; row < row_count; ++row)
+        {
+            quint64 key = 0;
+            double value;
+
+            if(numeric)
+                key = snapshot.number(row, column, value) ? numberKey(value) : 0; // cells without a number go first
+            else
+            {
+                const QString &text = snapshot.text(row, column);
+                for(int i = 0; i < characters; ++i)
+                    key = (key << (64 / characters)) | character(text, i);
+            }
+
+            entries[row] = {key, quint32(row)};
+        }
+
+        radixSort(entries, promise);
+        if(promise.isCanceled())
+            return QList<int>();
+
+        // equal keys only share a prefix (or have no number), their order comes from the full texts
+        size_t start = 0;
+        while(start < entries.size())
+        {
+            size_t end = start + 1;
+            while(end < entries.size() && entries[end].key == entries[start].key)
+                ++end;
+
+            if(end - start > 1 && (!numeric || entries[start].key == 0))
+            {
+                std::stable_sort(entries.begin() + start, entries.begin() + end, [&](const Entry &left, const Entry &right)
+                {
+                    return compare_texts(left.row, right.row);
+                });
+            }
+
+            start = end;
+        }
+    }
+
+    if(promise.isCanceled())
+        return QList<int>();
+
+    QList<int> row_ranks(row_count);
+    for(int position = 0; position < row_count; ++position)
+        row_ranks[entries[position].row] = position;
+
+    return row_ranks;
+}
+
+
+// doubles as unsigned integers in the same order, never 0 for a real number
+quint64 ColumnSorter::numberKey(double value)
+{
+    quint64 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    return (bits & 0x8000000000000000ULL) ? ~bits : (bits | 0x8000000000000000ULL);
+}
+
+
+// stable LSD radix sort over 8 bit digits, chunks count and scatter in parallel
+void ColumnSorter::radixSort(std::vector<Entry> &entries, QPromise<QList<int>> &promise)
+{
+    const size_t size = entries.size();
+    if(size < 2)
+        return;
+
+    const int chunk_count = qMax(1, qMin(QThread::idealThreadCount(), int(size / 65536) + 1));
+    const size_t chunk_size = (size + chunk_count - 1) / chunk_count;
+
+    QList<int> chunks(chunk_count);
+    std::iota(chunks.begin(), chunks.end(), 0);
+
+    std::vector<std::array<size_t, 256>> counts(chunk_count);
+    std::vector<Entry> buffer(size);
+
+    for(int shift = 0; shift < 64; shift += 8)
+    {
+        if(promise.isCanceled())
+            return;
+
+        QtConcurrent::blockingMap(chunks, [&](const int &chunk)
+        {
+            counts[chunk].fill(0);
+            for(size_t i = chunk * chunk_size; i < qMin(size, (chunk + 1) * chunk_size); ++i)
+                ++counts[chunk][(entries[i].key >> shift) & 0xff];
+        });
+
+        // digits all keys share don't change the order
+        bool uniform = false;
+        for(int digit = 0; digit < 256 && !uniform; ++digit)
+        {
+            size_t total = 0;
+            for(int chunk = 0; chunk < chunk_count; ++chunk)
+                total += counts[chunk][digit];
+            uniform = (total == size);
+        }
+
+        if(uniform)
+            continue;
+
+        size_t offset = 0;
+        for(int digit = 0; digit < 256; ++digit)
+        {
+            for(int chunk = 0; chunk < chunk_count; ++chunk)
+            {
+                size_t count = counts[chunk][digit];
+                counts[chunk][digit] = offset;
+                offset += count;
+            }
+        }
+
+        QtConcurrent::blockingMap(chunks, [&](const int &chunk)
+        {
+            std::array<size_t, 256> &offsets = counts[chunk];
+            for(size_t i = chunk * chunk_size; i < qMin(size, (chunk + 1) * chunk_size); ++i)
+                buffer[offsets[(entries[i].key >> shift) & 0xff]++] = entries[i];
+        });
+
+        entries.swap(buffer);
+    }
+}
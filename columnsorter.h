@@ -0,0 +1,39 @@
+#ifndef COLUMNSORTER_H
+#define COLUMNSORTER_H
+
+#include <QList>
+#include <QPromise>
+
+#include <vector>
+
+class TableSnapshot;
+
+// Sorts the rows of a snapshot column. Every cell gets a 64 bit key once (order preserving
+// bits for numbers, the first characters for texts), the keys are sorted with a parallel
+// LSD radix sort and only rows with equal keys are compared as strings afterwards.
+// Locale aware sorting compares QCollator sort keys with a parallel merge sort instead.
+class ColumnSorter
+{
+public:
+    struct Options
+    {
+        bool numeric = false;
+        Qt::CaseSensitivity sensitivity = Qt::CaseSensitive;
+        bool locale_aware = false;
+    };
+
+    // sorted position per row, empty if the promise got canceled
+    static QList<int> ranks(const TableSnapshot &snapshot, int column, const Options &options, QPromise<QList<int>> &promise);
+
+private:
+    struct Entry
+    {
+        quint64 key;
+        quint32 row;
+    };
+
+    static quint64 numberKey(double value);
+    static void radixSort(std::vector<Entry> &entries, QPromise<QList<int>> &promise);
+};
+
+#endif // COLUMNSORTER_H
@@ -0,0 +1,404 @@
+#include "commandline.h"
+#include "fileprocessor.h"
+#include "tableexporter.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QSet>
+#include <QSettings>
+
+#include <cstdio>
+#include <cstring>
+
+
+// output order and header labels, the same labels as the table and its exports
+static const QList<QPair<QString, QString>> COLUMNS = {
+    {"MD5", "MD5"},
+    {"SHA1", "SHA1"},
+    {"SHA256", "SHA256"},
+    {"TREE", "SHA256 Tree"},
+    {"SAMPLED", "Quick (sampled)"},
+    {"SSDEEP", "ssdeep"},
+    {"ENTROPY", "Entropy"},
+    {"MAGIC", "MIME type"},
+    {"YARA", "YARA"}
+};
+
+
+static void printError(const QString &message)
+{
+    // YARA messages are formatted for the status page
+    QString text = message;
+    text.remove(QRegularExpression("<[^>]*>"));
+    std::fprintf(stderr, "%s\n", qPrintable(text));
+}
+
+
+CommandLine::CommandLine(QObject *parent)
+    : QObject(parent),
+      processor(new ItemProcessor(this)),
+      fileProcessor(nullptr),
+      format(Tsv),
+      file_count(0),
+      error_count(0)
+{
+    connect(processor, &ItemProcessor::resultReady, this, &CommandLine::onResultReady);
+    connect(processor, &ItemProcessor::processingFinished, this, &CommandLine::onProcessingFinished);
+}
+
+
+CommandLine::~CommandLine()
+{
+    delete fileProcessor;
+}
+
+
+bool CommandLine::requested(int argc, char *argv[])
+{
+    for(int i = 1; i < argc; ++i)
+    {
+        if(std::strcmp(argv[i], "--cli") == 0)
+            return true;
+    }
+
+    return false;
+}
+
+
+int CommandLine::start(const QStringList &arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Hashes files without the window and writes one row per file to stdout.");
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption("cli", "Run without the window."));
+    parser.addOption(QCommandLineOption({"a", "algorithms"}, "Comma separated: md5, sha1, sha256, tree, sampled, ssdeep, entropy (default sha256).", "list", "sha256"));
+    parser.addOption(QCommandLineOption({"m", "magic"}, "Add the libmagic MIME type and file type."));
+    parser.addOption(QCommandLineOption({"y", "yara"}, "Scan with the rules of the YARA folder."));
+    parser.addOption(QCommandLineOption({"l", "list"}, "Read paths from a file, one per line, - for stdin.", "file"));
+    parser.addOption(QCommandLineOption({"f", "format"}, "tsv, jsonl, sha256sum or md5sum (default tsv).", "format", "tsv"));
+    parser.addPositionalArgument("paths", "Files and directories, - reads paths from stdin.", "[paths...]");
+
+    if(!parser.parse(arguments))
+    {
+        printError(parser.errorText());
+        return 2;
+    }
+
+    if(parser.isSet("help"))
+    {
+        std::fprintf(stdout, "%s", qPrintable(parser.helpText()));
+        return 0;
+    }
+
+    const QString format_name = parser.value("format").toLower();
+    if(format_name == "tsv")
+        format = Tsv;
+    else if(format_name == "jsonl")
+        format = JsonLines;
+    else if(format_name == "sha256sum")
+        format = Sha256Sum;
+    else if(format_name == "md5sum")
+        format = Md5Sum;
+    else
+    {
+        printError("Unknown format: " + format_name);
+        return 2;
+    }
+
+    static const QStringList HASH_ALGORITHMS = {"MD5", "SHA1", "SHA256", "TREE", "SAMPLED", "SSDEEP", "ENTROPY"};
+
+    QSet<QString> selected;
+    for(const QString &name : parser.value("algorithms").split(',', Qt::SkipEmptyParts))
+    {
+        const QString algorithm = name.trimmed().toUpper();
+        if(!HASH_ALGORITHMS.contains(algorithm))
+        {
+            printError("Unknown algorithm: " + name);
+            return 2;
+        }
+        selected.insert(algorithm);
+    }
+
+    // a manifest needs its digest
+    if(format == Sha256Sum)
+        selected.insert("SHA256");
+    if(format == Md5Sum)
+        selected.insert("MD5");
+
+    if(parser.isSet("magic"))
+        selected.insert("MAGIC");
+
+    if(parser.isSet("yara"))
+    {
+        selected.insert("YARA");
+
+        // the same rules as the window, compiled the same way
+        fileProcessor = new FileProcessor();
+        connect(fileProcessor, &FileProcessor::yaraError, this, &printError);
+        connect(fileProcessor, &FileProcessor::yaraWarning, this, &printError);
+        fileProcessor->initializeYara();
+        processor->setYaraScanner(fileProcessor->yaraScanner());
+    }
+
+    for(const QPair<QString, QString> &column : COLUMNS)
+    {
+        if(selected.contains(column.first))
+            algorithms.append(column.first);
+    }
+
+    if(algorithms.isEmpty())
+    {
+        printError("Nothing to compute.");
+        return 2;
+    }
+
+    const QStringList files = collectFiles(parser.positionalArguments(), parser.value("list"));
+    if(files.isEmpty())
+    {
+        printError("No files to hash.");
+        return 2;
+    }
+
+    // block sizes are shared with the window
+    QSettings settings(QCoreApplication::applicationDirPath() + "/db/settings.ini", QSettings::IniFormat);
+    processor->setSampling(settings.value("sample_mib", 1).toLongLong() * 1024 * 1024, qMax(0, settings.value("sample_blocks", 16).toInt()));
+    processor->setTreeBlockSize(qMax(qint64(1), settings.value("tree_block_mib", 4).toLongLong()) * 1024 * 1024);
+    processor->setEntropyBlockSize(qMax(qint64(64), settings.value("entropy_block_kib", 1024).toLongLong()) * 1024);
+
+    if(!out.open(stdout, QIODevice::WriteOnly))
+    {
+        printError("Can't write to stdout: " + out.errorString());
+        return 2;
+    }
+
+    writeHeader();
+
+    file_count = files.size();
+    processor->startScanning(files, algorithms);
+
+    return -1;
+}
+
+
+// directories are walked like dropped ones, a path given twice is hashed once
+QStringList CommandLine::collectFiles(const QStringList &inputs, const QString &list_path) const
+{
+    QStringList paths = inputs;
+
+    const bool read_stdin = paths.removeAll("-") > 0 || list_path == "-" || (paths.isEmpty() && list_path.isEmpty());
+
+    if(!list_path.isEmpty() && list_path != "-")
+    {
+        QFile list_file(list_path);
+        if(list_file.open(QIODevice::ReadOnly | QIODevice::Text))
+        {
+            for(QByteArray line = list_file.readLine(); !line.isEmpty(); line = list_file.readLine())
+                paths.append(QString::fromUtf8(line).trimmed());
+        }
+        else
+        {
+            printError("Can't read " + list_path + ": " + list_file.errorString());
+        }
+    }
+
+    if(read_stdin)
+    {
+        // a pipe has no end to check for, reading stops at the first empty read
+        QFile input;
+        if(input.open(stdin, QIODevice::ReadOnly | QIODevice::Text))
+        {
+            for(QByteArray line = input.readLine(); !line.isEmpty(); line = input.readLine())
+                paths.append(QString::fromUtf8(line).trimmed());
+        }
+    }
+
+    QStringList files;
+    QSet<QString> seen;
+
+    for(const QString &path : paths)
+    {
+        if(path.isEmpty())
+            continue;
+
+        QFileInfo file_info(path);
+
+        if(file_info.isDir())
+        {
+            QDirIterator dir_iter(file_info.absoluteFilePath(), QDir::Files | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+            while(dir_iter.hasNext())
+            {
+                const QString file_path = dir_iter.next();
+                if(!seen.contains(file_path))
+                {
+                    seen.insert(file_path);
+                    files.append(file_path);
+                }
+            }
+        }
+        else if(file_info.isFile())
+        {
+            const QString file_path = file_info.absoluteFilePath();
+            if(!seen.contains(file_path))
+            {
+                seen.insert(file_path);
+                files.append(file_path);
+            }
+        }
+        else
+        {
+            printError("No such file or directory: " + path);
+        }
+    }
+
+    return files;
+}
+
+
+// the results of a file come in one run, a new path means the previous row is complete
+void CommandLine::onResultReady(const HashResult &result)
+{
+    if(result.path != row_path)
+    {
+        writeRow();
+        row_path = result.path;
+    }
+
+    if(result.algorithm == "ERROR")
+    {
+        printError(result.value);
+        ++error_count;
+    }
+
+    row_results.insert(result.algorithm, result);
+}
+
+
+void CommandLine::onProcessingFinished(const QString &result)
+{
+    writeRow();
+    out.flush();
+    out.close();
+
+    printError(QString("%1 %2 hashed in %3 seconds, %4 %5").arg(file_count).arg(file_count == 1 ? "file" : "files").arg(result)
+                   .arg(error_count).arg(error_count == 1 ? "error" : "errors"));
+
+    QCoreApplication::exit(error_count > 0 ? 1 : 0);
+}
+
+
+void CommandLine::writeHeader()
+{
+    if(format != Tsv)
+        return;
+
+    QStringList labels;
+    for(const QPair<QString, QString> &column : COLUMNS)
+    {
+        if(!algorithms.contains(column.first))
+            continue;
+
+        labels.append(column.second);
+        if(column.first == "MAGIC")
+            labels.append("Filetype");
+    }
+    labels.append("Fullpath");
+
+    out.write(labels.join('\t').toUtf8() + '\n');
+}
+
+
+void CommandLine::writeRow()
+{
+    if(row_path.isEmpty())
+        return;
+
+    const QString path = row_path;
+    const QHash<QString, HashResult> results = row_results;
+
+    row_path.clear();
+    row_results.clear();
+
+    // unreadable files are reported on stderr only
+    if(results.contains("ERROR"))
+        return;
+
+    QByteArray line;
+
+    if(format == Sha256Sum || format == Md5Sum)
+    {
+        const Digest digest = results.value(format == Sha256Sum ? "SHA256" : "MD5").digest;
+        if(digest.isNull())
+            return;
+
+        out.write(TableExporter::manifestLine(digest, path));
+        return;
+    }
+
+    QStringList labels;
+    QStringList cells;
+    for(const QPair<QString, QString> &column : COLUMNS)
+    {
+        if(!algorithms.contains(column.first))
+            continue;
+
+        const HashResult result = results.value(column.first);
+
+        labels.append(column.second);
+        cells.append(result.digest.isNull() ? result.value : result.digest.toHex());
+
+        if(column.first == "MAGIC")
+        {
+            labels.append("Filetype");
+            cells.append(result.detail);
+        }
+    }
+    labels.append("Fullpath");
+    cells.append(path);
+
+    if(format == JsonLines)
+    {
+        line.append('{');
+        for(int i = 0; i < cells.size(); ++i)
+        {
+            if(i > 0)
+                line.append(',');
+            line.append('"').append(labels.at(i).toUtf8()).append("\":");
+
+            // the entropy stays a number, empty cells become null
+            const QString &text = cells.at(i);
+            if(text.isEmpty())
+            {
+                line.append("null");
+                continue;
+            }
+            if(labels.at(i) == "Entropy")
+            {
+                line.append(text.toUtf8());
+                continue;
+            }
+
+            line.append(TableExporter::jsonString(text).toUtf8());
+        }
+        line.append("}\n");
+    }
+    else
+    {
+        // tabs and line breaks would split the cell, empty cells are written as a dash
+        for(QString &cell : cells)
+        {
+            for(QChar &c : cell)
+            {
+                if(c == '\t' || c == '\n' || c == '\r')
+                    c = ' ';
+            }
+            if(cell.isEmpty())
+                cell = "-";
+        }
+        line = cells.join('\t').toUtf8() + '\n';
+    }
+
+    out.write(line);
+}
@@ -0,0 +1,55 @@
+#ifndef COMMANDLINE_H
+#define COMMANDLINE_H
+
+#include <QFile>
+#include <QHash>
+#include <QObject>
+#include <QStringList>
+
+#include "itemprocessor.h"
+
+class FileProcessor;
+
+// Headless mode, "HashLookup --cli [options] paths". Files are hashed by the same item
+// processor as in the table, one item per file, and every file is written to stdout as
+// a row as soon as its item is done. Messages and the summary go to stderr.
+class CommandLine : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CommandLine(QObject *parent = nullptr);
+    ~CommandLine();
+
+    // true if "--cli" is among the arguments, checked before any application object exists
+    static bool requested(int argc, char *argv[]);
+
+    // -1 while the files are hashed, the exit code if there is nothing to do or the arguments are unusable
+    int start(const QStringList &arguments);
+
+private:
+    enum Format { Tsv, JsonLines, Sha256Sum, Md5Sum };
+
+    void onResultReady(const HashResult &result);
+    void onProcessingFinished(const QString &result);
+
+    QStringList collectFiles(const QStringList &inputs, const QString &list_path) const;
+
+    void writeHeader();
+    void writeRow();
+
+    ItemProcessor *processor;
+    FileProcessor *fileProcessor;       // loads and owns the YARA rules, only created with --yara
+
+    QFile out;
+    Format format;
+    QStringList algorithms;             // in output column order
+
+    QString row_path;
+    QHash<QString, HashResult> row_results;
+
+    int file_count;
+    int error_count;
+};
+
+#endif // COMMANDLINE_H
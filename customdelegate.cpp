@@ -1,15 +1,46 @@
 #include "customdelegate.h"
 #include "Column.h"
+#include "customtableview.h"
+#include "digestitem.h"
+#include "pathitem.h"
 
 #include <QPainter>
 #include <QAbstractItemView>
+#include <QApplication>
+#include <QHeaderView>
+#include <QTableView>
+#include <QMouseEvent>
+#include <QMovie>
+#include <QSet>
 
 CustomDelegate::CustomDelegate(QObject *parent) : QStyledItemDelegate(parent)
 {
     tableView = qobject_cast<QAbstractItemView *>(this->parent());
+
+    // one animation for all pending cells, its frames only repaint the visible ones
+    loadingMovie = new QMovie(":/img/loading.gif", QByteArray(), this);
+    connect(loadingMovie, &QMovie::frameChanged, this, &CustomDelegate::updatePendingCells);
+
+    // the hovered row is tracked here, so painting a cell doesn't have to look up the cursor
     if(tableView)
-    {
+        tableView->viewport()->installEventFilter(this);
+
+    // checked once per deletion instead of once per removed range
+    CustomTableView *customTableView = qobject_cast<CustomTableView *>(tableView);
+    if(customTableView)
+        connect(customTableView, &CustomTableView::rowsDeleted, this, &CustomDelegate::updateAnyDuplicates);
+    else if(tableView)
         connect(tableView->model(), &QAbstractItemModel::rowsRemoved, this, &CustomDelegate::updateAnyDuplicates);
+
+    // the duplicate colors are looked up in digest counts that are dropped with every change of the rows
+    if(tableView && tableView->model())
+    {
+        const QAbstractItemModel *model = tableView->model();
+        connect(model, &QAbstractItemModel::dataChanged, this, &CustomDelegate::clearDigestCounts);
+        connect(model, &QAbstractItemModel::rowsInserted, this, &CustomDelegate::clearDigestCounts);
+        connect(model, &QAbstractItemModel::rowsRemoved, this, &CustomDelegate::clearDigestCounts);
+        connect(model, &QAbstractItemModel::layoutChanged, this, &CustomDelegate::clearDigestCounts);
+        connect(model, &QAbstractItemModel::modelReset, this, &CustomDelegate::clearDigestCounts);
     }
 }
 
@@ -17,8 +48,7 @@ void CustomDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option
 {
     if(tableView)
     {
-        QModelIndex hover = tableView->indexAt(tableView->viewport()->mapFromGlobal(QCursor::pos()));
-        if(hover.row() == index.row())
+        if(hoverRow == index.row())
         {
             QColor custom_color(150,170,200,50);
             painter->fillRect(option.rect, custom_color);
@@ -28,20 +58,20 @@ void CustomDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option
             QList<int> columns_to_check = {
                 Column::SHA256,
                 Column::SHA1,
-                Column::MD5
+                Column::MD5,
+                Column::TREEHASH,
+                Column::SAMPLED
             };
 
             int used_column = 0;
-            QModelIndex column_index;
-            QVariant current_value;
+            Digest current_digest;
 
             for(int col : columns_to_check)
             {
                 if(tableView->model()->headerData(col, Qt::Horizontal).toBool())
                 {
-                    column_index = index.sibling(index.row(), col);
-                    current_value = column_index.data();
-                    if(!current_value.toString().contains("-"))
+                    current_digest = DigestItem::digest(index.sibling(index.row(), col));
+                    if(!current_digest.isNull())
                     {
                         used_column = col;
                         break;
@@ -49,7 +79,7 @@ void CustomDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option
                 }
             }
 
-            static QMap<QString, QColor> value_to_colormap;
+            static QHash<Digest, QColor> value_to_colormap;
             static QVector<QColor> colors = { QColor(100, 255, 100, 100), // green
                                               QColor(100, 100, 255, 100), // blue
                                               QColor(100, 255, 200, 100), // teal
@@ -62,39 +92,207 @@ void CustomDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option
                                               QColor(200, 150, 100, 100)  // brown
                                             };
 
-            if(!current_value.isNull() && !current_value.toString().isEmpty() && !(current_value.toString() == "-"))
+            if(!current_digest.isNull() && digestCount(used_column, current_digest) > 1)
             {
-                bool has_duplicate = false;
+                emit duplicatesFound();
 
-                for(int i = 0; i < tableView->model()->rowCount(); ++i)
+                if(!value_to_colormap.contains(current_digest))
                 {
-                    if(i != index.row())
-                    {
-                        QModelIndex other_row_index = tableView->model()->index(i, used_column);
-                        QVariant other_value = other_row_index.data();
-
-                        if(current_value == other_value)
-                        {
-                            has_duplicate = true;
-                            emit duplicatesFound();
-                            break;
-                        }
-                    }
+                    value_to_colormap[current_digest] = colors[value_to_colormap.size() % colors.size()];
                 }
-                if(has_duplicate)
-                {
-                    QString value_str = current_value.toString();
+                painter->fillRect(option.rect, value_to_colormap[current_digest]);
+            }
+        }
+    }
 
-                    if(!value_to_colormap.contains(value_str))
-                    {
-                        value_to_colormap[value_str] = colors[value_to_colormap.size() % colors.size()];
-                    }
-                    painter->fillRect(option.rect, value_to_colormap[value_str]);
-                }
+    QStyleOptionViewItem cell_option(option);
+    initStyleOption(&cell_option, index);
+    QStyle *style = cell_option.widget ? cell_option.widget->style() : QApplication::style();
+
+    if(cell_option.text.isEmpty() && cell_option.icon.isNull())
+    {
+        if(isPendingCell(index))
+        {
+            style->drawControl(QStyle::CE_ItemViewItem, &cell_option, painter, cell_option.widget);
+
+            QPixmap frame = loadingMovie->currentPixmap();
+            if(!frame.isNull())
+            {
+                QSize frame_size = frame.deviceIndependentSize().toSize().boundedTo(cell_option.rect.size());
+                QRect frame_rect = QStyle::alignedRect(Qt::LeftToRight, Qt::AlignCenter, frame_size, cell_option.rect);
+                painter->drawPixmap(frame_rect, frame);
             }
+            return;
+        }
+
+        cell_option.text = "-";
+    }
+
+    style->drawControl(QStyle::CE_ItemViewItem, &cell_option, painter, cell_option.widget);
+}
+
+
+void CustomDelegate::setPending(bool is_pending)
+{
+    if(pending == is_pending)
+        return;
+
+    pending = is_pending;
+    pending ? loadingMovie->start() : loadingMovie->stop();
+    pendingPaths.clear();
+
+    if(tableView)
+        tableView->viewport()->update();
+}
+
+
+void CustomDelegate::addPendingPath(int path_id)
+{
+    pendingPaths.insert(path_id);
+}
+
+
+// a file that failed gets no more results, its empty cells turn into dashes
+void CustomDelegate::removePendingPath(int path_id)
+{
+    if(pendingPaths.remove(path_id) && tableView)
+        tableView->viewport()->update();
+}
+
+
+// the cells that are filled in by hashing, for the rows that are still queued
+bool CustomDelegate::isPendingCell(const QModelIndex &index) const
+{
+    static const QSet<int> result_columns = {
+        Column::MD5,
+        Column::SHA1,
+        Column::SHA256,
+        Column::TREEHASH,
+        Column::SAMPLED,
+        Column::SSDEEP,
+        Column::DIRHASH,
+        Column::VERIFY,
+        Column::ENTROPY
+    };
+
+    return pending && result_columns.contains(index.column())
+           && pendingPaths.contains(PathItem::pathId(index.sibling(index.row(), Column::FULLPATH)));
+}
+
+
+// the rows of a digest column are counted once, instead of scanning them for every painted cell
+int CustomDelegate::digestCount(int column, const Digest &digest) const
+{
+    auto it = digestCounts.constFind(column);
+    if(it == digestCounts.constEnd())
+    {
+        const QAbstractItemModel *model = tableView->model();
+        QHash<Digest, int> counts;
+
+        for(int row = 0; row < model->rowCount(); ++row)
+        {
+            const Digest row_digest = DigestItem::digest(model->index(row, column));
+            if(!row_digest.isNull())
+                ++counts[row_digest];
+        }
+
+        it = digestCounts.insert(column, counts);
+    }
+
+    return it.value().value(digest);
+}
+
+
+void CustomDelegate::clearDigestCounts()
+{
+    digestCounts.clear();
+}
+
+
+// repaints the pending cells of the visible rows and columns only
+void CustomDelegate::updatePendingCells()
+{
+    if(!pending || !tableView || !tableView->model())
+        return;
+
+    QTableView *table = qobject_cast<QTableView *>(tableView);
+    if(!table)
+    {
+        tableView->viewport()->update();
+        return;
+    }
+
+    // columns are movable, so the visible range is one of visual indexes
+    const QHeaderView *header = table->horizontalHeader();
+    const QRect viewport_rect = table->viewport()->rect();
+    int first_row = table->rowAt(viewport_rect.top());
+    int last_row = table->rowAt(viewport_rect.bottom());
+    int first_visual = header->visualIndexAt(viewport_rect.left());
+    int last_visual = header->visualIndexAt(viewport_rect.right());
+
+    if(first_row == -1 || first_visual == -1)
+        return;
+    if(last_row == -1)
+        last_row = table->model()->rowCount() - 1;
+    if(last_visual == -1)
+        last_visual = header->count() - 1;
+
+    QRegion region;
+    for(int row = first_row; row <= last_row; ++row)
+    {
+        for(int visual = first_visual; visual <= last_visual; ++visual)
+        {
+            const int column = header->logicalIndex(visual);
+            if(table->isColumnHidden(column))
+                continue;
+
+            QModelIndex index = table->model()->index(row, column);
+            if(isPendingCell(index) && index.data().toString().isEmpty() && index.data(Qt::DecorationRole).isNull())
+                region += table->visualRect(index);
         }
     }
-    QStyledItemDelegate::paint(painter, option, index);
+
+    if(!region.isEmpty())
+        table->viewport()->update(region);
+}
+
+
+bool CustomDelegate::eventFilter(QObject *watched, QEvent *event)
+{
+    if(tableView && watched == tableView->viewport())
+    {
+        if(event->type() == QEvent::MouseMove)
+            setHoverRow(tableView->indexAt(static_cast<QMouseEvent *>(event)->position().toPoint()).row());
+        else if(event->type() == QEvent::Leave)
+            setHoverRow(-1);
+    }
+
+    // QStyledItemDelegate::eventFilter handles editor events, the viewport's are only observed
+    return false;
+}
+
+
+// repaints the rows that gain or lose the hover highlight
+void CustomDelegate::setHoverRow(int row)
+{
+    if(row == hoverRow)
+        return;
+
+    QTableView *table = qobject_cast<QTableView *>(tableView);
+    if(table)
+    {
+        const int width = table->viewport()->width();
+        if(hoverRow != -1)
+            table->viewport()->update(QRect(0, table->rowViewportPosition(hoverRow), width, table->rowHeight(hoverRow)));
+        if(row != -1)
+            table->viewport()->update(QRect(0, table->rowViewportPosition(row), width, table->rowHeight(row)));
+    }
+    else if(tableView)
+    {
+        tableView->viewport()->update();
+    }
+
+    hoverRow = row;
 }
 
 
@@ -107,21 +305,20 @@ void CustomDelegate::updateAnyDuplicates()
     int used_column = getUsedColumn(tableView->model());
     int row_count = tableView->model()->rowCount();
 
-    for(int row1 = 0; row1 < row_count; ++row1)
+    QSet<Digest> digests;
+    digests.reserve(row_count);
+
+    for(int row = 0; row < row_count && !any_duplicates; ++row)
     {
-        for(int row2 = row1 + 1; row2 < row_count; ++row2)
-        {
-            QModelIndex index1 = tableView->model()->index(row1, used_column);
-            QModelIndex index2 = tableView->model()->index(row2, used_column);
-            QVariant value1 = index1.data();
-            QVariant value2 = index2.data();
+        Digest digest = DigestItem::digest(tableView->model()->index(row, used_column));
+        if(digest.isNull())
+            continue;
 
-            if(value1 == value2)
-            {
-                any_duplicates = true;
-            }
-        }
+        qsizetype size = digests.size();
+        digests.insert(digest);
+        any_duplicates = digests.size() == size;
     }
+
     if(!any_duplicates)
         emit noDuplicatesFound();
 }
@@ -131,20 +328,18 @@ int CustomDelegate::getUsedColumn(const QAbstractItemModel *tableModel)
     QList<int> columns_to_check = {
         Column::SHA256,
         Column::SHA1,
-        Column::MD5
+        Column::MD5,
+        Column::TREEHASH,
+        Column::SAMPLED
     };
 
     int used_column = 0;
-    QModelIndex column_index;
-    QVariant current_value;
 
     for(int col : columns_to_check)
     {
         if(tableModel->headerData(col, Qt::Horizontal).toBool())
         {
-            column_index = tableModel->index(0, col);
-            current_value = column_index.data();
-            if(!current_value.toString().contains("-"))
+            if(!DigestItem::digest(tableModel->index(0, col)).isNull())
             {
                 used_column = col;
                 break;
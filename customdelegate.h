@@ -1,8 +1,14 @@
 #ifndef CUSTOMDELEGATE_H
 #define CUSTOMDELEGATE_H
 
+#include <QHash>
+#include <QSet>
 #include <QStyledItemDelegate>
 
+#include "digest.h"
+
+class QMovie;
+
 class CustomDelegate : public QStyledItemDelegate
 {
     Q_OBJECT
@@ -12,17 +18,36 @@ public:
 
     virtual void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
 
+    // while pending, the empty result cells of the rows still queued show the loading
+    // animation, every other empty cell shows a dash
+    void setPending(bool is_pending);
+    void addPendingPath(int path_id);
+    void removePendingPath(int path_id);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
 signals:
     void duplicatesFound() const;
     void noDuplicatesFound();
 
 private slots:
     void updateAnyDuplicates();
+    void updatePendingCells();
+    void clearDigestCounts();
 
 private:
     int getUsedColumn(const QAbstractItemModel *tableModel);
+    void setHoverRow(int row);
+    bool isPendingCell(const QModelIndex &index) const;
+    int digestCount(int column, const Digest &digest) const;
 
     QAbstractItemView *tableView;
+    QMovie *loadingMovie;
+    bool pending = false;
+    QSet<int> pendingPaths;
+    int hoverRow = -1;
+    mutable QHash<int, QHash<Digest, int>> digestCounts;  // per digest column, counted on first paint
 };
 
 #endif // CUSTOMDELEGATE_H
@@ -1,11 +1,111 @@
 #include "customsortfilterproxymodel.h"
 #include "Column.h"
+#include "columnsorter.h"
+#include "digestitem.h"
+
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <vector>
+
+
+static const int FILTER_CHUNK_ROWS = 16384;
 
 CustomSortFilterProxyModel::CustomSortFilterProxyModel(QTableView *tableView, QObject *parent)
-    : QSortFilterProxyModel(parent),
-      m_tableView(tableView)
+    : QAbstractProxyModel(parent),
+      m_tableView(tableView),
+      m_filter_regex(QString(), QRegularExpression::CaseInsensitiveOption)
+{
+    connect(&m_filter_watcher, &QFutureWatcher<QBitArray>::finished, this, &CustomSortFilterProxyModel::onFilterFinished);
+    connect(&m_sort_watcher, &QFutureWatcher<QList<int>>::finished, this, &CustomSortFilterProxyModel::onSortFinished);
+}
+
+void CustomSortFilterProxyModel::setSourceModel(QAbstractItemModel *source_model)
+{
+    beginResetModel();
+
+    if(sourceModel())
+        disconnect(sourceModel(), nullptr, this, nullptr);
+
+    QAbstractProxyModel::setSourceModel(source_model);
+    dropSnapshot();
+
+    if(source_model)
+    {
+        connect(source_model, &QAbstractItemModel::dataChanged, this, &CustomSortFilterProxyModel::onSourceDataChanged);
+        connect(source_model, &QAbstractItemModel::headerDataChanged, this, &CustomSortFilterProxyModel::onSourceHeaderDataChanged);
+        connect(source_model, &QAbstractItemModel::rowsInserted, this, &CustomSortFilterProxyModel::onSourceRowsInserted);
+        connect(source_model, &QAbstractItemModel::rowsAboutToBeRemoved, this, &CustomSortFilterProxyModel::onSourceRowsAboutToBeRemoved);
+        connect(source_model, &QAbstractItemModel::rowsRemoved, this, &CustomSortFilterProxyModel::onSourceRowsRemoved);
+        connect(source_model, &QAbstractItemModel::columnsAboutToBeInserted, this, [this](const QModelIndex &, int first, int last) {
+            dropSnapshot();
+            beginInsertColumns(QModelIndex(), first, last);
+        });
+        connect(source_model, &QAbstractItemModel::columnsInserted, this, [this]() { endInsertColumns(); });
+        connect(source_model, &QAbstractItemModel::columnsAboutToBeRemoved, this, [this](const QModelIndex &, int first, int last) {
+            dropSnapshot();
+            beginRemoveColumns(QModelIndex(), first, last);
+        });
+        connect(source_model, &QAbstractItemModel::columnsRemoved, this, [this]() { endRemoveColumns(); });
+        connect(source_model, &QAbstractItemModel::modelAboutToBeReset, this, &CustomSortFilterProxyModel::onSourceModelAboutToBeReset);
+        connect(source_model, &QAbstractItemModel::modelReset, this, &CustomSortFilterProxyModel::onSourceModelReset);
+
+        // the table is never sorted by the source model itself, a layout change starts over
+        connect(source_model, &QAbstractItemModel::layoutAboutToBeChanged, this, &CustomSortFilterProxyModel::onSourceModelAboutToBeReset);
+        connect(source_model, &QAbstractItemModel::layoutChanged, this, &CustomSortFilterProxyModel::onSourceModelReset);
+    }
+
+    m_proxy_rows.clear();
+    for(int row = 0; source_model && row < source_model->rowCount(); ++row)
+        m_proxy_rows.append(row);
+    updateSourceToProxy();
+
+    endResetModel();
+}
+
+QModelIndex CustomSortFilterProxyModel::index(int row, int column, const QModelIndex &parent) const
 {
+    if(parent.isValid() || row < 0 || row >= m_proxy_rows.size() || column < 0 || column >= columnCount())
+        return QModelIndex();
 
+    return createIndex(row, column);
+}
+
+QModelIndex CustomSortFilterProxyModel::parent(const QModelIndex &) const
+{
+    return QModelIndex();
+}
+
+int CustomSortFilterProxyModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(m_proxy_rows.size());
+}
+
+int CustomSortFilterProxyModel::columnCount(const QModelIndex &parent) const
+{
+    return (parent.isValid() || !sourceModel()) ? 0 : sourceModel()->columnCount();
+}
+
+bool CustomSortFilterProxyModel::hasChildren(const QModelIndex &parent) const
+{
+    return !parent.isValid() && !m_proxy_rows.isEmpty() && columnCount() > 0;
+}
+
+QModelIndex CustomSortFilterProxyModel::mapToSource(const QModelIndex &proxy_index) const
+{
+    if(!proxy_index.isValid() || !sourceModel() || proxy_index.row() >= m_proxy_rows.size())
+        return QModelIndex();
+
+    return sourceModel()->index(m_proxy_rows.at(proxy_index.row()), proxy_index.column());
+}
+
+QModelIndex CustomSortFilterProxyModel::mapFromSource(const QModelIndex &source_index) const
+{
+    if(!source_index.isValid() || source_index.row() >= m_source_to_proxy.size())
+        return QModelIndex();
+
+    const int row = m_source_to_proxy.at(source_index.row());
+    return row == -1 ? QModelIndex() : createIndex(row, source_index.column());
 }
 
 void CustomSortFilterProxyModel::setNumericSortingColumns(const QSet<int> &columns)
@@ -13,10 +113,601 @@ void CustomSortFilterProxyModel::setNumericSortingColumns(const QSet<int> &colum
     numericSortingColumns = columns;
 }
 
+QSet<int> CustomSortFilterProxyModel::numericColumns() const
+{
+    return numericSortingColumns;
+}
+
 void CustomSortFilterProxyModel::setFilterDuplicates(bool filter)
 {
     m_filter_duplicates = filter;
-    invalidateFilter();
+    refilter();
+}
+
+void CustomSortFilterProxyModel::setNumericFilter(int column, const QString &comparison, double value)
+{
+    m_numeric_filter_column = column;
+    m_numeric_filter_comparison = comparison;
+    m_numeric_filter_value = value;
+    refilter();
+}
+
+void CustomSortFilterProxyModel::clearNumericFilter()
+{
+    if(m_numeric_filter_column == -1)
+        return;
+
+    m_numeric_filter_column = -1;
+    refilter();
+}
+
+void CustomSortFilterProxyModel::setSearchQuery(const QString &query, SearchIndex::Mode mode)
+{
+    m_use_search_query = true;
+    m_search_query = query;
+    m_search_mode = mode;
+}
+
+void CustomSortFilterProxyModel::clearSearchQuery()
+{
+    m_use_search_query = false;
+    m_search_query.clear();
+}
+
+void CustomSortFilterProxyModel::setHashListFilter(const QSet<Digest> &hashes)
+{
+    if(hashes == m_hash_list_filter)
+        return;
+
+    m_hash_list_filter = hashes;
+    refilter();
+}
+
+void CustomSortFilterProxyModel::setSnapshot(const QSharedPointer<const TableSnapshot> &snapshot)
+{
+    dropSnapshot();
+
+    if(!snapshot || !sourceModel() || snapshot->rowCount() != sourceModel()->rowCount())
+        return;
+
+    m_snapshot = snapshot;
+
+    // a pass that starts before the index is complete waits for it
+    m_search_index = QSharedPointer<SearchIndex>::create();
+    m_search_index_built = QtConcurrent::run([index = m_search_index, snapshot]() { index->build(snapshot); });
+
+    // the ranks of the sorted column are ready for the next filter result
+    if(m_sort_column >= 0)
+        sort(m_sort_column, m_sort_order);
+}
+
+void CustomSortFilterProxyModel::dropSnapshot()
+{
+    m_filter_watcher.future().cancel();
+    m_sort_watcher.future().cancel();
+
+    m_snapshot.clear();
+    m_search_index.clear();
+    m_search_index_built = QFuture<void>();
+    m_column_ranks.clear();
+    m_pending_sort_column = -1;
+}
+
+void CustomSortFilterProxyModel::startFilter(const QRegularExpression &regex)
+{
+    m_filter_regex = regex;
+    m_filter_case = regex.patternOptions().testFlag(QRegularExpression::CaseInsensitiveOption) ? Qt::CaseInsensitive : Qt::CaseSensitive;
+    refilter();
+}
+
+void CustomSortFilterProxyModel::startWildcardFilter(const QString &pattern)
+{
+    QRegularExpression regex(QRegularExpression::wildcardToRegularExpression(pattern, QRegularExpression::UnanchoredWildcardConversion));
+    if(m_filter_case == Qt::CaseInsensitive)
+        regex.setPatternOptions(QRegularExpression::CaseInsensitiveOption);
+
+    m_filter_regex = regex;
+    refilter();
+}
+
+void CustomSortFilterProxyModel::startFilterCase(Qt::CaseSensitivity sensitivity)
+{
+    m_filter_case = sensitivity;
+
+    QRegularExpression::PatternOptions options = m_filter_regex.patternOptions();
+    options.setFlag(QRegularExpression::CaseInsensitiveOption, sensitivity == Qt::CaseInsensitive);
+    m_filter_regex.setPatternOptions(options);
+
+    refilter();
+}
+
+QRegularExpression CustomSortFilterProxyModel::filterRegularExpression() const
+{
+    return m_filter_regex;
+}
+
+Qt::CaseSensitivity CustomSortFilterProxyModel::filterCaseSensitivity() const
+{
+    return m_filter_case;
+}
+
+void CustomSortFilterProxyModel::refilter()
+{
+    if(!sourceModel())
+        return;
+
+    if(!m_snapshot)
+    {
+        QList<int> rows;
+        for(int row = 0; row < sourceModel()->rowCount(); ++row)
+        {
+            if(filterAcceptsRow(row, QModelIndex()))
+                rows.append(row);
+        }
+
+        setProxyRows(sortedRows(rows), QAbstractItemModel::NoLayoutChangeHint);
+        return;
+    }
+
+    FilterSettings settings;
+    settings.regex = m_filter_regex;
+    settings.regex.optimize(); // compile once here instead of racing in the worker threads
+
+    for(int col = 0; col < m_snapshot->columnCount(); ++col)
+    {
+        if(!m_tableView->isColumnHidden(col))
+            settings.visible_columns.append(col);
+    }
+
+    if(m_use_search_query)
+    {
+        settings.search_index = m_search_index;
+        settings.search_index_built = m_search_index_built;
+        settings.search_query = m_search_query;
+        settings.search_mode = m_search_mode;
+    }
+
+    settings.numeric_column = m_numeric_filter_column;
+    settings.numeric_comparison = m_numeric_filter_comparison;
+    settings.numeric_value = m_numeric_filter_value;
+    settings.hash_list = m_hash_list_filter;
+    settings.filter_duplicates = m_filter_duplicates;
+
+    for(int col : {Column::SHA256, Column::SHA1, Column::MD5, Column::TREEHASH, Column::SAMPLED})
+    {
+        if(!m_tableView->isColumnHidden(col))
+            settings.duplicate_columns.append(col);
+    }
+
+    // a newer query replaces the running pass
+    m_filter_watcher.future().cancel();
+    m_filter_watcher.setFuture(QtConcurrent::run(&CustomSortFilterProxyModel::filterRows, m_snapshot, settings));
+}
+
+void CustomSortFilterProxyModel::onFilterFinished()
+{
+    QFuture<QBitArray> future = m_filter_watcher.future();
+    if(future.isCanceled() || future.resultCount() == 0)
+        return;
+
+    const QBitArray accepted_rows = future.result();
+
+    QList<int> rows;
+    for(int row = 0; row < accepted_rows.size(); ++row)
+    {
+        if(accepted_rows.testBit(row))
+            rows.append(row);
+    }
+
+    setProxyRows(sortedRows(rows), QAbstractItemModel::NoLayoutChangeHint);
+
+    emit filterFinished();
+}
+
+void CustomSortFilterProxyModel::sort(int column, Qt::SortOrder order)
+{
+    m_sort_column = column;
+    m_sort_order = order;
+
+    // ranks are kept per column, toggling the order or returning to a column doesn't sort again
+    if(!m_snapshot || column < 0 || column >= m_snapshot->columnCount() || m_column_ranks.contains(column))
+    {
+        m_sort_watcher.future().cancel();
+        m_pending_sort_column = -1;
+        setProxyRows(sortedRows(m_proxy_rows), QAbstractItemModel::VerticalSortHint);
+        return;
+    }
+
+    // the current order stays until the ranks of the new column are ready
+    if(column == m_pending_sort_column)
+        return;
+
+    m_pending_sort_column = column;
+
+    ColumnSorter::Options options;
+    options.numeric = numericSortingColumns.contains(column);
+
+    m_sort_watcher.future().cancel();
+    m_sort_watcher.setFuture(QtConcurrent::run(&CustomSortFilterProxyModel::sortRows, m_snapshot, column, options));
+}
+
+int CustomSortFilterProxyModel::sortColumn() const
+{
+    return m_sort_column;
+}
+
+Qt::SortOrder CustomSortFilterProxyModel::sortOrder() const
+{
+    return m_sort_order;
+}
+
+void CustomSortFilterProxyModel::onSortFinished()
+{
+    QFuture<QList<int>> future = m_sort_watcher.future();
+    if(future.isCanceled() || future.resultCount() == 0)
+        return;
+
+    m_column_ranks.insert(m_pending_sort_column, future.result());
+    m_pending_sort_column = -1;
+
+    setProxyRows(sortedRows(m_proxy_rows), QAbstractItemModel::VerticalSortHint);
+}
+
+// the ranks of the snapshot put the rows in order in one pass, without them the rows are
+// compared on the spot. Rows keep the current order while the ranks are computed.
+QList<int> CustomSortFilterProxyModel::sortedRows(QList<int> rows) const
+{
+    if(m_sort_column < 0 || !sourceModel())
+    {
+        std::sort(rows.begin(), rows.end());
+        return rows;
+    }
+
+    auto ranks = m_column_ranks.constFind(m_sort_column);
+    if(ranks != m_column_ranks.constEnd())
+    {
+        QList<int> rows_by_rank(ranks->size(), -1);
+        for(int row : rows)
+            rows_by_rank[ranks->at(row)] = row;
+
+        rows.clear();
+        for(int rank = 0; rank < rows_by_rank.size(); ++rank)
+        {
+            const int row = rows_by_rank.at(m_sort_order == Qt::AscendingOrder ? rank : rows_by_rank.size() - 1 - rank);
+            if(row != -1)
+                rows.append(row);
+        }
+        return rows;
+    }
+
+    if(m_snapshot)
+    {
+        // rows that are visible keep their place, the others go below them
+        QBitArray requested(m_source_to_proxy.size());
+        for(int row : rows)
+            requested.setBit(row);
+
+        QList<int> ordered_rows;
+        for(int row : m_proxy_rows)
+        {
+            if(requested.testBit(row))
+                ordered_rows.append(row);
+        }
+        for(int row = 0; row < requested.size(); ++row)
+        {
+            if(requested.testBit(row) && m_source_to_proxy.at(row) == -1)
+                ordered_rows.append(row);
+        }
+
+        return ordered_rows;
+    }
+
+    const int column = m_sort_column;
+    const bool ascending = m_sort_order == Qt::AscendingOrder;
+    std::stable_sort(rows.begin(), rows.end(), [&](int left, int right)
+    {
+        const QModelIndex left_index = sourceModel()->index(left, column);
+        const QModelIndex right_index = sourceModel()->index(right, column);
+        return ascending ? lessThan(left_index, right_index) : lessThan(right_index, left_index);
+    });
+
+    return rows;
+}
+
+// one layout change for any filter or sort result, persistent indexes follow their source rows
+void CustomSortFilterProxyModel::setProxyRows(const QList<int> &rows, QAbstractItemModel::LayoutChangeHint hint)
+{
+    emit layoutAboutToBeChanged(QList<QPersistentModelIndex>(), hint);
+
+    const QModelIndexList old_indexes = persistentIndexList();
+    QList<QModelIndex> source_indexes;
+    source_indexes.reserve(old_indexes.size());
+    for(const QModelIndex &index : old_indexes)
+        source_indexes.append(mapToSource(index));
+
+    m_proxy_rows = rows;
+    updateSourceToProxy();
+
+    QModelIndexList new_indexes;
+    new_indexes.reserve(old_indexes.size());
+    for(const QModelIndex &source_index : source_indexes)
+        new_indexes.append(mapFromSource(source_index));
+
+    changePersistentIndexList(old_indexes, new_indexes);
+
+    emit layoutChanged(QList<QPersistentModelIndex>(), hint);
+}
+
+void CustomSortFilterProxyModel::updateSourceToProxy()
+{
+    m_source_to_proxy.fill(-1, sourceModel() ? sourceModel()->rowCount() : 0);
+
+    for(int row = 0; row < m_proxy_rows.size(); ++row)
+        m_source_to_proxy[m_proxy_rows.at(row)] = row;
+}
+
+void CustomSortFilterProxyModel::onSourceDataChanged(const QModelIndex &top_left, const QModelIndex &bottom_right, const QList<int> &roles)
+{
+    int first = -1;
+    int last = -1;
+
+    for(int row = top_left.row(); row <= bottom_right.row() && row < m_source_to_proxy.size(); ++row)
+    {
+        const int proxy_row = m_source_to_proxy.at(row);
+        if(proxy_row == -1)
+            continue;
+
+        first = (first == -1) ? proxy_row : qMin(first, proxy_row);
+        last = qMax(last, proxy_row);
+    }
+
+    if(first != -1)
+        emit dataChanged(index(first, top_left.column()), index(last, bottom_right.column()), roles);
+}
+
+void CustomSortFilterProxyModel::onSourceHeaderDataChanged(Qt::Orientation orientation, int first, int last)
+{
+    if(orientation == Qt::Horizontal)
+        emit headerDataChanged(orientation, first, last);
+    else if(!m_proxy_rows.isEmpty())
+        emit headerDataChanged(orientation, 0, int(m_proxy_rows.size()) - 1);
+}
+
+// new rows are appended, rows inserted above others move the source rows below them
+void CustomSortFilterProxyModel::onSourceRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    if(parent.isValid())
+        return;
+
+    const int count = last - first + 1;
+    dropSnapshot();
+
+    if(first < m_source_to_proxy.size())
+    {
+        for(int &row : m_proxy_rows)
+        {
+            if(row >= first)
+                row += count;
+        }
+    }
+    m_source_to_proxy.insert(first, count, -1);
+
+    QList<int> new_rows;
+    for(int row = first; row <= last; ++row)
+    {
+        if(filterAcceptsRow(row, QModelIndex()))
+            new_rows.append(row);
+    }
+
+    if(new_rows.isEmpty())
+        return;
+
+    beginInsertRows(QModelIndex(), int(m_proxy_rows.size()), int(m_proxy_rows.size() + new_rows.size()) - 1);
+    for(int row : new_rows)
+    {
+        m_source_to_proxy[row] = int(m_proxy_rows.size());
+        m_proxy_rows.append(row);
+    }
+    endInsertRows();
+}
+
+// the visible rows of the removed source rows go away in contiguous ranges, from the bottom up
+void CustomSortFilterProxyModel::onSourceRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last)
+{
+    if(parent.isValid())
+        return;
+
+    dropSnapshot();
+
+    QList<int> proxy_rows;
+    for(int row = first; row <= last && row < m_source_to_proxy.size(); ++row)
+    {
+        if(m_source_to_proxy.at(row) != -1)
+            proxy_rows.append(m_source_to_proxy.at(row));
+    }
+    std::sort(proxy_rows.begin(), proxy_rows.end());
+
+    for(qsizetype end = proxy_rows.size() - 1; end >= 0;)
+    {
+        qsizetype start = end;
+        while(start > 0 && proxy_rows.at(start - 1) == proxy_rows.at(start) - 1)
+            --start;
+
+        beginRemoveRows(QModelIndex(), proxy_rows.at(start), proxy_rows.at(end));
+        m_proxy_rows.remove(proxy_rows.at(start), end - start + 1);
+        endRemoveRows();
+
+        end = start - 1;
+    }
+
+    if(!proxy_rows.isEmpty())
+        updateSourceToProxy();
+}
+
+void CustomSortFilterProxyModel::onSourceRowsRemoved(const QModelIndex &parent, int first, int last)
+{
+    if(parent.isValid())
+        return;
+
+    const int count = last - first + 1;
+
+    for(int &row : m_proxy_rows)
+    {
+        if(row > last)
+            row -= count;
+    }
+    m_source_to_proxy.remove(first, count);
+}
+
+void CustomSortFilterProxyModel::onSourceModelAboutToBeReset()
+{
+    beginResetModel();
+    dropSnapshot();
+}
+
+void CustomSortFilterProxyModel::onSourceModelReset()
+{
+    m_proxy_rows.clear();
+    for(int row = 0; row < sourceModel()->rowCount(); ++row)
+    {
+        if(filterAcceptsRow(row, QModelIndex()))
+            m_proxy_rows.append(row);
+    }
+    m_proxy_rows = sortedRows(m_proxy_rows);
+    updateSourceToProxy();
+
+    endResetModel();
+}
+
+bool CustomSortFilterProxyModel::compareNumber(double value, const QString &comparison, double reference)
+{
+    if(comparison == "<")
+        return value < reference;
+    if(comparison == "<=")
+        return value <= reference;
+    if(comparison == ">")
+        return value > reference;
+    if(comparison == ">=")
+        return value >= reference;
+    return value == reference;
+}
+
+void CustomSortFilterProxyModel::filterRows(QPromise<QBitArray> &promise, const QSharedPointer<const TableSnapshot> &snapshot, const FilterSettings &settings)
+{
+    const int row_count = snapshot->rowCount();
+
+    // rows the search index can't rule out
+    QBitArray candidate_rows;
+    bool use_candidate_rows = false;
+
+    if(settings.search_index)
+    {
+        QFuture<void> search_index_built = settings.search_index_built;
+        search_index_built.waitForFinished();
+
+        use_candidate_rows = settings.search_index->candidates(settings.search_query, settings.search_mode, candidate_rows, promise);
+        if(promise.isCanceled())
+            return;
+    }
+
+    // duplicates depend on all earlier rows, so they are found in one sequential pass
+    std::vector<char> duplicates(row_count, 0);
+
+    if(settings.filter_duplicates)
+    {
+        QHash<int, QSet<Digest>> seen_hashes;
+
+        for(int row = 0; row < row_count; ++row)
+        {
+            for(int col : settings.duplicate_columns)
+            {
+                const Digest digest = snapshot->digest(row, col);
+                if(!digest.isNull())
+                {
+                    duplicates[row] = seen_hashes[col].contains(digest);
+                    break;
+                }
+            }
+
+            for(int col : settings.duplicate_columns)
+            {
+                const Digest digest = snapshot->digest(row, col);
+                if(!digest.isNull())
+                    seen_hashes[col].insert(digest);
+            }
+
+            if(row % FILTER_CHUNK_ROWS == 0 && promise.isCanceled())
+                return;
+        }
+    }
+
+    std::vector<char> accepted(row_count, 0);
+
+    QList<int> chunks;
+    for(int start = 0; start < row_count; start += FILTER_CHUNK_ROWS)
+        chunks.append(start);
+
+    QtConcurrent::blockingMap(chunks, [&](const int &start)
+    {
+        if(promise.isCanceled())
+            return;
+
+        const int end = qMin(start + FILTER_CHUNK_ROWS, row_count);
+        for(int row = start; row < end; ++row)
+        {
+            if(duplicates[row])
+                continue;
+
+            if(use_candidate_rows && !candidate_rows.testBit(row))
+                continue;
+
+            if(settings.numeric_column != -1)
+            {
+                double value;
+                if(!snapshot->number(row, settings.numeric_column, value) || !compareNumber(value, settings.numeric_comparison, settings.numeric_value))
+                    continue;
+            }
+
+            if(!settings.hash_list.isEmpty())
+            {
+                bool listed = false;
+                for(int col : {Column::MD5, Column::SHA1, Column::SHA256, Column::TREEHASH})
+                    listed = listed || settings.hash_list.contains(snapshot->digest(row, col));
+
+                if(!listed)
+                    continue;
+            }
+
+            for(int col : settings.visible_columns)
+            {
+                if(snapshot->text(row, col).contains(settings.regex))
+                {
+                    accepted[row] = 1;
+                    break;
+                }
+            }
+        }
+    });
+
+    if(promise.isCanceled())
+        return;
+
+    QBitArray accepted_rows(row_count);
+    for(int row = 0; row < row_count; ++row)
+    {
+        if(accepted[row])
+            accepted_rows.setBit(row);
+    }
+
+    promise.addResult(accepted_rows);
+}
+
+void CustomSortFilterProxyModel::sortRows(QPromise<QList<int>> &promise, const QSharedPointer<const TableSnapshot> &snapshot, int column, const ColumnSorter::Options &options)
+{
+    QList<int> ranks = ColumnSorter::ranks(*snapshot, column, options, promise);
+
+    if(!promise.isCanceled())
+        promise.addResult(ranks);
 }
 
 bool CustomSortFilterProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
@@ -24,13 +715,42 @@ bool CustomSortFilterProxyModel::filterAcceptsRow(int sourceRow, const QModelInd
     QModelIndex index;
     bool regexFilterPassed = false;
 
+    if(m_numeric_filter_column != -1)
+    {
+        bool ok;
+        index = sourceModel()->index(sourceRow, m_numeric_filter_column, sourceParent);
+        double value = sourceModel()->data(index, Qt::UserRole).toDouble(&ok);
+
+        if(!ok || !compareNumber(value, m_numeric_filter_comparison, m_numeric_filter_value))
+            return false;
+    }
+
+    // hash lists are only matched against the digest columns, one set lookup per column
+    if(!m_hash_list_filter.isEmpty())
+    {
+        bool listed = false;
+
+        for(int col : {Column::MD5, Column::SHA1, Column::SHA256, Column::TREEHASH})
+        {
+            index = sourceModel()->index(sourceRow, col, sourceParent);
+            if(m_hash_list_filter.contains(DigestItem::digest(index)))
+            {
+                listed = true;
+                break;
+            }
+        }
+
+        if(!listed)
+            return false;
+    }
+
     for(int col = 0; col < sourceModel()->columnCount(); ++col)
     {
         if(!m_tableView->isColumnHidden(col))
         {
             index = sourceModel()->index(sourceRow, col, sourceParent);
 
-            if(index.isValid() && sourceModel()->data(index).toString().contains(filterRegularExpression()))
+            if(index.isValid() && sourceModel()->data(index).toString().contains(m_filter_regex))
             {
                 regexFilterPassed = true;
                 break;
@@ -44,20 +764,22 @@ bool CustomSortFilterProxyModel::filterAcceptsRow(int sourceRow, const QModelInd
     if(m_filter_duplicates)
     {
         int visible_column = 0;
+        Digest digest;
 
         QList<int> columns_to_check = {
             Column::SHA256,
             Column::SHA1,
-            Column::MD5
+            Column::MD5,
+            Column::TREEHASH,
+            Column::SAMPLED
         };
 
         for(int col : columns_to_check)
         {
             if(!m_tableView->isColumnHidden(col))
             {
-                QModelIndex hash_index = sourceModel()->index(sourceRow, col, sourceParent);
-                QString hash_values = sourceModel()->data(hash_index).toString();
-                if(!hash_values.contains("-"))
+                digest = DigestItem::digest(sourceModel()->index(sourceRow, col, sourceParent));
+                if(!digest.isNull())
                 {
                     visible_column = col;
                     break;
@@ -67,20 +789,10 @@ bool CustomSortFilterProxyModel::filterAcceptsRow(int sourceRow, const QModelInd
 
         if(visible_column)
         {
-            QModelIndex hash_index = sourceModel()->index(sourceRow, visible_column, sourceParent);
-            QString hash_values = sourceModel()->data(hash_index).toString();
-
-
             for (int i = 0; i < sourceRow; ++i)
             {
-                QModelIndex other_hash_index = sourceModel()->index(i, visible_column);
-
-                QString other_hash_values = sourceModel()->data(other_hash_index).toString();
-
-                if (hash_values == other_hash_values && !(hash_values.isEmpty() || hash_values == "-"))
-                {
+                if(DigestItem::digest(sourceModel()->index(i, visible_column)) == digest)
                     return false;
-                }
             }
         }
     }
@@ -100,6 +812,6 @@ bool CustomSortFilterProxyModel::lessThan(const QModelIndex &source_left, const
         if(ok1 && ok2)
             return left < right;
     }
-    return QSortFilterProxyModel::lessThan(source_left, source_right);
+    return QString::compare(source_left.data().toString(), source_right.data().toString()) < 0;
 }
 
@@ -3,26 +3,145 @@
 
 #include <QTableView>
 #include <QObject>
-#include <QSortFilterProxyModel>
+#include <QAbstractProxyModel>
+#include <QBitArray>
+#include <QFutureWatcher>
+#include <QPromise>
+#include <QRegularExpression>
+#include <QSet>
+#include <QSharedPointer>
 
-class CustomSortFilterProxyModel : public QSortFilterProxyModel
+#include "columnsorter.h"
+#include "searchindex.h"
+#include "tablesnapshot.h"
+
+// Filters and sorts the rows of the flat table. The visible rows are kept as a list of source
+// rows, so a filter or sort result is applied as one permutation with a layout change. Rows
+// keep their place when their data changes and new rows are appended, until the next filter
+// or sort.
+class CustomSortFilterProxyModel : public QAbstractProxyModel
 {
     Q_OBJECT
 public:
     CustomSortFilterProxyModel(QTableView *tableView, QObject *parent = nullptr);
 
+    void setSourceModel(QAbstractItemModel *source_model) override;
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex mapToSource(const QModelIndex &proxy_index) const override;
+    QModelIndex mapFromSource(const QModelIndex &source_index) const override;
+
     void setNumericSortingColumns(const QSet<int> &columns);
+    QSet<int> numericColumns() const;
     void setFilterDuplicates(bool filter);
+    void setNumericFilter(int column, const QString &comparison, double value);
+    void clearNumericFilter();
+    void setHashListFilter(const QSet<Digest> &hashes);
+
+    // with a snapshot, filtering and sorting run on worker threads and the result is swapped
+    // in when it is ready, without one the proxy filters and sorts synchronously. The search
+    // index of a snapshot is built on a worker thread as well.
+    void setSnapshot(const QSharedPointer<const TableSnapshot> &snapshot);
+
+    // the search index narrows the background pass down to candidate rows for this query,
+    // takes effect with the next filter change
+    void setSearchQuery(const QString &query, SearchIndex::Mode mode);
+    void clearSearchQuery();
+
+    // each of these starts a new filter pass
+    void startFilter(const QRegularExpression &regex);
+    void startWildcardFilter(const QString &pattern);
+    void startFilterCase(Qt::CaseSensitivity sensitivity);
 
-protected:
-    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override;
-    bool lessThan(const QModelIndex &source_left, const QModelIndex &source_right) const override;
+    QRegularExpression filterRegularExpression() const;
+    Qt::CaseSensitivity filterCaseSensitivity() const;
+
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+    int sortColumn() const;
+    Qt::SortOrder sortOrder() const;
+
+signals:
+    void filterFinished();
 
 private:
+    struct FilterSettings
+    {
+        QRegularExpression regex;
+        QList<int> visible_columns;
+        QSharedPointer<const SearchIndex> search_index;   // null without a search query
+        QFuture<void> search_index_built;
+        QString search_query;
+        SearchIndex::Mode search_mode;
+        int numeric_column;
+        QString numeric_comparison;
+        double numeric_value;
+        QSet<Digest> hash_list;
+        bool filter_duplicates;
+        QList<int> duplicate_columns;
+    };
+
+    void refilter();
+    void onFilterFinished();
+    void onSortFinished();
+
+    void onSourceDataChanged(const QModelIndex &top_left, const QModelIndex &bottom_right, const QList<int> &roles);
+    void onSourceHeaderDataChanged(Qt::Orientation orientation, int first, int last);
+    void onSourceRowsInserted(const QModelIndex &parent, int first, int last);
+    void onSourceRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last);
+    void onSourceRowsRemoved(const QModelIndex &parent, int first, int last);
+    void onSourceModelAboutToBeReset();
+    void onSourceModelReset();
+
+    // the snapshot and the results computed from it no longer match the source rows
+    void dropSnapshot();
+
+    // visible rows in the current sort order
+    QList<int> sortedRows(QList<int> rows) const;
+    // swaps in the visible rows with one layout change and moves persistent indexes along
+    void setProxyRows(const QList<int> &rows, QAbstractItemModel::LayoutChangeHint hint);
+    void updateSourceToProxy();
+
+    static void filterRows(QPromise<QBitArray> &promise, const QSharedPointer<const TableSnapshot> &snapshot, const FilterSettings &settings);
+    static void sortRows(QPromise<QList<int>> &promise, const QSharedPointer<const TableSnapshot> &snapshot, int column, const ColumnSorter::Options &options);
+    static bool compareNumber(double value, const QString &comparison, double reference);
+
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const;
+    bool lessThan(const QModelIndex &source_left, const QModelIndex &source_right) const;
 
     QTableView *m_tableView;
     QSet<int> numericSortingColumns;
     bool m_filter_duplicates = false;
+
+    QRegularExpression m_filter_regex;
+    Qt::CaseSensitivity m_filter_case = Qt::CaseInsensitive;
+
+    int m_numeric_filter_column = -1;
+    QString m_numeric_filter_comparison;
+    double m_numeric_filter_value = 0.0;
+
+    QSet<Digest> m_hash_list_filter;  // empty when inactive
+
+    bool m_use_search_query = false;
+    QString m_search_query;
+    SearchIndex::Mode m_search_mode = SearchIndex::Wildcard;
+
+    QList<int> m_proxy_rows;           // source row per visible row
+    QList<int> m_source_to_proxy;      // visible row per source row, -1 when filtered out
+
+    QSharedPointer<const TableSnapshot> m_snapshot;
+    QSharedPointer<SearchIndex> m_search_index;
+    QFuture<void> m_search_index_built;
+    QFutureWatcher<QBitArray> m_filter_watcher;
+
+    int m_sort_column = -1;
+    Qt::SortOrder m_sort_order = Qt::AscendingOrder;
+    QHash<int, QList<int>> m_column_ranks;  // sorted position per source row, per column of the snapshot
+    int m_pending_sort_column = -1;
+    QFutureWatcher<QList<int>> m_sort_watcher;
 };
 
 #endif // CUSTOMSORTFILTERPROXYMODEL_H
@@ -1,8 +1,11 @@
 #include "customtableview.h"
 
+#include <QAbstractProxyModel>
 #include <QKeyEvent>
 #include <QMouseEvent>
 
+#include <functional>
+
 CustomTableView::CustomTableView(QWidget *parent)
     : QTableView(parent)
 {
@@ -17,27 +20,12 @@ void CustomTableView::keyPressEvent(QKeyEvent *event)
     }
     else if(event->key() == Qt::Key_Delete)
     {
-        QModelIndexList selected_rows = selectionModel()->selectedRows();
-        if(selected_rows.count() > 0)
-        {
-            std::sort(selected_rows.begin(), selected_rows.end(), [](const QModelIndex &a, const QModelIndex &b)
-            {
-                return a.row() > b.row();
-            });
-
-            setSortingEnabled(false);
-            for(const QModelIndex &index : selected_rows)
-            {
-                model()->removeRow(index.row());
-            }
-
-            setSortingEnabled(true);
-        }
+        removeSelectedRows();
         return;
     }
     else if(event->matches(QKeySequence::Copy))
     {
-        emit copyRequested(this, false, false);
+        emit copyRequested(this);
         return;
     }
     else if(event->key() == Qt::Key_Alt)
@@ -48,6 +36,47 @@ void CustomTableView::keyPressEvent(QKeyEvent *event)
         QTableView::keyPressEvent(event);
 }
 
+// adjacent source rows are removed with one removeRows call, a sorted or filtered selection
+// is mapped to the source model first, so its rows are grouped as they are stored
+void CustomTableView::removeSelectedRows()
+{
+    const QModelIndexList selected_rows = selectionModel()->selectedRows();
+    if(selected_rows.isEmpty())
+        return;
+
+    QAbstractProxyModel *proxy_model = qobject_cast<QAbstractProxyModel *>(model());
+    QAbstractItemModel *source_model = proxy_model ? proxy_model->sourceModel() : model();
+
+    QList<int> source_rows;
+    source_rows.reserve(selected_rows.size());
+    for(const QModelIndex &index : selected_rows)
+        source_rows.append(proxy_model ? proxy_model->mapToSource(index).row() : index.row());
+
+    // bottom up, so the rows of the remaining ranges don't move
+    std::sort(source_rows.begin(), source_rows.end(), std::greater<int>());
+
+    // the selection would otherwise be updated for every removed range
+    clearSelection();
+    setSortingEnabled(false);
+
+    qsizetype i = 0;
+    while(i < source_rows.size())
+    {
+        const int last = source_rows.at(i);
+        int first = last;
+
+        while(++i < source_rows.size() && source_rows.at(i) == first - 1)
+            --first;
+
+        source_model->removeRows(first, last - first + 1);
+    }
+
+    setSortingEnabled(true);
+
+    emit rowsDeleted(int(source_rows.size()));
+}
+
+
 void CustomTableView::keyReleaseEvent(QKeyEvent *event)
 {
     if(event->key() == Qt::Key_Alt)
@@ -12,7 +12,10 @@ public:
     explicit CustomTableView(QWidget *parent = nullptr);
 
 signals:
-    void copyRequested(QTableView *tableView, bool copy_headers, bool copy_to_file);
+    void copyRequested(QTableView *tableView);
+
+    // once per Delete, after all ranges are removed
+    void rowsDeleted(int count);
 
 protected:
     void keyPressEvent(QKeyEvent *event) override;
@@ -22,6 +25,8 @@ protected:
     void mouseMoveEvent(QMouseEvent *event) override;
 
 private:
+    void removeSelectedRows();
+
     bool middle_mouse_button_pressed = false;
     bool alt_key_pressed = false;
 };
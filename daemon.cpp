@@ -0,0 +1,397 @@
+#include "daemon.h"
+#include "fileprocessor.h"
+#include "hashdatabase.h"
+#include "knownhashloader.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QPointer>
+#include <QSet>
+#include <QSettings>
+#include <QThreadPool>
+#include <QtEndian>
+
+#include <cstdio>
+#include <cstring>
+
+
+static const qint64 MAX_MESSAGE_SIZE = 64 * 1024 * 1024;
+
+static const QStringList HASH_ALGORITHMS = {"MD5", "SHA1", "SHA256", "TREE", "SAMPLED", "SSDEEP", "ENTROPY"};
+
+
+// a socket that answers belongs to a running daemon, only a stale one may be removed
+static bool serverRunning(const QString &socket_name)
+{
+    QLocalSocket probe;
+    probe.connectToServer(socket_name);
+    if(!probe.waitForConnected(1000))
+        return false;
+
+    probe.disconnectFromServer();
+    return true;
+}
+
+
+// one request, the files that weren't answered from the cache are hashed by its own item processor
+struct Daemon::Batch
+{
+    QPointer<QLocalSocket> socket;
+    QJsonValue id;
+    QStringList paths;                              // in request order
+    QStringList algorithms;
+    QHash<QString, QHash<QString, HashResult>> results;
+    QHash<QString, QPair<qint64, qint64>> stats;    // path -> (size, modified) before hashing
+    ItemProcessor *processor = nullptr;
+    QElapsedTimer timer;
+};
+
+
+Daemon::Daemon(QObject *parent)
+    : QObject(parent),
+      server(new QLocalServer(this)),
+      fileProcessor(new FileProcessor()),
+      knownHashes(new HashDatabase())
+{
+    connect(server, &QLocalServer::newConnection, this, &Daemon::onNewConnection);
+}
+
+
+Daemon::~Daemon()
+{
+    delete fileProcessor;
+    delete knownHashes;
+}
+
+
+bool Daemon::requested(int argc, char *argv[])
+{
+    for(int i = 1; i < argc; ++i)
+    {
+        if(std::strcmp(argv[i], "--daemon") == 0)
+            return true;
+    }
+
+    return false;
+}
+
+
+int Daemon::start(const QStringList &arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Answers hash requests on a local socket, see daemon.h for the protocol.");
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption("daemon", "Run as a daemon."));
+    parser.addOption(QCommandLineOption({"s", "socket"}, "Socket name or path (default hashlookup).", "name", "hashlookup"));
+
+    if(!parser.parse(arguments))
+    {
+        std::fprintf(stderr, "%s\n", qPrintable(parser.errorText()));
+        return 2;
+    }
+
+    if(parser.isSet("help"))
+    {
+        std::fprintf(stdout, "%s", qPrintable(parser.helpText()));
+        return 0;
+    }
+
+    const QString socket_name = parser.value("socket");
+    if(serverRunning(socket_name))
+    {
+        std::fprintf(stderr, "A daemon is already running on %s\n", qPrintable(socket_name));
+        return 1;
+    }
+
+    QSettings settings(QCoreApplication::applicationDirPath() + "/db/settings.ini", QSettings::IniFormat);
+    sample_edge_size = settings.value("sample_mib", 1).toLongLong() * 1024 * 1024;
+    sample_block_count = qMax(0, settings.value("sample_blocks", 16).toInt());
+    tree_block_size = qMax(qint64(1), settings.value("tree_block_mib", 4).toLongLong()) * 1024 * 1024;
+    entropy_block_size = qMax(qint64(64), settings.value("entropy_block_kib", 1024).toLongLong()) * 1024;
+
+    // results of unchanged files, the cache starts over when it is full
+    max_cache_entries = qMax(0, settings.value("daemon_cache_entries", 100000).toInt());
+
+    // the rules are compiled and the known hash lists imported once, for every request
+    connect(fileProcessor, &FileProcessor::yaraError, this, [](const QString &error)
+    {
+        qWarning("Daemon: %s", qPrintable(error));
+    });
+    KnownHashLoader known_hash_loader;
+    connect(&known_hash_loader, &KnownHashLoader::knownHashesReady, this, [this](const QString &db_path)
+    {
+        if(!knownHashes->open(db_path))
+            qWarning("Daemon: unable to open known hash database %s", qPrintable(db_path));
+    });
+    fileProcessor->initializeYara();
+    known_hash_loader.load();
+
+    // idle pool threads would take their libmagic cookies with them
+    QThreadPool::globalInstance()->setExpiryTimeout(-1);
+
+    // loading took a while, another daemon may have started meanwhile
+    if(serverRunning(socket_name))
+    {
+        std::fprintf(stderr, "A daemon is already running on %s\n", qPrintable(socket_name));
+        return 1;
+    }
+
+    QLocalServer::removeServer(socket_name);
+    server->setSocketOptions(QLocalServer::UserAccessOption);
+
+    if(!server->listen(socket_name))
+    {
+        std::fprintf(stderr, "Can't listen on %s: %s\n", qPrintable(socket_name), qPrintable(server->errorString()));
+        return 1;
+    }
+
+    std::fprintf(stderr, "Listening on %s\n", qPrintable(server->fullServerName()));
+    return -1;
+}
+
+
+void Daemon::onNewConnection()
+{
+    while(QLocalSocket *socket = server->nextPendingConnection())
+    {
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]()
+        {
+            onReadyRead(socket);
+        });
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+    }
+}
+
+
+// complete messages are taken from the socket buffer, a partial one waits for more data
+void Daemon::onReadyRead(QLocalSocket *socket)
+{
+    while(socket->bytesAvailable() >= 4)
+    {
+        const QByteArray prefix = socket->peek(4);
+        const quint32 length = qFromBigEndian<quint32>(prefix.constData());
+
+        if(length > MAX_MESSAGE_SIZE)
+        {
+            qWarning("Daemon: message of %u bytes, closing the connection", length);
+            socket->abort();
+            return;
+        }
+
+        if(socket->bytesAvailable() < 4 + qint64(length))
+            return;
+
+        socket->skip(4);
+        handleRequest(socket, socket->read(length));
+    }
+}
+
+
+void Daemon::handleRequest(QLocalSocket *socket, const QByteArray &payload)
+{
+    QJsonParseError parse_error;
+    const QJsonObject request = QJsonDocument::fromJson(payload, &parse_error).object();
+
+    if(parse_error.error != QJsonParseError::NoError)
+    {
+        sendMessage(socket, QJsonObject{{"error", "invalid JSON: " + parse_error.errorString()}});
+        return;
+    }
+
+    Batch *batch = new Batch;
+    batch->socket = socket;
+    batch->id = request.value("id");
+    batch->timer.start();
+
+    QSet<QString> selected;
+    const QJsonArray algorithm_names = request.value("algorithms").toArray(QJsonArray{"sha256"});
+    for(const QJsonValue &name : algorithm_names)
+    {
+        const QString algorithm = name.toString().toUpper();
+        if(!HASH_ALGORITHMS.contains(algorithm))
+        {
+            sendMessage(socket, QJsonObject{{"id", batch->id}, {"error", "unknown algorithm: " + name.toString()}});
+            delete batch;
+            return;
+        }
+        selected.insert(algorithm);
+    }
+
+    for(const QString &algorithm : HASH_ALGORITHMS)
+    {
+        if(selected.contains(algorithm))
+            batch->algorithms.append(algorithm);
+    }
+    if(request.value("magic").toBool())
+        batch->algorithms.append("MAGIC");
+    if(request.value("yara").toBool())
+        batch->algorithms.append("YARA");
+
+    QStringList uncached_paths;
+    QSet<QString> seen;
+
+    for(const QJsonValue &value : request.value("paths").toArray())
+    {
+        const QString path = QFileInfo(value.toString()).absoluteFilePath();
+        if(value.toString().isEmpty() || seen.contains(path))
+            continue;
+
+        seen.insert(path);
+        batch->paths.append(path);
+
+        const QFileInfo file_info(path);
+        if(!file_info.isFile())
+        {
+            batch->results[path].insert("ERROR", HashResult{"ERROR", path, Digest(), "No such file", QString()});
+            continue;
+        }
+
+        const qint64 size = file_info.size();
+        const qint64 modified = file_info.lastModified().toMSecsSinceEpoch();
+        batch->stats.insert(path, qMakePair(size, modified));
+
+        // a cached file answers if it is unchanged and has everything asked for
+        const auto cached = cache.constFind(path);
+        bool hit = cached != cache.constEnd() && cached->size == size && cached->modified == modified;
+        for(int i = 0; hit && i < batch->algorithms.size(); ++i)
+            hit = cached->results.contains(batch->algorithms.at(i));
+
+        if(hit)
+            batch->results.insert(path, cached->results);
+        else
+            uncached_paths.append(path);
+    }
+
+    if(uncached_paths.isEmpty())
+    {
+        finishBatch(batch);
+        return;
+    }
+
+    // every request gets its own watcher, the work itself shares the global pool
+    batch->processor = new ItemProcessor(this);
+    batch->processor->setSampling(sample_edge_size, sample_block_count);
+    batch->processor->setTreeBlockSize(tree_block_size);
+    batch->processor->setEntropyBlockSize(entropy_block_size);
+    batch->processor->setYaraScanner(fileProcessor->yaraScanner());
+
+    connect(batch->processor, &ItemProcessor::resultReady, this, [batch](const HashResult &result)
+    {
+        batch->results[result.path].insert(result.algorithm, result);
+    });
+    connect(batch->processor, &ItemProcessor::processingFinished, this, [this, batch]()
+    {
+        finishBatch(batch);
+    });
+
+    batch->processor->startScanning(uncached_paths, batch->algorithms);
+}
+
+
+void Daemon::finishBatch(Batch *batch)
+{
+    if(batch->processor)
+        batch->processor->deleteLater();
+
+    QJsonArray results;
+
+    for(const QString &path : batch->paths)
+    {
+        const QHash<QString, HashResult> file_results = batch->results.value(path);
+        results.append(resultObject(path, file_results));
+
+        if(file_results.contains("ERROR") || !batch->stats.contains(path) || max_cache_entries == 0)
+            continue;
+
+        if(cache.size() >= max_cache_entries && !cache.contains(path))
+            cache.clear();
+
+        // later requests may ask for more algorithms, the entry collects them while the file is unchanged
+        CacheEntry &entry = cache[path];
+        const QPair<qint64, qint64> stat = batch->stats.value(path);
+        if(entry.size != stat.first || entry.modified != stat.second)
+        {
+            entry.results.clear();
+            entry.size = stat.first;
+            entry.modified = stat.second;
+        }
+        for(auto it = file_results.constBegin(); it != file_results.constEnd(); ++it)
+            entry.results.insert(it.key(), it.value());
+    }
+
+    if(batch->socket)
+    {
+        sendMessage(batch->socket, QJsonObject{
+            {"id", batch->id},
+            {"results", results},
+            {"seconds", batch->timer.elapsed() / 1000.0}
+        });
+    }
+
+    delete batch;
+}
+
+
+// digests as hex, the libmagic types, YARA matches and the worst known hash verdict of the digests
+QJsonObject Daemon::resultObject(const QString &path, const QHash<QString, HashResult> &results) const
+{
+    QJsonObject object{{"path", path}};
+
+    static const QHash<QString, QString> labels = {
+        {"TREE", "SHA256 Tree"},
+        {"SAMPLED", "Quick (sampled)"},
+        {"SSDEEP", "ssdeep"},
+        {"ENTROPY", "Entropy"},
+        {"MAGIC", "MIME type"}
+    };
+
+    int known_status = -1;
+
+    for(auto it = results.constBegin(); it != results.constEnd(); ++it)
+    {
+        const HashResult &result = it.value();
+
+        if(result.algorithm == "ERROR")
+        {
+            object.insert("error", result.value);
+            continue;
+        }
+
+        const QString label = labels.value(result.algorithm, result.algorithm);
+
+        if(result.algorithm == "ENTROPY")
+            object.insert(label, result.value.toDouble());
+        else
+            object.insert(label, result.digest.isNull() ? result.value : result.digest.toHex());
+
+        if(result.algorithm == "MAGIC")
+            object.insert("Filetype", result.detail);
+
+        if(knownHashes->isOpen() && (result.algorithm == "MD5" || result.algorithm == "SHA1" || result.algorithm == "SHA256"))
+            known_status = qMax(known_status, int(knownHashes->lookup(result.digest.toRawByteArray())));
+    }
+
+    if(known_status != -1)
+        object.insert("Known", HashDatabase::statusText(known_status));
+
+    return object;
+}
+
+
+void Daemon::sendMessage(QLocalSocket *socket, const QJsonObject &message)
+{
+    const QByteArray payload = QJsonDocument(message).toJson(QJsonDocument::Compact);
+
+    char prefix[4];
+    qToBigEndian<quint32>(quint32(payload.size()), prefix);
+
+    socket->write(prefix, 4);
+    socket->write(payload);
+}
@@ -0,0 +1,72 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include <QHash>
+#include <QJsonObject>
+#include <QObject>
+#include <QStringList>
+
+#include "itemprocessor.h"
+
+class FileProcessor;
+class HashDatabase;
+class QLocalServer;
+class QLocalSocket;
+
+// Long running mode, "HashLookup --daemon [--socket name]". Listens on a local socket (a Unix
+// domain socket, a named pipe on Windows) and keeps the YARA rules, the libmagic cookies of the
+// pool threads, the known hash database and the results of unchanged files between requests.
+//
+// Every message is a 4 byte big-endian length followed by that many bytes of UTF-8 JSON.
+// A request {"id": any, "paths": [...], "algorithms": ["md5", "sha256", ...], "magic": bool,
+// "yara": bool} is answered with {"id": any, "results": [{"path": ..., "SHA256": ..., "MIME type": ...,
+// "Filetype": ..., "YARA": ..., "Known": ..., "error": ...}, ...]}. Requests of a connection may be
+// pipelined, they are hashed concurrently in the shared thread pool and answered as they complete.
+class Daemon : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Daemon(QObject *parent = nullptr);
+    ~Daemon();
+
+    // true if "--daemon" is among the arguments, checked before any application object exists
+    static bool requested(int argc, char *argv[]);
+
+    // -1 while listening, the exit code if the arguments are unusable or the socket can't be opened
+    int start(const QStringList &arguments);
+
+private:
+    // results of a file, valid while its size and modification time stay the same
+    struct CacheEntry
+    {
+        qint64 size = -1;
+        qint64 modified = -1;
+        QHash<QString, HashResult> results;
+    };
+
+    struct Batch;
+
+    void onNewConnection();
+    void onReadyRead(QLocalSocket *socket);
+
+    void handleRequest(QLocalSocket *socket, const QByteArray &payload);
+    void finishBatch(Batch *batch);
+
+    QJsonObject resultObject(const QString &path, const QHash<QString, HashResult> &results) const;
+    static void sendMessage(QLocalSocket *socket, const QJsonObject &message);
+
+    QLocalServer *server;
+    FileProcessor *fileProcessor;       // loads the YARA rules and imports the known hash lists
+    HashDatabase *knownHashes;
+
+    QHash<QString, CacheEntry> cache;
+    int max_cache_entries;
+
+    qint64 sample_edge_size;
+    int sample_block_count;
+    qint64 tree_block_size;
+    qint64 entropy_block_size;
+};
+
+#endif // DAEMON_H
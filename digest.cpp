@@ -0,0 +1,155 @@
+#include "digest.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DIGEST_HEX_SSE2
+#endif
+
+
+Digest::Digest(const void *bytes, int size, bool sampled)
+    : m_size(quint8(qBound(0, size, MAX_SIZE))),
+      m_sampled(sampled)
+{
+    std::memcpy(m_bytes, bytes, m_size);
+}
+
+
+Digest Digest::fromHex(QStringView hex)
+{
+    bool sampled = hex.startsWith(u'~');
+    if(sampled)
+        hex = hex.mid(1);
+
+    if(hex.size() != 32 && hex.size() != 40 && hex.size() != 64)
+        return Digest();
+
+    Digest digest;
+    for(qsizetype i = 0; i < hex.size(); ++i)
+    {
+        char16_t c = hex.at(i).unicode();
+        int nibble;
+        if(c >= '0' && c <= '9')
+            nibble = c - '0';
+        else if(c >= 'a' && c <= 'f')
+            nibble = c - 'a' + 10;
+        else if(c >= 'A' && c <= 'F')
+            nibble = c - 'A' + 10;
+        else
+            return Digest();
+
+        digest.m_bytes[i / 2] |= uchar(i % 2 ? nibble : nibble << 4);
+    }
+
+    digest.m_size = quint8(hex.size() / 2);
+    digest.m_sampled = sampled;
+    return digest;
+}
+
+
+QString Digest::toHex() const
+{
+    if(isNull())
+        return QString();
+
+    const int prefix = m_sampled ? 1 : 0;
+    QString hex(prefix + 2 * m_size, Qt::Uninitialized);
+    char16_t *out = reinterpret_cast<char16_t *>(hex.data());
+
+    if(m_sampled)
+        out[0] = u'~';
+    encodeHex(m_bytes, m_size, out + prefix);
+
+    return hex;
+}
+
+
+QByteArray Digest::toHexLatin1() const
+{
+    if(isNull())
+        return QByteArray();
+
+    const int prefix = m_sampled ? 1 : 0;
+    QByteArray hex(prefix + 2 * m_size, Qt::Uninitialized);
+
+    if(m_sampled)
+        hex[0] = '~';
+    encodeHex(m_bytes, m_size, hex.data() + prefix);
+
+    return hex;
+}
+
+
+#ifdef DIGEST_HEX_SSE2
+// 16 bytes to 32 hex characters: split into nibbles, add '0' and the 'a' - '0' - 10 gap
+// for nibbles above 9, then interleave high and low nibbles
+static inline void hexNibbles(const uchar *bytes, __m128i &first, __m128i &second)
+{
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i zero = _mm_set1_epi8('0');
+    const __m128i gap = _mm_set1_epi8('a' - '0' - 10);
+
+    __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes));
+    __m128i high = _mm_and_si128(_mm_srli_epi16(input, 4), mask);
+    __m128i low = _mm_and_si128(input, mask);
+
+    high = _mm_add_epi8(_mm_add_epi8(high, zero), _mm_and_si128(_mm_cmpgt_epi8(high, nine), gap));
+    low = _mm_add_epi8(_mm_add_epi8(low, zero), _mm_and_si128(_mm_cmpgt_epi8(low, nine), gap));
+
+    first = _mm_unpacklo_epi8(high, low);
+    second = _mm_unpackhi_epi8(high, low);
+}
+#endif
+
+
+static const char hex_digits[] = "0123456789abcdef";
+
+void Digest::encodeHex(const uchar *bytes, int size, char16_t *out)
+{
+    int i = 0;
+
+#ifdef DIGEST_HEX_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for(; i + 16 <= size; i += 16)
+    {
+        __m128i first, second;
+        hexNibbles(bytes + i, first, second);
+
+        __m128i *target = reinterpret_cast<__m128i *>(out + 2 * i);
+        _mm_storeu_si128(target, _mm_unpacklo_epi8(first, zero));
+        _mm_storeu_si128(target + 1, _mm_unpackhi_epi8(first, zero));
+        _mm_storeu_si128(target + 2, _mm_unpacklo_epi8(second, zero));
+        _mm_storeu_si128(target + 3, _mm_unpackhi_epi8(second, zero));
+    }
+#endif
+
+    for(; i < size; ++i)
+    {
+        out[2 * i] = char16_t(hex_digits[bytes[i] >> 4]);
+        out[2 * i + 1] = char16_t(hex_digits[bytes[i] & 0x0f]);
+    }
+}
+
+
+void Digest::encodeHex(const uchar *bytes, int size, char *out)
+{
+    int i = 0;
+
+#ifdef DIGEST_HEX_SSE2
+    for(; i + 16 <= size; i += 16)
+    {
+        __m128i first, second;
+        hexNibbles(bytes + i, first, second);
+
+        __m128i *target = reinterpret_cast<__m128i *>(out + 2 * i);
+        _mm_storeu_si128(target, first);
+        _mm_storeu_si128(target + 1, second);
+    }
+#endif
+
+    for(; i < size; ++i)
+    {
+        out[2 * i] = hex_digits[bytes[i] >> 4];
+        out[2 * i + 1] = hex_digits[bytes[i] & 0x0f];
+    }
+}
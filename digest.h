@@ -0,0 +1,63 @@
+#ifndef DIGEST_H
+#define DIGEST_H
+
+#include <QByteArray>
+#include <QHashFunctions>
+#include <QMetaType>
+#include <QString>
+
+#include <cstring>
+
+// A digest of up to 32 bytes kept as raw bytes. Hex text is only produced on demand,
+// for display, the clipboard and exports. Unused bytes stay zero, so equality is
+// a fixed 32 byte compare.
+class Digest
+{
+public:
+    static const int MAX_SIZE = 32;
+
+    Digest() = default;
+    Digest(const void *bytes, int size, bool sampled = false);
+
+    // 32, 40 or 64 hex characters, a leading "~" marks a sampled fingerprint
+    static Digest fromHex(QStringView hex);
+
+    bool isNull() const { return m_size == 0; }
+    int size() const { return m_size; }
+    bool isSampled() const { return m_sampled; }
+    const uchar *constData() const { return m_bytes; }
+
+    // shares the digest bytes, valid as long as this digest lives
+    QByteArray toRawByteArray() const { return QByteArray::fromRawData(reinterpret_cast<const char *>(m_bytes), m_size); }
+
+    QString toHex() const;
+    QByteArray toHexLatin1() const;
+
+    // writes 2 * size lowercase hex characters
+    static void encodeHex(const uchar *bytes, int size, char16_t *out);
+    static void encodeHex(const uchar *bytes, int size, char *out);
+
+    friend bool operator==(const Digest &left, const Digest &right)
+    {
+        return left.m_size == right.m_size && left.m_sampled == right.m_sampled
+               && std::memcmp(left.m_bytes, right.m_bytes, MAX_SIZE) == 0;
+    }
+    friend bool operator!=(const Digest &left, const Digest &right) { return !(left == right); }
+
+    // the digest bytes are already uniformly distributed
+    friend size_t qHash(const Digest &digest, size_t seed = 0) noexcept
+    {
+        quint64 head;
+        std::memcpy(&head, digest.m_bytes, sizeof(head));
+        return qHash(head ^ digest.m_size, seed);
+    }
+
+private:
+    uchar m_bytes[MAX_SIZE] = {};
+    quint8 m_size = 0;
+    bool m_sampled = false;
+};
+
+Q_DECLARE_METATYPE(Digest)
+
+#endif // DIGEST_H
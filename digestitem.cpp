@@ -0,0 +1,43 @@
+#include "digestitem.h"
+
+
+DigestItem::DigestItem(const Digest &digest)
+    : m_digest(digest)
+{
+}
+
+
+QVariant DigestItem::data(int role) const
+{
+    if(!m_digest.isNull())
+    {
+        if(role == Qt::DisplayRole || role == Qt::EditRole)
+            return m_digest.toHex();
+        if(role == DigestRole)
+            return QVariant::fromValue(m_digest);
+    }
+
+    return QStandardItem::data(role);
+}
+
+
+// replacing the text turns the cell into a plain text cell
+void DigestItem::setData(const QVariant &value, int role)
+{
+    if(role == Qt::DisplayRole || role == Qt::EditRole)
+        m_digest = Digest();
+
+    QStandardItem::setData(value, role);
+}
+
+
+QStandardItem *DigestItem::clone() const
+{
+    return new DigestItem(m_digest);
+}
+
+
+Digest DigestItem::digest(const QModelIndex &index)
+{
+    return index.data(DigestRole).value<Digest>();
+}
@@ -0,0 +1,29 @@
+#ifndef DIGESTITEM_H
+#define DIGESTITEM_H
+
+#include <QStandardItem>
+
+#include "digest.h"
+
+// Table cell holding a raw digest, the hex text is formatted whenever the cell is read.
+// DigestRole returns the Digest itself, so duplicate and hash list checks compare bytes.
+class DigestItem : public QStandardItem
+{
+public:
+    static const int DigestRole = Qt::UserRole + 1;
+
+    explicit DigestItem(const Digest &digest);
+
+    QVariant data(int role = Qt::UserRole + 1) const override;
+    void setData(const QVariant &value, int role = Qt::UserRole + 1) override;
+    QStandardItem *clone() const override;
+    int type() const override { return QStandardItem::UserType + 1; }
+
+    // the digest of an index, null for text cells
+    static Digest digest(const QModelIndex &index);
+
+private:
+    Digest m_digest;
+};
+
+#endif // DIGESTITEM_H
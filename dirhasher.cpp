@@ -0,0 +1,256 @@
+#include "dirhasher.h"
+
+#include <QCryptographicHash>
+#include <QFileInfo>
+#include <QSet>
+
+
+// stands in for the digest of an unreadable file, no real digest has this length
+static const QByteArray FAILED_DIGEST("unreadable");
+
+
+void DirHasher::clear()
+{
+    m_directories.clear();
+    m_roots.clear();
+}
+
+
+void DirHasher::addRoot(const QString &root_path)
+{
+    QString path = QFileInfo(root_path).absoluteFilePath();
+
+    if(m_roots.contains(path))
+        return;
+
+    m_roots.append(path);
+    m_directories.insert(path, Directory());
+}
+
+
+void DirHasher::addFile(const QString &file_path)
+{
+    QFileInfo file_info(file_path);
+    QString dir_path = file_info.absolutePath();
+
+    if(root(dir_path).isEmpty())
+        return;
+
+    registerDir(dir_path);
+
+    Directory &dir = m_directories[dir_path];
+    if(!dir.files.contains(file_info.fileName()))
+    {
+        dir.files.insert(file_info.fileName(), QByteArray());
+        ++dir.pending;
+    }
+}
+
+
+void DirHasher::registerDir(const QString &dir_path)
+{
+    if(m_directories.contains(dir_path))
+        return;
+
+    QFileInfo dir_info(dir_path);
+    QString parent_path = dir_info.absolutePath();
+
+    m_directories[dir_path].parent = parent_path;
+
+    registerDir(parent_path);
+
+    Directory &parent = m_directories[parent_path];
+    parent.subdirs.insert(dir_info.fileName(), QByteArray());
+    ++parent.pending;
+}
+
+
+QStringList DirHasher::setFileDigest(const QString &file_path, const QByteArray &digest)
+{
+    QStringList completed;
+
+    QFileInfo file_info(file_path);
+    auto it = m_directories.find(file_info.absolutePath());
+    if(it == m_directories.end())
+        return completed;
+
+    Directory &dir = it.value();
+    auto file_it = dir.files.find(file_info.fileName());
+    if(file_it == dir.files.end() || !file_it.value().isEmpty())
+        return completed;
+
+    // deep copy, the caller may pass raw data it doesn't own
+    file_it.value() = QByteArray(digest.constData(), digest.size());
+
+    if(--dir.pending == 0)
+        completeDir(it.key(), completed);
+
+    return completed;
+}
+
+
+QStringList DirHasher::setFileFailed(const QString &file_path)
+{
+    QStringList completed;
+
+    QFileInfo file_info(file_path);
+    auto it = m_directories.find(file_info.absolutePath());
+    if(it == m_directories.end())
+        return completed;
+
+    Directory &dir = it.value();
+    auto file_it = dir.files.find(file_info.fileName());
+    if(file_it == dir.files.end() || !file_it.value().isEmpty())
+        return completed;
+
+    file_it.value() = FAILED_DIGEST;
+    dir.failed = true;
+
+    if(--dir.pending == 0)
+        completeDir(it.key(), completed);
+
+    return completed;
+}
+
+
+void DirHasher::completeDir(const QString &dir_path, QStringList &completed)
+{
+    Directory &dir = m_directories[dir_path];
+
+    QCryptographicHash dir_hash(QCryptographicHash::Sha256);
+
+    for(auto it = dir.files.constBegin(); it != dir.files.constEnd(); ++it)
+    {
+        dir_hash.addData("F");
+        dir_hash.addData(it.key().toUtf8());
+        dir_hash.addData(QByteArrayView("\0", 1));
+        dir_hash.addData(it.value());
+    }
+
+    for(auto it = dir.subdirs.constBegin(); it != dir.subdirs.constEnd(); ++it)
+    {
+        dir_hash.addData("D");
+        dir_hash.addData(it.key().toUtf8());
+        dir_hash.addData(QByteArrayView("\0", 1));
+        dir_hash.addData(it.value());
+    }
+
+    dir.hash = dir_hash.result();
+    completed.append(dir_path);
+
+    if(dir.parent.isEmpty())
+        return;
+
+    Directory &parent = m_directories[dir.parent];
+    parent.subdirs[QFileInfo(dir_path).fileName()] = dir.hash;
+    parent.failed = parent.failed || dir.failed;
+
+    if(--parent.pending == 0)
+        completeDir(dir.parent, completed);
+}
+
+
+QString DirHasher::hash(const QString &dir_path) const
+{
+    return QString::fromLatin1(m_directories.value(dir_path).hash.toHex());
+}
+
+
+QByteArray DirHasher::digest(const QString &dir_path) const
+{
+    return m_directories.value(dir_path).hash;
+}
+
+
+bool DirHasher::failed(const QString &dir_path) const
+{
+    return m_directories.value(dir_path).failed;
+}
+
+
+QString DirHasher::root(const QString &path) const
+{
+    for(const QString &root_path : m_roots)
+    {
+        if(path == root_path || path.startsWith(root_path.endsWith('/') ? root_path : root_path + "/"))
+            return root_path;
+    }
+    return QString();
+}
+
+
+QStringList DirHasher::roots() const
+{
+    return m_roots;
+}
+
+
+QString DirHasher::hashChain(const QString &file_path) const
+{
+    QString root_path = root(file_path);
+    if(root_path.isEmpty())
+        return QString();
+
+    QStringList chain;
+    QString dir_path = QFileInfo(file_path).absolutePath();
+
+    while(m_directories.contains(dir_path))
+    {
+        QString hex_hash = hash(dir_path);
+        chain.prepend(QFileInfo(dir_path).fileName() + "/: " + (hex_hash.isEmpty() ? "pending" : hex_hash) + (failed(dir_path) ? " (unreadable files)" : ""));
+
+        if(dir_path == root_path)
+            break;
+
+        dir_path = m_directories.value(dir_path).parent;
+    }
+
+    return chain.join("\n");
+}
+
+
+QStringList DirHasher::diff(const QString &left_root, const QString &right_root) const
+{
+    QStringList differences;
+    diffDirs(left_root, right_root, QString(), differences);
+    return differences;
+}
+
+
+void DirHasher::diffDirs(const QString &left_path, const QString &right_path, const QString &relative_path, QStringList &differences) const
+{
+    const Directory left = m_directories.value(left_path);
+    const Directory right = m_directories.value(right_path);
+
+    // unreadable files can't be compared, the same marker on both sides is no match
+    if(!left.hash.isEmpty() && left.hash == right.hash && !left.failed)
+        return;
+
+    QSet<QString> file_names;
+    for(auto it = left.files.constBegin(); it != left.files.constEnd(); ++it)
+        file_names.insert(it.key());
+    for(auto it = right.files.constBegin(); it != right.files.constEnd(); ++it)
+        file_names.insert(it.key());
+
+    for(const QString &name : file_names)
+    {
+        if(!left.files.contains(name) || !right.files.contains(name) || left.files.value(name) != right.files.value(name)
+            || left.files.value(name) == FAILED_DIGEST)
+            differences.append(relative_path + name);
+    }
+
+    QSet<QString> dir_names;
+    for(auto it = left.subdirs.constBegin(); it != left.subdirs.constEnd(); ++it)
+        dir_names.insert(it.key());
+    for(auto it = right.subdirs.constBegin(); it != right.subdirs.constEnd(); ++it)
+        dir_names.insert(it.key());
+
+    for(const QString &name : dir_names)
+    {
+        if(!left.subdirs.contains(name) || !right.subdirs.contains(name))
+            differences.append(relative_path + name + "/");
+        else if(left.subdirs.value(name) != right.subdirs.value(name) || left.subdirs.value(name).isEmpty()
+                 || m_directories.value(left_path + "/" + name).failed)
+            diffDirs(left_path + "/" + name, right_path + "/" + name, relative_path + name + "/", differences);
+    }
+}
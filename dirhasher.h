@@ -0,0 +1,56 @@
+#ifndef DIRHASHER_H
+#define DIRHASHER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+
+// Merkle hash over directory trees: a directory hash is the SHA256 over its sorted
+// (name, file digest) and (name, subdirectory hash) entries. Hashes are rolled up
+// bottom-up as soon as all file digests below a directory are known. A file that can't be
+// read enters with a fixed marker instead of its digest, its directory and all ancestors
+// still get a hash, but are flagged as failed.
+class DirHasher
+{
+public:
+    void clear();
+
+    void addRoot(const QString &root_path);
+    void addFile(const QString &file_path);
+
+    // returns the directories that got complete through this digest, innermost first
+    QStringList setFileDigest(const QString &file_path, const QByteArray &digest);
+    QStringList setFileFailed(const QString &file_path);
+
+    QString hash(const QString &dir_path) const;
+    QByteArray digest(const QString &dir_path) const;
+    bool failed(const QString &dir_path) const;       // an unreadable file lies below the directory
+    QString root(const QString &path) const;
+    QStringList roots() const;
+    QString hashChain(const QString &file_path) const;
+
+    // relative paths of all entries that differ between two trees, identical subtrees are skipped
+    QStringList diff(const QString &left_root, const QString &right_root) const;
+
+private:
+    struct Directory
+    {
+        QString parent;
+        QMap<QString, QByteArray> files;    // name -> digest, empty while pending
+        QMap<QString, QByteArray> subdirs;  // name -> directory hash, empty while pending
+        int pending = 0;
+        bool failed = false;
+        QByteArray hash;
+    };
+
+    void registerDir(const QString &dir_path);
+    void completeDir(const QString &dir_path, QStringList &completed);
+    void diffDirs(const QString &left_path, const QString &right_path, const QString &relative_path, QStringList &differences) const;
+
+    QHash<QString, Directory> m_directories;
+    QStringList m_roots;
+};
+
+#endif // DIRHASHER_H
@@ -0,0 +1,402 @@
+#include "dirwatcher.h"
+
+#include <QDateTime>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QTimer>
+
+#ifdef Q_OS_LINUX
+#include <QSocketNotifier>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#else
+#include <QFileSystemWatcher>
+#endif
+
+
+// a steady stream of events is still reported, at the latest after this many quiet periods
+static const int MAX_DELAY_PERIODS = 10;
+
+
+DirWatcher::DirWatcher(QObject *parent)
+    : QObject(parent),
+      quietTimer(nullptr),
+      quiet_ms(2000)
+{
+#ifdef Q_OS_LINUX
+    inotify_fd = -1;
+    notifier = nullptr;
+#else
+    watcher = nullptr;
+#endif
+}
+
+
+DirWatcher::~DirWatcher()
+{
+#ifdef Q_OS_LINUX
+    if(inotify_fd != -1)
+        close(inotify_fd);
+#endif
+}
+
+
+// the timer and the event source are created here, in the thread of the watcher
+void DirWatcher::watch(const QStringList &dir_paths, int quiet_ms)
+{
+    this->quiet_ms = quiet_ms;
+
+    if(!quietTimer)
+    {
+        quietTimer = new QTimer(this);
+        quietTimer->setSingleShot(true);
+        connect(quietTimer, &QTimer::timeout, this, &DirWatcher::settle);
+
+#ifdef Q_OS_LINUX
+        inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if(inotify_fd == -1)
+        {
+            qWarning("DirWatcher: inotify_init1(): %s", std::strerror(errno));
+            return;
+        }
+
+        notifier = new QSocketNotifier(inotify_fd, QSocketNotifier::Read, this);
+        connect(notifier, &QSocketNotifier::activated, this, &DirWatcher::onEvents);
+#else
+        watcher = new QFileSystemWatcher(this);
+        connect(watcher, &QFileSystemWatcher::directoryChanged, this, &DirWatcher::onDirectoryChanged);
+#endif
+    }
+
+    for(const QString &dir_path : dir_paths)
+    {
+        const QString clean_path = QDir::cleanPath(QFileInfo(dir_path).absoluteFilePath());
+        if(!dirs.contains(clean_path))
+            addDir(clean_path, nullptr);
+    }
+}
+
+
+void DirWatcher::clear()
+{
+    const QStringList dir_paths = dirs.keys();
+    for(const QString &dir_path : dir_paths)
+        removeWatch(dir_path);
+
+    dirs.clear();
+    dirty_dirs.clear();
+    dirty_files.clear();
+
+    if(quietTimer)
+        quietTimer->stop();
+}
+
+
+// walks the tree below a new directory, its files are reported as changed unless it is a root
+void DirWatcher::addDir(const QString &dir_path, QStringList *changed_paths)
+{
+    QStringList pending(dir_path);
+
+    while(!pending.isEmpty())
+    {
+        const QString current = pending.takeLast();
+        if(dirs.contains(current))
+            continue;
+
+        DirState &state = dirs[current];
+        addWatch(current);
+
+        // hidden files are left out like in a dropped directory, and like there symlinked
+        // directories aren't followed
+        QDirIterator it(current, QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot);
+        while(it.hasNext())
+        {
+            const QString path = it.next();
+            const QFileInfo info = it.fileInfo();
+
+            if(info.isDir())
+            {
+                if(info.isSymLink())
+                    continue;
+
+                state.subdirs.insert(path);
+                pending.append(path);
+                continue;
+            }
+
+            state.files.insert(info.fileName(), FileState{info.size(), info.lastModified().toMSecsSinceEpoch()});
+            if(changed_paths)
+                changed_paths->append(path);
+        }
+
+        const QString parent_path = QFileInfo(current).absolutePath();
+        if(dirs.contains(parent_path))
+            dirs[parent_path].subdirs.insert(current);
+    }
+}
+
+
+void DirWatcher::removeDir(const QString &dir_path, QStringList &removed_paths)
+{
+    QStringList pending(dir_path);
+
+    while(!pending.isEmpty())
+    {
+        const QString current = pending.takeLast();
+        const auto it = dirs.constFind(current);
+        if(it == dirs.constEnd())
+            continue;
+
+        for(auto file = it->files.constBegin(); file != it->files.constEnd(); ++file)
+            removed_paths.append(current + '/' + file.key());
+        pending.append(it->subdirs.values());
+
+        removeWatch(current);
+        dirs.erase(it);
+    }
+
+    const QString parent_path = QFileInfo(dir_path).absolutePath();
+    if(dirs.contains(parent_path))
+        dirs[parent_path].subdirs.remove(dir_path);
+}
+
+
+void DirWatcher::rescanDir(const QString &dir_path, QStringList &changed_paths, QStringList &removed_paths)
+{
+    if(!QFileInfo(dir_path).isDir())
+    {
+        removeDir(dir_path, removed_paths);
+        return;
+    }
+
+    QSet<QString> present_files;
+    QSet<QString> present_dirs;
+
+    QDirIterator it(dir_path, QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot);
+    while(it.hasNext())
+    {
+        const QString path = it.next();
+        const QFileInfo info = it.fileInfo();
+
+        if(info.isDir())
+        {
+            if(info.isSymLink())
+                continue;
+
+            present_dirs.insert(path);
+            if(!dirs.contains(path))
+                addDir(path, &changed_paths);
+            continue;
+        }
+
+        present_files.insert(info.fileName());
+
+        const FileState state{info.size(), info.lastModified().toMSecsSinceEpoch()};
+        DirState &dir = dirs[dir_path];
+        const auto known = dir.files.constFind(info.fileName());
+        if(known == dir.files.constEnd() || known->size != state.size || known->modified != state.modified)
+        {
+            dir.files.insert(info.fileName(), state);
+            changed_paths.append(path);
+        }
+    }
+
+    DirState &dir = dirs[dir_path];
+
+    for(auto file = dir.files.begin(); file != dir.files.end(); )
+    {
+        if(present_files.contains(file.key()))
+        {
+            ++file;
+            continue;
+        }
+
+        removed_paths.append(dir_path + '/' + file.key());
+        file = dir.files.erase(file);
+    }
+
+    const QSet<QString> gone_dirs = dir.subdirs - present_dirs;
+    for(const QString &subdir : gone_dirs)
+        removeDir(subdir, removed_paths);
+}
+
+
+void DirWatcher::checkFile(const QString &file_path, QStringList &changed_paths, QStringList &removed_paths)
+{
+    const QFileInfo info(file_path);
+    if(info.isHidden())
+        return;
+
+    const auto dir = dirs.find(info.absolutePath());
+    if(dir == dirs.end())
+        return;
+
+    if(info.isFile())
+    {
+        const FileState state{info.size(), info.lastModified().toMSecsSinceEpoch()};
+        const auto known = dir->files.constFind(info.fileName());
+        if(known == dir->files.constEnd() || known->size != state.size || known->modified != state.modified)
+        {
+            dir->files.insert(info.fileName(), state);
+            changed_paths.append(file_path);
+        }
+    }
+    else if(!info.exists() && dir->files.remove(info.fileName()) > 0)
+    {
+        removed_paths.append(file_path);
+    }
+}
+
+
+void DirWatcher::addWatch(const QString &dir_path)
+{
+#ifdef Q_OS_LINUX
+    if(inotify_fd == -1)
+        return;
+
+    const int watch_descriptor = inotify_add_watch(inotify_fd, QFile::encodeName(dir_path).constData(),
+                                                   IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE
+                                                   | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+
+    // ENOSPC means fs.inotify.max_user_watches is used up
+    if(watch_descriptor == -1)
+    {
+        qWarning("DirWatcher: inotify_add_watch(%s): %s", qPrintable(dir_path), std::strerror(errno));
+        return;
+    }
+
+    watch_dirs.insert(watch_descriptor, dir_path);
+    dir_watches.insert(dir_path, watch_descriptor);
+#else
+    if(watcher)
+        watcher->addPath(dir_path);
+#endif
+}
+
+
+void DirWatcher::removeWatch(const QString &dir_path)
+{
+#ifdef Q_OS_LINUX
+    const int watch_descriptor = dir_watches.take(dir_path);
+    if(watch_descriptor > 0)
+    {
+        // the watch of a deleted directory is already gone, the error doesn't matter then
+        inotify_rm_watch(inotify_fd, watch_descriptor);
+        watch_dirs.remove(watch_descriptor);
+    }
+#else
+    if(watcher)
+        watcher->removePath(dir_path);
+#endif
+}
+
+
+// files with a name in the event are checked on their own, directory events rescan the directory
+void DirWatcher::onEvents()
+{
+#ifdef Q_OS_LINUX
+    alignas(inotify_event) char buffer[64 * 1024];
+
+    forever
+    {
+        const ssize_t length = read(inotify_fd, buffer, sizeof(buffer));
+        if(length <= 0)
+            break;
+
+        for(const char *pos = buffer; pos < buffer + length; )
+        {
+            const inotify_event *event = reinterpret_cast<const inotify_event *>(pos);
+            pos += sizeof(inotify_event) + event->len;
+
+            // events were dropped, every directory has to be compared
+            if(event->mask & IN_Q_OVERFLOW)
+            {
+                for(auto it = dirs.constBegin(); it != dirs.constEnd(); ++it)
+                    dirty_dirs.insert(it.key());
+                continue;
+            }
+
+            const QString dir_path = watch_dirs.value(event->wd);
+            if(dir_path.isEmpty())
+                continue;
+
+            if(event->mask & IN_IGNORED)
+            {
+                watch_dirs.remove(event->wd);
+                if(dir_watches.value(dir_path) == event->wd)
+                    dir_watches.remove(dir_path);
+                continue;
+            }
+
+            if((event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) || event->len == 0)
+            {
+                dirty_dirs.insert(dir_path);
+                continue;
+            }
+
+            // hidden entries are never part of the snapshot, their events change nothing
+            const QString path = dir_path + '/' + QFile::decodeName(event->name);
+            if(QFileInfo(path).isHidden())
+                continue;
+
+            if(event->mask & IN_ISDIR)
+                dirty_dirs.insert(dir_path);
+            else
+                dirty_files.insert(path);
+        }
+    }
+
+    schedule();
+#endif
+}
+
+
+void DirWatcher::onDirectoryChanged(const QString &dir_path)
+{
+    dirty_dirs.insert(dir_path);
+    schedule();
+}
+
+
+// every event restarts the quiet period, up to the maximum delay since the first pending event
+void DirWatcher::schedule()
+{
+    if(dirty_dirs.isEmpty() && dirty_files.isEmpty())
+        return;
+
+    if(!quietTimer->isActive())
+        pending_since.start();
+
+    if(pending_since.elapsed() < qint64(MAX_DELAY_PERIODS) * quiet_ms)
+        quietTimer->start(quiet_ms);
+}
+
+
+void DirWatcher::settle()
+{
+    QStringList changed_paths;
+    QStringList removed_paths;
+
+    const QSet<QString> rescan_dirs = dirty_dirs;
+    const QSet<QString> check_files = dirty_files;
+    dirty_dirs.clear();
+    dirty_files.clear();
+
+    for(const QString &dir_path : rescan_dirs)
+    {
+        if(dirs.contains(dir_path))
+            rescanDir(dir_path, changed_paths, removed_paths);
+    }
+
+    for(const QString &file_path : check_files)
+    {
+        if(!rescan_dirs.contains(QFileInfo(file_path).absolutePath()))
+            checkFile(file_path, changed_paths, removed_paths);
+    }
+
+    if(!changed_paths.isEmpty() || !removed_paths.isEmpty())
+        emit filesChanged(changed_paths, removed_paths);
+}
@@ -0,0 +1,81 @@
+#ifndef DIRWATCHER_H
+#define DIRWATCHER_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+
+class QFileSystemWatcher;
+class QSocketNotifier;
+class QTimer;
+
+// Keeps dropped directory trees under watch from its own thread. Events only mark files and
+// directories dirty, after a quiet period they are compared with a snapshot of sizes and
+// modification times, and every created or modified and every deleted file of the period is
+// reported in one signal. Uses inotify on Linux and QFileSystemWatcher elsewhere.
+class DirWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DirWatcher(QObject *parent = nullptr);
+    ~DirWatcher();
+
+signals:
+    void startWatching(const QStringList &dir_paths, int quiet_ms);
+    void stopWatching();
+
+    void filesChanged(const QStringList &changed_paths, const QStringList &removed_paths);
+
+public slots:
+    // the files present now are taken as known, only later changes are reported
+    void watch(const QStringList &dir_paths, int quiet_ms);
+    void clear();
+
+private:
+    struct FileState
+    {
+        qint64 size;
+        qint64 modified;
+    };
+
+    struct DirState
+    {
+        QHash<QString, FileState> files;    // file name -> state
+        QSet<QString> subdirs;              // full paths
+    };
+
+    void addDir(const QString &dir_path, QStringList *changed_paths);
+    void removeDir(const QString &dir_path, QStringList &removed_paths);
+    void rescanDir(const QString &dir_path, QStringList &changed_paths, QStringList &removed_paths);
+    void checkFile(const QString &file_path, QStringList &changed_paths, QStringList &removed_paths);
+
+    void addWatch(const QString &dir_path);
+    void removeWatch(const QString &dir_path);
+
+    void onEvents();
+    void onDirectoryChanged(const QString &dir_path);
+    void schedule();
+    void settle();
+
+    QHash<QString, DirState> dirs;
+    QSet<QString> dirty_dirs;
+    QSet<QString> dirty_files;
+
+    QTimer *quietTimer;
+    QElapsedTimer pending_since;
+    int quiet_ms;
+
+#ifdef Q_OS_LINUX
+    int inotify_fd;
+    QSocketNotifier *notifier;
+    QHash<int, QString> watch_dirs;         // watch descriptor -> directory
+    QHash<QString, int> dir_watches;
+#else
+    QFileSystemWatcher *watcher;
+#endif
+};
+
+#endif // DIRWATCHER_H
@@ -3,15 +3,25 @@
 #include "libmagic/magic.h"
 
 #include <QCoreApplication>
+#include <QDateTime>
 #include <QDirIterator>
 #include <QFileInfo>
+#include <QSet>
 #include <QTemporaryFile>
 #include <QThread>
 
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
 
 FileProcessor::FileProcessor(QObject *parent) : QObject(parent)
 {
-    file_list = new QHash<QString, QStringList>();
+    scanner = nullptr;
+    file_list = new QHash<int, QStringList>();
+    hardlink_list = new QHash<int, QList<int>>();
 }
 
 FileProcessor::~FileProcessor()
@@ -19,15 +29,21 @@ FileProcessor::~FileProcessor()
     if(file_list)
         delete file_list;
 
+    if(hardlink_list)
+        delete hardlink_list;
+
     yr_finalize();
     delete scanner;
 }
 
 
 
-void FileProcessor::processFiles(const QList<QUrl> &urls, bool yara)
+void FileProcessor::processFiles(const QList<QUrl> &urls, bool yara, const QSharedPointer<PathTable> &paths)
 {
+    path_table = paths;
     file_list->clear();
+    hardlink_list->clear();
+    inode_list.clear();
     yara_active = yara;
 
     // get file count
@@ -84,41 +100,165 @@ void FileProcessor::processFiles(const QList<QUrl> &urls, bool yara)
         }
     }
 
-    emit finishedProcessing(file_list);
+    emit finishedProcessing(file_list, hardlink_list);
+}
+
+
+void FileProcessor::loadManifest(const QString &manifest_path)
+{
+    this->manifest_path = manifest_path;
+    manifest_entries = Manifest::load(manifest_path);
+
+    if(manifest_entries.isEmpty())
+        qWarning() << "No digests to verify in" << manifest_path;
+
+    QSet<QString> algorithms;
+    for(const Manifest::Entry &entry : manifest_entries)
+        algorithms.insert(Manifest::algorithm(entry.digest));
+
+    emit manifestLoaded(algorithms.values());
+}
+
+
+// every entry becomes a row, missing files and files next to the manifest it doesn't list get their
+// state in the verify cell, the rest is hashed with only the algorithm of its digest afterwards
+void FileProcessor::verifyManifest(const QSharedPointer<PathTable> &paths)
+{
+    path_table = paths;
+    expected_digests.clear();
+    verify_paths.clear();
+    verify_algorithms.clear();
+
+    emit fileCountSum(manifest_entries.size());
+    file_counter = 0;
+
+    const QString manifest_dir = QFileInfo(manifest_path).absolutePath();
+    const QString manifest_file = QFileInfo(manifest_path).absoluteFilePath();
+    bool all_below_manifest = true;
+
+    QStringList empty_data;
+    for(int i = 0; i < Column::NUM_COLUMNS; ++i)
+        empty_data.append("");
+
+    QLocale locale;
+
+    for(const Manifest::Entry &entry : manifest_entries)
+    {
+        ++file_counter;
+        emit fileCount(file_counter);
+
+        // a path listed twice is verified against its first digest
+        const int path_id = path_table->add(entry.path);
+        if(expected_digests.contains(path_id))
+            continue;
+
+        expected_digests.insert(path_id, entry.digest);
+        all_below_manifest = all_below_manifest && entry.path.startsWith(manifest_dir + '/');
+
+        const QFileInfo file_info(entry.path);
+
+        QStringList data = empty_data;
+        data.replace(Column::FILENAME, file_info.fileName());
+        data.replace(Column::FILE_EXTENSION, file_info.suffix());
+
+        if(file_info.isFile())
+        {
+            data.replace(Column::FILESIZE, locale.toString(file_info.size()));
+            verify_paths.append(entry.path);
+            verify_algorithms.append(Manifest::algorithm(entry.digest));
+        }
+        else
+        {
+            data.replace(Column::VERIFY, QString::number(Manifest::Missing));
+        }
+
+        emit updateModel(path_id, data);
+    }
+
+    manifest_entries.clear();
+
+    // files next to the manifest it doesn't list, only looked for when the manifest describes its own directory
+    if(all_below_manifest)
+    {
+        QDirIterator it(manifest_dir, QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+        while(it.hasNext())
+        {
+            const QString file_path = it.next();
+            if(file_path == manifest_file || path_table->find(file_path) != -1)
+                continue;
+
+            const QFileInfo file_info = it.fileInfo();
+
+            QStringList data = empty_data;
+            data.replace(Column::FILENAME, file_info.fileName());
+            data.replace(Column::FILE_EXTENSION, file_info.suffix());
+            data.replace(Column::FILESIZE, locale.toString(file_info.size()));
+            data.replace(Column::VERIFY, QString::number(Manifest::Extra));
+
+            emit updateModel(path_table->add(file_path), data);
+        }
+    }
+
+    emit finishedVerifying(&expected_digests, &verify_paths, &verify_algorithms);
 }
 
 
-void FileProcessor::insertFileListData(QHash<QString, QStringList> &file_list, const QString &file_path)
+void FileProcessor::insertFileListData(QHash<int, QStringList> &file_list, const QString &file_path)
 {
     bool large_file_count = (file_count > 1000 ? true : false);
 
+    const int path_id = path_table->add(file_path);
+
+    // hardlinks and bind mounts of an already processed file only get their own
+    // name and path columns, everything else is taken over from the first path
+    FileId file_id;
+    if(getFileId(file_path, file_id))
+    {
+        if(inode_list.contains(file_id))
+        {
+            int first_path_id = inode_list.value(file_id);
+            QStringList linked_data = file_list.value(first_path_id);
+
+            QFileInfo file_info(file_path);
+
+            linked_data.replace(Column::FILENAME, file_info.fileName());
+            linked_data.replace(Column::FILE_EXTENSION, file_info.suffix());
+
+            (*hardlink_list)[first_path_id].append(path_id);
+
+            emit updateModel(path_id, linked_data);
+
+            ++file_counter;
+            emit fileCount(file_counter);
+            return;
+        }
+
+        inode_list.insert(file_id, path_id);
+    }
+
+    QStringList &data = file_list[path_id];
     for(int i = 0; i < Column::NUM_COLUMNS; ++i)
-        file_list[file_path].append("");
+        data.append("");
 
     QFileInfo file_info(file_path);
 
-    QString file_name = file_info.fileName();
-    file_list[file_path].replace(Column::FILENAME, file_name);
+    data.replace(Column::FILENAME, file_info.fileName());
 
     if(yara_active)
     {
-        file_list[file_path].replace(Column::YARA, scanner->scanFile(file_path));
+        data.replace(Column::YARA, scanner->scanFile(file_path));
     }
 
     QLocale locale;
-    file_list[file_path].replace(Column::FILESIZE, locale.toString(file_info.size()));
-
-    file_list[file_path].replace(Column::FILE_EXTENSION, file_info.suffix());
+    data.replace(Column::FILESIZE, locale.toString(file_info.size()));
 
-    file_list[file_path].replace(Column::MIMETYPE, getFileType(file_path, true));
+    data.replace(Column::FILE_EXTENSION, file_info.suffix());
 
-    file_list[file_path].replace(Column::FILETYPE, getFileType(file_path, false));
+    data.replace(Column::MIMETYPE, getFileType(file_path, true));
 
-    file_list[file_path].replace(Column::FULLPATH, file_path);
+    data.replace(Column::FILETYPE, getFileType(file_path, false));
 
-    file_list[file_path].replace(Column::DIRPATH, file_info.dir().dirName() + "/" + file_name);
-
-    emit updateModel(file_list[file_path]);
+    emit updateModel(path_id, data);
 
     ++file_counter;
     emit fileCount(file_counter);
@@ -128,6 +268,42 @@ void FileProcessor::insertFileListData(QHash<QString, QStringList> &file_list, c
 }
 
 
+bool FileProcessor::getFileId(const QString &file_path, FileId &file_id)
+{
+#ifdef Q_OS_WIN
+    HANDLE file_handle = CreateFileW(reinterpret_cast<LPCWSTR>(QDir::toNativeSeparators(file_path).utf16()),
+                                     0,
+                                     FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                     NULL,
+                                     OPEN_EXISTING,
+                                     FILE_FLAG_BACKUP_SEMANTICS,
+                                     NULL);
+
+    if(file_handle == INVALID_HANDLE_VALUE)
+        return false;
+
+    BY_HANDLE_FILE_INFORMATION file_information;
+    bool success = GetFileInformationByHandle(file_handle, &file_information);
+    CloseHandle(file_handle);
+
+    if(!success)
+        return false;
+
+    file_id.first = file_information.dwVolumeSerialNumber;
+    file_id.second = (static_cast<quint64>(file_information.nFileIndexHigh) << 32) | file_information.nFileIndexLow;
+#else
+    struct stat file_stat;
+    if(stat(QFile::encodeName(file_path).constData(), &file_stat) != 0)
+        return false;
+
+    file_id.first = static_cast<quint64>(file_stat.st_dev);
+    file_id.second = static_cast<quint64>(file_stat.st_ino);
+#endif
+
+    return true;
+}
+
+
 QString FileProcessor::getFileType(const QString file_path, const bool &mime_type)
 {
 // hacky workaround with a 64k temp file in Windows, because of libmagics file limit to 2GB on Windows...
@@ -275,4 +451,3 @@ void FileProcessor::loadAndCompileYaraRules(const QString &yara_dir_path)
     emit finishedLoadingYaraRules();
 }
 
-
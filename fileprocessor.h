@@ -4,9 +4,12 @@
 #include <QDir>
 #include <QHash>
 #include <QObject>
+#include <QSharedPointer>
 #include <QStandardItemModel>
 #include <QUrl>
 
+#include "manifest.h"
+#include "pathtable.h"
 #include "yaraprocessor.h"
 
 class FileProcessor : public QObject
@@ -16,19 +19,31 @@ public:
     explicit FileProcessor(QObject *parent = nullptr);
     ~FileProcessor();
 
+    // null until YARA is initialized, its rules are shared with the archive member scans
+    const YaraProcessor *yaraScanner() const { return scanner; }
+
 public slots:
-    void processFiles(const QList<QUrl> &urls, bool yara);
+    void processFiles(const QList<QUrl> &urls, bool yara, const QSharedPointer<PathTable> &paths);
+
+    // a manifest is parsed first, its rows are only added once the table is prepared for its algorithms
+    void loadManifest(const QString &manifest_path);
+    void verifyManifest(const QSharedPointer<PathTable> &paths);
 
     void initializeYara();
     void loadAndCompileYaraRules(const QString &yara_dir_path);
 
 
 signals:
-    void startProcessing(const QList<QUrl> &urls, bool yara);
+    void startProcessing(const QList<QUrl> &urls, bool yara, const QSharedPointer<PathTable> &paths);
     void fileCountSum(int count);
     void fileCount(int count);
-    void updateModel(const QStringList &data);
-    void finishedProcessing(const QHash<QString, QStringList> *file_list);
+    void updateModel(int path_id, const QStringList &data);
+    void finishedProcessing(const QHash<int, QStringList> *file_list, const QHash<int, QList<int>> *hardlink_list);
+
+    void startLoadingManifest(const QString &manifest_path);
+    void manifestLoaded(const QStringList &algorithms);     // empty if the manifest has no usable lines
+    void startVerifying(const QSharedPointer<PathTable> &paths);
+    void finishedVerifying(const QHash<int, Digest> *expected_digests, const QStringList *file_paths, const QStringList *file_algorithms);
 
     void startInitializingYara();
     void startLoadingCompilingYaraRules(const QString &yara_dir_path);
@@ -40,11 +55,24 @@ signals:
 
 
 private:
-    void insertFileListData(QHash<QString, QStringList> &file_list, const QString &file_path);
+    typedef QPair<quint64, quint64> FileId; // (device, inode) or (volume serial, file index) on Windows
+
+    void insertFileListData(QHash<int, QStringList> &file_list, const QString &file_path);
+    static bool getFileId(const QString &file_path, FileId &file_id);
 
     QString getFileType(const QString file_path, const bool &mime_type);
 
-    QHash<QString, QStringList> *file_list;
+    // keyed by path id, the path columns of the rows are left empty
+    QHash<int, QStringList> *file_list;
+    QHash<int, QList<int>> *hardlink_list;      // first seen path -> further paths of the same file
+    QHash<FileId, int> inode_list;
+    QSharedPointer<PathTable> path_table;
+
+    QString manifest_path;
+    QList<Manifest::Entry> manifest_entries;
+    QHash<int, Digest> expected_digests;        // path id -> digest listed in the manifest
+    QStringList verify_paths;                   // existing files to hash, with the algorithm of their digest
+    QStringList verify_algorithms;
 
     YaraProcessor *scanner;
     QDir yara_dir;
@@ -0,0 +1,702 @@
+#include "hashdatabase.h"
+
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTemporaryFile>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <memory>
+#include <queue>
+#include <vector>
+
+// file layout (little endian):
+//   header:    magic[8], table count (u32), reserved (u32)
+//   per table: digest length (u32), segment bits (u32), record count (u64),
+//              records offset (u64), directory offset (u64), fingerprints offset (u64)
+//   records:   sorted unique digests, each followed by one status byte
+//   directory: per filter segment seed (u64), block length (u32), reserved (u32), fingerprints offset (u64)
+
+static const char DB_MAGIC[8] = {'H', 'L', 'K', 'D', 'B', '1', 0, 0};
+static const qint64 HEADER_SIZE = 16;
+static const qint64 TABLE_HEADER_SIZE = 40;
+static const qint64 DIRECTORY_ENTRY_SIZE = 24;
+static const int DIGEST_LENGTHS[HashDatabase::TABLE_COUNT] = {16, 20, 32};
+
+static const size_t RUN_RECORDS = 8 * 1024 * 1024;  // records per sorted run while importing
+static const quint64 SEGMENT_KEYS = 4 * 1024 * 1024; // expected keys per xor filter segment
+static const qint64 PROGRESS_BYTES = 16 * 1024 * 1024; // list bytes between two progress reports
+
+
+namespace {
+
+template<int N>
+struct Record
+{
+    uchar digest[N];
+    uchar status;
+
+    bool operator<(const Record &other) const
+    {
+        return std::memcmp(digest, other.digest, N) < 0;
+    }
+};
+
+
+quint64 digestKey(const uchar *digest)
+{
+    return qFromBigEndian<quint64>(digest);
+}
+
+
+int segmentIndex(const quint64 &key, const int &segment_bits)
+{
+    return segment_bits == 0 ? 0 : int(key >> (64 - segment_bits));
+}
+
+
+quint64 mix64(quint64 hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+
+quint32 reduce(const quint32 &hash, const quint32 &range)
+{
+    return quint32((quint64(hash) * range) >> 32);
+}
+
+
+struct XorHashes
+{
+    quint32 h0;
+    quint32 h1;
+    quint32 h2;
+    uchar fingerprint;
+};
+
+
+XorHashes xorHashes(const quint64 &key, const quint64 &seed, const quint32 &block_length)
+{
+    quint64 hash = mix64(key + seed);
+
+    XorHashes hashes;
+    hashes.h0 = reduce(quint32(hash), block_length);
+    hashes.h1 = reduce(quint32((hash << 21) | (hash >> 43)), block_length) + block_length;
+    hashes.h2 = reduce(quint32((hash << 42) | (hash >> 22)), block_length) + 2 * block_length;
+    hashes.fingerprint = uchar(hash ^ (hash >> 32));
+    return hashes;
+}
+
+
+quint32 xorBlockLength(const size_t &key_count)
+{
+    return quint32((32 + size_t(1.23 * double(key_count)) + 2) / 3);
+}
+
+
+// xor8 filter construction (Graf, Lemire) by peeling the 3-hypergraph, keys must be unique
+bool buildXorFilter(const std::vector<quint64> &keys, const quint64 &seed, const quint32 &block_length, std::vector<uchar> &fingerprints)
+{
+    const size_t size = size_t(block_length) * 3;
+
+    std::vector<quint64> xor_masks(size, 0);
+    std::vector<quint32> counts(size, 0);
+
+    for(const quint64 &key : keys)
+    {
+        XorHashes hashes = xorHashes(key, seed, block_length);
+        xor_masks[hashes.h0] ^= key;
+        xor_masks[hashes.h1] ^= key;
+        xor_masks[hashes.h2] ^= key;
+        ++counts[hashes.h0];
+        ++counts[hashes.h1];
+        ++counts[hashes.h2];
+    }
+
+    std::vector<quint32> queue;
+    for(size_t i = 0; i < size; ++i)
+    {
+        if(counts[i] == 1)
+            queue.push_back(quint32(i));
+    }
+
+    std::vector<std::pair<quint64, quint32>> stack;
+    stack.reserve(keys.size());
+
+    while(!queue.empty())
+    {
+        quint32 index = queue.back();
+        queue.pop_back();
+
+        if(counts[index] != 1)
+            continue;
+
+        quint64 key = xor_masks[index];
+        stack.emplace_back(key, index);
+
+        XorHashes hashes = xorHashes(key, seed, block_length);
+        for(quint32 slot : {hashes.h0, hashes.h1, hashes.h2})
+        {
+            xor_masks[slot] ^= key;
+            if(--counts[slot] == 1)
+                queue.push_back(slot);
+        }
+    }
+
+    if(stack.size() != keys.size())
+        return false;
+
+    fingerprints.assign(size, 0);
+    for(auto it = stack.rbegin(); it != stack.rend(); ++it)
+    {
+        XorHashes hashes = xorHashes(it->first, seed, block_length);
+        fingerprints[it->second] = hashes.fingerprint ^ fingerprints[hashes.h0] ^ fingerprints[hashes.h1] ^ fingerprints[hashes.h2];
+    }
+
+    return true;
+}
+
+
+template<typename T>
+void appendLittleEndian(QByteArray &data, const T &value)
+{
+    T value_le = qToLittleEndian(value);
+    data.append(reinterpret_cast<const char *>(&value_le), sizeof(value_le));
+}
+
+
+int hexValue(const char &c)
+{
+    if(c >= '0' && c <= '9')
+        return c - '0';
+    if(c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if(c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+
+// one digest table while importing: sorted runs on disk, merged into records and filter
+template<int N>
+class TableBuilder
+{
+public:
+    bool add(const char *hex, const uchar &status, QString &error)
+    {
+        Record<N> record;
+        for(int i = 0; i < N; ++i)
+            record.digest[i] = uchar((hexValue(hex[2 * i]) << 4) | hexValue(hex[2 * i + 1]));
+        record.status = status;
+
+        m_run.push_back(record);
+        ++m_total;
+
+        if(m_run.size() >= RUN_RECORDS)
+            return flushRun(error);
+
+        return true;
+    }
+
+    bool finish(QString &error)
+    {
+        if(!m_run.empty() && !flushRun(error))
+            return false;
+
+        m_segment_bits = 0;
+        while(m_segment_bits < 24 && (m_total >> m_segment_bits) > SEGMENT_KEYS)
+            ++m_segment_bits;
+
+        if(!m_records.open() || !m_fingerprints.open())
+        {
+            error = "Unable to create temporary files";
+            return false;
+        }
+
+        for(auto &run : m_runs)
+            run->seek(0);
+
+        // k-way merge, equal digests keep the worst status (known bad wins)
+        auto greater = [](const std::pair<Record<N>, size_t> &a, const std::pair<Record<N>, size_t> &b) {
+            return b.first < a.first;
+        };
+        std::priority_queue<std::pair<Record<N>, size_t>, std::vector<std::pair<Record<N>, size_t>>, decltype(greater)> heap(greater);
+
+        for(size_t i = 0; i < m_runs.size(); ++i)
+        {
+            Record<N> record;
+            if(m_runs[i]->read(reinterpret_cast<char *>(&record), sizeof(record)) == sizeof(record))
+                heap.emplace(record, i);
+        }
+
+        bool has_pending = false;
+        Record<N> pending;
+
+        while(!heap.empty())
+        {
+            auto top = heap.top();
+            heap.pop();
+
+            Record<N> record;
+            if(m_runs[top.second]->read(reinterpret_cast<char *>(&record), sizeof(record)) == sizeof(record))
+                heap.emplace(record, top.second);
+
+            if(has_pending && std::memcmp(pending.digest, top.first.digest, N) == 0)
+            {
+                pending.status = qMax(pending.status, top.first.status);
+                continue;
+            }
+
+            if(has_pending && !writeRecord(pending, error))
+                return false;
+
+            pending = top.first;
+            has_pending = true;
+        }
+
+        if(has_pending && !writeRecord(pending, error))
+            return false;
+
+        m_runs.clear();
+
+        return finishSegments(1 << m_segment_bits, error);
+    }
+
+    int segmentBits() const { return m_segment_bits; }
+    quint64 recordCount() const { return m_record_count; }
+    const QByteArray &directory() const { return m_directory; }
+    QTemporaryFile &records() { return m_records; }
+    QTemporaryFile &fingerprints() { return m_fingerprints; }
+
+private:
+    bool flushRun(QString &error)
+    {
+        std::sort(m_run.begin(), m_run.end());
+
+        std::unique_ptr<QTemporaryFile> run(new QTemporaryFile());
+        if(!run->open())
+        {
+            error = "Unable to create temporary file";
+            return false;
+        }
+
+        qint64 size = qint64(m_run.size() * sizeof(Record<N>));
+        if(run->write(reinterpret_cast<const char *>(m_run.data()), size) != size)
+        {
+            error = "Unable to write temporary file";
+            return false;
+        }
+
+        m_runs.push_back(std::move(run));
+        m_run.clear();
+        return true;
+    }
+
+    bool writeRecord(const Record<N> &record, QString &error)
+    {
+        if(m_records.write(reinterpret_cast<const char *>(record.digest), N) != N
+            || !m_records.putChar(char(record.status)))
+        {
+            error = "Unable to write temporary file";
+            return false;
+        }
+        ++m_record_count;
+
+        quint64 key = digestKey(record.digest);
+        int segment = segmentIndex(key, m_segment_bits);
+
+        if(segment != m_segment && !finishSegments(segment, error))
+            return false;
+
+        // digests sharing their first 8 bytes share one filter key
+        if(m_keys.empty() || m_keys.back() != key)
+            m_keys.push_back(key);
+
+        return true;
+    }
+
+    // builds the filters of all segments before the given one
+    bool finishSegments(const int &next_segment, QString &error)
+    {
+        while(m_segment < next_segment)
+        {
+            quint32 block_length = xorBlockLength(m_keys.size());
+            std::vector<uchar> filter;
+
+            quint64 seed = 0x9e3779b97f4a7c15ULL * quint64(m_segment + 1);
+            int attempts = 0;
+            while(!buildXorFilter(m_keys, seed, block_length, filter))
+            {
+                seed = mix64(seed + 1);
+                if(++attempts == 100)
+                {
+                    error = "Unable to build hash filter";
+                    return false;
+                }
+            }
+
+            appendLittleEndian<quint64>(m_directory, seed);
+            appendLittleEndian<quint32>(m_directory, block_length);
+            appendLittleEndian<quint32>(m_directory, 0);
+            appendLittleEndian<quint64>(m_directory, quint64(m_fingerprints.pos()));
+
+            if(m_fingerprints.write(reinterpret_cast<const char *>(filter.data()), qint64(filter.size())) != qint64(filter.size()))
+            {
+                error = "Unable to write temporary file";
+                return false;
+            }
+
+            m_keys.clear();
+            ++m_segment;
+        }
+        return true;
+    }
+
+    std::vector<Record<N>> m_run;
+    std::vector<std::unique_ptr<QTemporaryFile>> m_runs;
+    quint64 m_total = 0;
+
+    int m_segment_bits = 0;
+    int m_segment = 0;
+    std::vector<quint64> m_keys;
+
+    QTemporaryFile m_records;
+    QTemporaryFile m_fingerprints;
+    quint64 m_record_count = 0;
+    QByteArray m_directory;
+};
+
+
+bool copyFile(QFile &source, QSaveFile &target)
+{
+    source.seek(0);
+    QByteArray buffer;
+    while(!(buffer = source.read(1024 * 1024)).isEmpty())
+    {
+        if(target.write(buffer) != buffer.size())
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+
+HashDatabase::~HashDatabase()
+{
+    close();
+}
+
+
+bool HashDatabase::open(const QString &db_path)
+{
+    close();
+
+    m_file.setFileName(db_path);
+    if(!m_file.open(QIODevice::ReadOnly) || m_file.size() < HEADER_SIZE + TABLE_COUNT * TABLE_HEADER_SIZE)
+    {
+        m_file.close();
+        return false;
+    }
+
+    m_data = m_file.map(0, m_file.size());
+    if(!m_data || std::memcmp(m_data, DB_MAGIC, sizeof(DB_MAGIC)) != 0
+        || qFromLittleEndian<quint32>(m_data + 8) != TABLE_COUNT)
+    {
+        close();
+        return false;
+    }
+
+    const quint64 file_size = quint64(m_file.size());
+
+    for(int i = 0; i < TABLE_COUNT; ++i)
+    {
+        const uchar *table_header = m_data + HEADER_SIZE + i * TABLE_HEADER_SIZE;
+
+        Table &table = m_tables[i];
+        table.digest_length = int(qFromLittleEndian<quint32>(table_header));
+        table.segment_bits = int(qFromLittleEndian<quint32>(table_header + 4));
+        table.record_count = qFromLittleEndian<quint64>(table_header + 8);
+
+        quint64 records_offset = qFromLittleEndian<quint64>(table_header + 16);
+        quint64 directory_offset = qFromLittleEndian<quint64>(table_header + 24);
+        quint64 fingerprints_offset = qFromLittleEndian<quint64>(table_header + 32);
+
+        if(table.digest_length != DIGEST_LENGTHS[i] || table.segment_bits > 24
+            || records_offset + table.record_count * quint64(table.digest_length + 1) > file_size
+            || directory_offset + (quint64(1) << table.segment_bits) * DIRECTORY_ENTRY_SIZE > file_size
+            || fingerprints_offset > file_size)
+        {
+            close();
+            return false;
+        }
+
+        // every segment's filter block has to lie within the file, lookups index it unchecked
+        const quint64 segment_count = quint64(1) << table.segment_bits;
+        for(quint64 segment = 0; segment < segment_count; ++segment)
+        {
+            const uchar *entry = m_data + directory_offset + segment * DIRECTORY_ENTRY_SIZE;
+            const quint64 block_length = qFromLittleEndian<quint32>(entry + 8);
+            const quint64 block_offset = qFromLittleEndian<quint64>(entry + 16);
+
+            if((table.record_count > 0 && block_length == 0) || block_offset > file_size
+                || fingerprints_offset + block_offset + 3 * block_length > file_size)
+            {
+                close();
+                return false;
+            }
+        }
+
+        table.records = m_data + records_offset;
+        table.directory = m_data + directory_offset;
+        table.fingerprints = m_data + fingerprints_offset;
+    }
+
+    return true;
+}
+
+
+void HashDatabase::close()
+{
+    if(m_data)
+        m_file.unmap(m_data);
+    m_data = nullptr;
+
+    if(m_file.isOpen())
+        m_file.close();
+
+    for(int i = 0; i < TABLE_COUNT; ++i)
+        m_tables[i] = Table();
+}
+
+
+bool HashDatabase::isOpen() const
+{
+    return m_data != nullptr;
+}
+
+
+quint64 HashDatabase::count() const
+{
+    quint64 total = 0;
+    for(int i = 0; i < TABLE_COUNT; ++i)
+        total += m_tables[i].record_count;
+    return total;
+}
+
+
+HashDatabase::Status HashDatabase::lookup(const QByteArray &digest) const
+{
+    if(!m_data)
+        return Unknown;
+
+    const Table *table = nullptr;
+    for(int i = 0; i < TABLE_COUNT; ++i)
+    {
+        if(m_tables[i].digest_length == digest.size())
+            table = &m_tables[i];
+    }
+
+    if(!table || table->record_count == 0)
+        return Unknown;
+
+    const uchar *digest_data = reinterpret_cast<const uchar *>(digest.constData());
+    const quint64 key = digestKey(digest_data);
+
+    // front filter
+    const uchar *entry = table->directory + segmentIndex(key, table->segment_bits) * DIRECTORY_ENTRY_SIZE;
+    quint64 seed = qFromLittleEndian<quint64>(entry);
+    quint32 block_length = qFromLittleEndian<quint32>(entry + 8);
+    const uchar *fingerprints = table->fingerprints + qFromLittleEndian<quint64>(entry + 16);
+
+    XorHashes hashes = xorHashes(key, seed, block_length);
+    if(hashes.fingerprint != (fingerprints[hashes.h0] ^ fingerprints[hashes.h1] ^ fingerprints[hashes.h2]))
+        return Unknown;
+
+    // confirm
+    const int record_size = table->digest_length + 1;
+    quint64 low = 0;
+    quint64 high = table->record_count;
+
+    while(low < high)
+    {
+        quint64 middle = low + (high - low) / 2;
+        const uchar *record = table->records + middle * record_size;
+
+        int compare = std::memcmp(record, digest_data, table->digest_length);
+        if(compare == 0)
+            return Status(record[table->digest_length]);
+        else if(compare < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return Unknown;
+}
+
+
+QString HashDatabase::statusText(const int &status)
+{
+    if(status == KnownBad)
+        return "known bad";
+    if(status == KnownGood)
+        return "known good";
+    return "unknown";
+}
+
+
+bool HashDatabase::import(const QStringList &good_list_paths, const QStringList &bad_list_paths, const QString &db_path, QString &error,
+                          const Progress &progress)
+{
+    TableBuilder<16> md5_table;
+    TableBuilder<20> sha1_table;
+    TableBuilder<32> sha256_table;
+
+    QList<QPair<QString, uchar>> sources;
+    for(const QString &path : good_list_paths)
+        sources.append(qMakePair(path, uchar(KnownGood)));
+    for(const QString &path : bad_list_paths)
+        sources.append(qMakePair(path, uchar(KnownBad)));
+
+    qint64 total_bytes = 0;
+    for(const auto &source : sources)
+        total_bytes += QFileInfo(source.first).size();
+
+    qint64 read_bytes = 0;
+    qint64 reported_bytes = 0;
+
+    for(const auto &source : sources)
+    {
+        QFile list_file(source.first);
+        if(!list_file.open(QIODevice::ReadOnly))
+        {
+            error = "Unable to open " + source.first;
+            return false;
+        }
+
+        QByteArray line;
+        while(!(line = list_file.readLine()).isEmpty())
+        {
+            read_bytes += line.size();
+            if(progress && read_bytes - reported_bytes >= PROGRESS_BYTES)
+            {
+                reported_bytes = read_bytes;
+                progress(read_bytes, total_bytes);
+            }
+
+            const char *data = line.constData();
+            const int size = line.size();
+
+            int start = 0;
+            while(start < size)
+            {
+                if(hexValue(data[start]) < 0)
+                {
+                    ++start;
+                    continue;
+                }
+
+                int end = start;
+                while(end < size && hexValue(data[end]) >= 0)
+                    ++end;
+
+                // hex runs that are directly attached to other word characters are no digests
+                bool delimited = (start == 0 || !std::isalnum(uchar(data[start - 1])))
+                                 && (end == size || !std::isalnum(uchar(data[end])));
+
+                bool ok = true;
+                if(delimited && end - start == 32)
+                    ok = md5_table.add(data + start, source.second, error);
+                else if(delimited && end - start == 40)
+                    ok = sha1_table.add(data + start, source.second, error);
+                else if(delimited && end - start == 64)
+                    ok = sha256_table.add(data + start, source.second, error);
+
+                if(!ok)
+                    return false;
+
+                start = end;
+            }
+        }
+    }
+
+    // all lists are read, the runs are merged and the filters built from here on
+    if(progress)
+        progress(total_bytes, total_bytes);
+
+    if(!md5_table.finish(error) || !sha1_table.finish(error) || !sha256_table.finish(error))
+        return false;
+
+    // layout: header, table headers, then records, directory and fingerprints per table
+    struct TableLayout
+    {
+        int digest_length;
+        int segment_bits;
+        quint64 record_count;
+        QTemporaryFile *records;
+        const QByteArray *directory;
+        QTemporaryFile *fingerprints;
+    };
+
+    TableLayout layouts[TABLE_COUNT] = {
+        {16, md5_table.segmentBits(), md5_table.recordCount(), &md5_table.records(), &md5_table.directory(), &md5_table.fingerprints()},
+        {20, sha1_table.segmentBits(), sha1_table.recordCount(), &sha1_table.records(), &sha1_table.directory(), &sha1_table.fingerprints()},
+        {32, sha256_table.segmentBits(), sha256_table.recordCount(), &sha256_table.records(), &sha256_table.directory(), &sha256_table.fingerprints()}
+    };
+
+    QByteArray header(DB_MAGIC, sizeof(DB_MAGIC));
+    appendLittleEndian<quint32>(header, TABLE_COUNT);
+    appendLittleEndian<quint32>(header, 0);
+
+    quint64 offset = HEADER_SIZE + TABLE_COUNT * TABLE_HEADER_SIZE;
+    for(const TableLayout &layout : layouts)
+    {
+        quint64 records_offset = offset;
+        quint64 directory_offset = records_offset + quint64(layout.records->size());
+        quint64 fingerprints_offset = directory_offset + quint64(layout.directory->size());
+        offset = fingerprints_offset + quint64(layout.fingerprints->size());
+
+        appendLittleEndian<quint32>(header, quint32(layout.digest_length));
+        appendLittleEndian<quint32>(header, quint32(layout.segment_bits));
+        appendLittleEndian<quint64>(header, layout.record_count);
+        appendLittleEndian<quint64>(header, records_offset);
+        appendLittleEndian<quint64>(header, directory_offset);
+        appendLittleEndian<quint64>(header, fingerprints_offset);
+    }
+
+    QSaveFile db_file(db_path);
+    if(!db_file.open(QIODevice::WriteOnly) || db_file.write(header) != header.size())
+    {
+        error = "Unable to write " + db_path;
+        return false;
+    }
+
+    for(const TableLayout &layout : layouts)
+    {
+        if(!copyFile(*layout.records, db_file)
+            || db_file.write(*layout.directory) != layout.directory->size()
+            || !copyFile(*layout.fingerprints, db_file))
+        {
+            db_file.cancelWriting();
+            error = "Unable to write " + db_path;
+            return false;
+        }
+    }
+
+    if(!db_file.commit())
+    {
+        error = "Unable to write " + db_path;
+        return false;
+    }
+
+    return true;
+}
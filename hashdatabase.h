@@ -0,0 +1,62 @@
+#ifndef HASHDATABASE_H
+#define HASHDATABASE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QStringList>
+
+#include <functional>
+
+// Known hash database for MD5, SHA1 and SHA256 reference sets (NSRL, in-house lists).
+// The lists are imported once into a sorted binary file, which is memory-mapped on open,
+// so nothing is parsed at startup. A segmented xor filter in front of every table
+// rejects unknown digests with three byte reads, hits are confirmed by binary search.
+class HashDatabase
+{
+public:
+    enum Status
+    {
+        Unknown = 0,
+        KnownGood = 1,
+        KnownBad = 2
+    };
+
+    ~HashDatabase();
+
+    bool open(const QString &db_path);
+    void close();
+    bool isOpen() const;
+
+    quint64 count() const;
+    Status lookup(const QByteArray &digest) const;
+
+    static QString statusText(const int &status);
+
+    // bytes of the lists read so far and in total, reported every few MiB
+    typedef std::function<void(qint64 read_bytes, qint64 total_bytes)> Progress;
+
+    // every 32, 40 or 64 character hex token of a line is imported, so NSRL csv files
+    // and plain one hash per line lists both work
+    static bool import(const QStringList &good_list_paths, const QStringList &bad_list_paths, const QString &db_path, QString &error,
+                       const Progress &progress = Progress());
+
+    static const int TABLE_COUNT = 3;
+
+private:
+    struct Table
+    {
+        int digest_length = 0;
+        int segment_bits = 0;
+        quint64 record_count = 0;
+        const uchar *records = nullptr;
+        const uchar *directory = nullptr;
+        const uchar *fingerprints = nullptr;
+    };
+
+    QFile m_file;
+    uchar *m_data = nullptr;
+    Table m_tables[TABLE_COUNT];
+};
+
+#endif // HASHDATABASE_H
@@ -1,13 +1,60 @@
 #include "itemprocessor.h"
+#include "archivereader.h"
+#include "treehasher.h"
+#include "yaraprocessor.h"
 #include "openssl/evp.h"
+#include "libmagic/magic.h"
+#include "fuzzy.h"
 
+#include <QBuffer>
+#include <QCoreApplication>
 #include <QtConcurrent>
+#include <QtEndian>
 #include <QTime>
 
+#include <cmath>
+#include <cstring>
+
+
+// libmagic reads no further than this into a file
+static const qint64 MAGIC_BYTES = 1024 * 1024;
+
+// loading magic.mgc costs far more than probing a file, so every worker thread keeps its own cookies
+struct MagicCookies
+{
+    magic_t mime = magic_open(MAGIC_MIME);
+    magic_t type = magic_open(MAGIC_NONE);
+
+    MagicCookies()
+    {
+        const QByteArray magic_mgc_path = (QCoreApplication::applicationDirPath() + "/db/magic.mgc").toLocal8Bit();
+        if(mime && magic_load(mime, magic_mgc_path.constData()) != 0)
+            qWarning() << "Failed to load magic database";
+        if(type && magic_load(type, magic_mgc_path.constData()) != 0)
+            qWarning() << "Failed to load magic database";
+    }
+
+    ~MagicCookies()
+    {
+        if(mime)
+            magic_close(mime);
+        if(type)
+            magic_close(type);
+    }
+};
+
+
+// shared by the files and the archive members a thread works on
+static MagicCookies &magicCookies()
+{
+    thread_local MagicCookies cookies;
+    return cookies;
+}
+
 
 ItemProcessor::ItemProcessor(QObject *parent)
     : QObject(parent)
-    , m_futureWatcher(new QFutureWatcher<QString>(this))
+    , m_futureWatcher(new QFutureWatcher<QList<HashResult>>(this))
 {
     connect(m_futureWatcher, &QFutureWatcher<void>::started, this, &ItemProcessor::onStarted);
     connect(m_futureWatcher, &QFutureWatcher<int>::resultReadyAt, this, &ItemProcessor::onResultReady);
@@ -21,21 +68,111 @@ ItemProcessor::~ItemProcessor()
 }
 
 
-void ItemProcessor::startProcessing(const QHash<QString, QStringList> *file_list, const bool &md5, const bool &sha1, const bool &sha256)
+void ItemProcessor::setSampling(const qint64 &edge_size, const int &block_count)
+{
+    m_options.sample_edge_size = edge_size;
+    m_options.sample_block_count = block_count;
+}
+
+
+void ItemProcessor::setTreeBlockSize(const qint64 &block_size)
+{
+    m_options.tree_block_size = block_size;
+}
+
+
+void ItemProcessor::setEntropyBlockSize(const qint64 &block_size)
+{
+    m_options.entropy_block_size = block_size;
+}
+
+
+void ItemProcessor::setArchives(const int &depth, const qint64 &max_member_size, const YaraProcessor *yara)
+{
+    m_options.archive_depth = depth;
+    m_options.archive_member_size = max_member_size;
+    m_options.yara = yara;
+}
+
+
+void ItemProcessor::setYaraScanner(const YaraProcessor *yara)
+{
+    m_options.yara = yara;
+}
+
+
+void ItemProcessor::startProcessing(const QStringList &file_paths, const bool &md5, const bool &sha1, const bool &sha256, const bool &sampled, const bool &tree, const bool &entropy, const bool &ssdeep)
 {
     m_item_list.clear();
 
-    for(auto it = file_list->constBegin(); it != file_list->constEnd(); ++it)
+    // digests and the byte histogram share one sequential read per file
+    QStringList stream_algorithms;
+    if(md5)
+        stream_algorithms << "MD5";
+    if(sha1)
+        stream_algorithms << "SHA1";
+    if(sha256)
+        stream_algorithms << "SHA256";
+    if(entropy)
+        stream_algorithms << "ENTROPY";
+    if(ssdeep)
+        stream_algorithms << "SSDEEP";
+
+    // archive members are held in memory, so they get the streamed digests and the sampled fingerprint
+    QStringList archive_algorithms = QStringList("ARCHIVE") + stream_algorithms;
+    if(sampled)
+        archive_algorithms << "SAMPLED";
+
+    for(const QString &file_path : file_paths)
     {
-        if(md5)
-            m_item_list.append(it.key() + "\t" + "MD5");
-        if(sha1)
-            m_item_list.append(it.key() + "\t" + "SHA1");
-        if(sha256)
-            m_item_list.append(it.key() + "\t" + "SHA256");
+        if(!stream_algorithms.isEmpty())
+            m_item_list.append(file_path + "\t" + stream_algorithms.join(","));
+        if(sampled)
+            m_item_list.append(file_path + "\t" + "SAMPLED");
+        if(tree)
+            m_item_list.append(file_path + "\t" + "TREE");
+        if(m_options.archive_depth > 0)
+            m_item_list.append(file_path + "\t" + archive_algorithms.join(","));
     }
 
-    QFuture<QString> future = QtConcurrent::mapped(m_item_list, ItemProcessor::processItem);
+    startFuture();
+}
+
+
+// one item per manifest entry with only the algorithm its expected digest was made with
+void ItemProcessor::startVerification(const QStringList &file_paths, const QStringList &algorithms)
+{
+    m_item_list.clear();
+    m_item_list.reserve(file_paths.size());
+
+    for(int i = 0; i < file_paths.size(); ++i)
+        m_item_list.append(file_paths.at(i) + "\t" + algorithms.at(i));
+
+    startFuture();
+}
+
+
+// one item per file with every algorithm, so the results of a file arrive together
+void ItemProcessor::startScanning(const QStringList &file_paths, const QStringList &algorithms)
+{
+    m_item_list.clear();
+    m_item_list.reserve(file_paths.size());
+
+    const QString file_algorithms = QStringList(QStringList("FILE") + algorithms).join(",");
+    for(const QString &file_path : file_paths)
+        m_item_list.append(file_path + "\t" + file_algorithms);
+
+    startFuture();
+}
+
+
+void ItemProcessor::startFuture()
+{
+    const Options options = m_options;
+
+    QFuture<QList<HashResult>> future = QtConcurrent::mapped(m_item_list, [options](const QString &item) {
+        return ItemProcessor::processItem(item, options);
+    });
     m_futureWatcher->setFuture(future);
 }
 
@@ -46,68 +183,415 @@ void ItemProcessor::onStarted()
 }
 
 
-QString ItemProcessor::processItem(const QString &arguments)
+// returns one result per requested algorithm
+QList<HashResult> ItemProcessor::processItem(const QString &arguments, const Options &options)
 {
     QStringList argument = arguments.split("\t");
     QString path = argument.at(0);
-    QString algorithm = argument.at(1);
+    QStringList algorithms = argument.at(1).split(",");
 
     QFile file(path);
     if(file.open(QIODevice::ReadOnly))
     {
-        QByteArray result = hashFile(file, algorithm);
-        QString hash_str = QString(result.toHex());
-        result.clear();
+        if(algorithms.first() == "SAMPLED")
+        {
+            // sampled fingerprints are marked so they can't be mistaken for a full digest
+            QByteArray result = sampleFile(file, options.sample_edge_size, options.sample_block_count);
+            return {HashResult{"SAMPLED", path, Digest(result.constData(), result.size(), true), QString(), QString()}};
+        }
+        else if(algorithms.first() == "TREE")
+        {
+            QByteArray result = TreeHasher::hashFile(path, options.tree_block_size);
+            return {HashResult{"TREE", path, Digest(result.constData(), result.size()), QString(), QString()}};
+        }
+        else if(algorithms.first() == "ARCHIVE")
+        {
+            return processArchive(file, algorithms.mid(1), options);
+        }
+        else if(algorithms.first() == "FILE")
+        {
+            return processFile(file, algorithms.mid(1), options);
+        }
+
+        return streamFile(file, path, algorithms, options);
+    }
+
+    // the digest items already report unreadable files
+    if(algorithms.first() == "ARCHIVE")
+        return {};
+
+    return {HashResult{"ERROR", path, Digest(), QString("Could't open file: %1").arg(path), QString()}};
+}
+
+
+// the streamed digests, fingerprints, libmagic types (MAGIC) and YARA matches of one file in one job
+QList<HashResult> ItemProcessor::processFile(QFile &file, const QStringList &algorithms, const Options &options)
+{
+    QStringList stream_algorithms = algorithms;
+    const bool sampled = stream_algorithms.removeAll("SAMPLED") > 0;
+    const bool tree = stream_algorithms.removeAll("TREE") > 0;
+    const bool magic = stream_algorithms.removeAll("MAGIC") > 0;
+    const bool yara = stream_algorithms.removeAll("YARA") > 0;
+
+    const QString path = file.fileName();
+    QList<HashResult> results;
+
+    if(!stream_algorithms.isEmpty())
+        results.append(streamFile(file, path, stream_algorithms, options));
+
+    if(sampled)
+    {
+        QByteArray result = sampleFile(file, options.sample_edge_size, options.sample_block_count);
+        results.append(HashResult{"SAMPLED", path, Digest(result.constData(), result.size(), true), QString(), QString()});
+    }
+
+    if(tree)
+    {
+        QByteArray result = TreeHasher::hashFile(path, options.tree_block_size);
+        results.append(HashResult{"TREE", path, Digest(result.constData(), result.size()), QString(), QString()});
+    }
+
+    if(magic)
+    {
+        const MagicCookies &cookies = magicCookies();
+
+        file.seek(0);
+        const QByteArray head = file.read(MAGIC_BYTES);
+
+        const char *mime_type = cookies.mime ? magic_buffer(cookies.mime, head.constData(), size_t(head.size())) : nullptr;
+        const char *file_type = cookies.type ? magic_buffer(cookies.type, head.constData(), size_t(head.size())) : nullptr;
+        results.append(HashResult{"MAGIC", path, Digest(), QString(mime_type ? mime_type : ""), QString(file_type ? file_type : "")});
+    }
+
+    if(yara && options.yara)
+        results.append(HashResult{"YARA", path, Digest(), options.yara->scanPath(path), QString()});
+
+    return results;
+}
+
+
+// every member of an archive is decompressed once, then hashed, probed by libmagic and
+// YARA scanned from memory. Its MEMBER result comes first, so the row exists for the rest.
+QList<HashResult> ItemProcessor::processArchive(QFile &file, const QStringList &algorithms, const Options &options)
+{
+    QList<HashResult> results;
+
+    if(ArchiveReader::format(file) == ArchiveReader::None)
+        return results;
+
+    const MagicCookies &cookies = magicCookies();
+
+    auto probe = [](magic_t cookie, const QByteArray &data)
+    {
+        const size_t size = size_t(qMin(qint64(data.size()), MAGIC_BYTES));
+        const char *file_type = cookie ? magic_buffer(cookie, data.constData(), size) : nullptr;
+        return file_type ? QString(file_type) : QString();
+    };
+
+    QStringList stream_algorithms = algorithms;
+    const bool sampled = stream_algorithms.removeAll("SAMPLED") > 0;
+
+    ArchiveReader::readMembers(file, file.fileName(), options.archive_depth, options.archive_member_size,
+                               [&](const QString &member_path, const QByteArray &data)
+    {
+        HashResult member{"MEMBER", member_path, Digest(), probe(cookies.mime, data), probe(cookies.type, data)};
+        member.size = data.size();
+        results.append(member);
+
+        if(options.yara)
+            results.append(HashResult{"YARA", member_path, Digest(), options.yara->scanData(data), QString()});
+
+        QBuffer buffer;
+        buffer.setData(data);
+        buffer.open(QIODevice::ReadOnly);
+
+        if(!stream_algorithms.isEmpty())
+            results.append(streamFile(buffer, member_path, stream_algorithms, options));
+
+        if(sampled)
+        {
+            QByteArray result = sampleFile(buffer, options.sample_edge_size, options.sample_block_count);
+            results.append(HashResult{"SAMPLED", member_path, Digest(result.constData(), result.size(), true), QString(), QString()});
+        }
+    });
+
+    return results;
+}
+
+
+QList<HashResult> ItemProcessor::streamFile(QIODevice &device, const QString &path, const QStringList &algorithms, const Options &options)
+{
+    const qint64 CHUNK_SIZE = 65536;
+    QByteArray buffer(CHUNK_SIZE, Qt::Uninitialized);
+    QList<HashResult> results;
+
+    QList<EVP_MD_CTX *> contexts;
+    QStringList digest_algorithms;
+
+    for(const QString &algorithm : algorithms)
+    {
+        const EVP_MD *md;
+        if(algorithm == "MD5")
+            md = EVP_md5();
+        else if(algorithm == "SHA1")
+            md = EVP_sha1();
+        else if(algorithm == "SHA256")
+            md = EVP_sha256();
+        else
+            continue;
+
+        EVP_MD_CTX *mdctx = EVP_MD_CTX_new();
+        if(mdctx == nullptr)
+        {
+            qWarning() << "mdctx == nullptr";
+            continue;
+        }
+
+        if(EVP_DigestInit_ex(mdctx, md, NULL) != 1)
+            qWarning() << "EVP_DigestInit_ex != 1";
+
+        contexts.append(mdctx);
+        digest_algorithms.append(algorithm);
+    }
+
+    fuzzy_state *ssdeep_state = nullptr;
+    if(algorithms.contains("SSDEEP"))
+    {
+        ssdeep_state = fuzzy_new();
+        if(ssdeep_state && fuzzy_set_total_input_length(ssdeep_state, device.size()) != 0)
+            qWarning() << "fuzzy_set_total_input_length != 0";
+    }
+
+    const bool entropy_active = algorithms.contains("ENTROPY");
+    const qint64 entropy_block_size = qMax(CHUNK_SIZE, options.entropy_block_size);
+
+    quint64 total_counts[256] = {0};
+    quint64 block_counts[256] = {0};
+    qint64 total_bytes = 0;
+    qint64 block_bytes = 0;
+    QList<double> block_entropies;
+
+    while(!device.atEnd())
+    {
+        // chunks never cross an entropy block boundary
+        qint64 read_size = entropy_active ? qMin(CHUNK_SIZE, entropy_block_size - block_bytes) : CHUNK_SIZE;
+        qint64 bytes_read = device.read(buffer.data(), read_size);
+        if(bytes_read <= 0)
+            break;
+
+        for(EVP_MD_CTX *mdctx : contexts)
+        {
+            if(EVP_DigestUpdate(mdctx, buffer.constData(), bytes_read) != 1)
+                qWarning() << "EVP_DigestUpdate != 1";
+        }
+
+        if(ssdeep_state && fuzzy_update(ssdeep_state, reinterpret_cast<const unsigned char *>(buffer.constData()), bytes_read) != 0)
+            qWarning() << "fuzzy_update != 0";
+
+        if(entropy_active)
+        {
+            countBytes(reinterpret_cast<const unsigned char *>(buffer.constData()), bytes_read, block_counts);
+            block_bytes += bytes_read;
+
+            if(block_bytes == entropy_block_size)
+            {
+                block_entropies.append(entropy(block_counts, block_bytes));
+                for(int i = 0; i < 256; ++i)
+                    total_counts[i] += block_counts[i];
+                total_bytes += block_bytes;
+
+                std::memset(block_counts, 0, sizeof(block_counts));
+                block_bytes = 0;
+            }
+        }
+    }
+
+    for(int i = 0; i < contexts.size(); ++i)
+    {
+        unsigned char hash[EVP_MAX_MD_SIZE];
+        unsigned int digest_lenth;
 
-        return algorithm + "\t" + hash_str + "\t" + path;
+        if(EVP_DigestFinal_ex(contexts.at(i), hash, &digest_lenth) != 1)
+            qWarning() << "VP_DigestFinal_ex != 1";
+
+        results.append(HashResult{digest_algorithms.at(i), path, Digest(hash, int(digest_lenth)), QString(), QString()});
+
+        EVP_MD_CTX_free(contexts.at(i));
     }
 
-    return QString("Error: Could't open file: %1").arg(path);
+    if(ssdeep_state)
+    {
+        char ssdeep_digest[FUZZY_MAX_RESULT];
+        QString value;
+        if(fuzzy_digest(ssdeep_state, ssdeep_digest, 0) == 0)
+            value = QString::fromLatin1(ssdeep_digest);
+
+        results.append(HashResult{"SSDEEP", path, Digest(), value, QString()});
+
+        fuzzy_free(ssdeep_state);
+    }
+
+    if(entropy_active)
+    {
+        if(block_bytes > 0)
+        {
+            block_entropies.append(entropy(block_counts, block_bytes));
+            for(int i = 0; i < 256; ++i)
+                total_counts[i] += block_counts[i];
+            total_bytes += block_bytes;
+        }
+
+        results.append(HashResult{"ENTROPY", path, Digest(),
+                                  QString::number(entropy(total_counts, total_bytes), 'f', 4),
+                                  entropyProfile(block_entropies)});
+    }
+
+    return results;
 }
 
 
-QByteArray ItemProcessor::hashFile(QFile &file, const QString &algorithm)
+// byte histogram with four interleaved sub-histograms, so that runs of equal bytes don't
+// serialize on a single counter and the 8 byte loads keep the loop free of per-byte reads
+void ItemProcessor::countBytes(const unsigned char *data, const qint64 &size, quint64 *counts)
 {
-    const int CHUNK_SIZE = 8192;
+    quint32 sub_counts[4][256] = {{0}};
+
+    qint64 i = 0;
+    for(; i + 8 <= size; i += 8)
+    {
+        quint64 word;
+        std::memcpy(&word, data + i, sizeof(word));
+
+        ++sub_counts[0][word & 0xff];
+        ++sub_counts[1][(word >> 8) & 0xff];
+        ++sub_counts[2][(word >> 16) & 0xff];
+        ++sub_counts[3][(word >> 24) & 0xff];
+        ++sub_counts[0][(word >> 32) & 0xff];
+        ++sub_counts[1][(word >> 40) & 0xff];
+        ++sub_counts[2][(word >> 48) & 0xff];
+        ++sub_counts[3][(word >> 56) & 0xff];
+    }
+
+    for(; i < size; ++i)
+        ++sub_counts[0][data[i]];
+
+    for(int byte = 0; byte < 256; ++byte)
+        counts[byte] += sub_counts[0][byte] + sub_counts[1][byte] + sub_counts[2][byte] + sub_counts[3][byte];
+}
+
+
+// shannon entropy in bits per byte (0.0 - 8.0)
+double ItemProcessor::entropy(const quint64 *counts, const qint64 &total)
+{
+    if(total <= 0)
+        return 0.0;
+
+    double result = 0.0;
+    for(int i = 0; i < 256; ++i)
+    {
+        if(counts[i] == 0)
+            continue;
+
+        double probability = double(counts[i]) / double(total);
+        result -= probability * std::log2(probability);
+    }
+
+    return result;
+}
+
+
+// block entropies as a sparkline of at most 64 characters, merged blocks keep their maximum
+QString ItemProcessor::entropyProfile(const QList<double> &block_entropies)
+{
+    static const QString levels = QString::fromUtf8("▁▂▃▄▅▆▇█");
+    const qsizetype max_length = 64;
+
+    QString profile;
+    const qsizetype length = qMin(max_length, block_entropies.size());
+
+    for(qsizetype i = 0; i < length; ++i)
+    {
+        qsizetype first = i * block_entropies.size() / length;
+        qsizetype last = (i + 1) * block_entropies.size() / length;
+
+        double value = 0.0;
+        for(qsizetype block = first; block < last; ++block)
+            value = qMax(value, block_entropies.at(block));
+
+        profile.append(levels.at(qBound(0, int(value), 7)));
+    }
+
+    return profile;
+}
+
+
+QByteArray ItemProcessor::sampleFile(QIODevice &device, const qint64 &edge_size, const int &block_count)
+{
+    const qint64 CHUNK_SIZE = 8192;
+    const qint64 BLOCK_SIZE = 65536;
     unsigned char buffer[CHUNK_SIZE];
-    QByteArray result;
-
-    const EVP_MD *md;
-    if(algorithm == "MD5")
-        md = EVP_md5();
-    else if(algorithm == "SHA1")
-        md = EVP_sha1();
-    else if(algorithm == "SHA256")
-        md = EVP_sha256();
+
+    const qint64 file_size = device.size();
+
+    QList<QPair<qint64, qint64>> ranges; // (offset, length)
+
+    if(file_size <= 2 * edge_size + block_count * BLOCK_SIZE)
+    {
+        ranges.append(qMakePair(qint64(0), file_size));
+    }
     else
-        md = nullptr;
+    {
+        ranges.append(qMakePair(qint64(0), edge_size));
 
-    if (md == nullptr)
-        return QByteArray();
+        const qint64 middle_size = file_size - 2 * edge_size;
+        for(int i = 0; i < block_count; ++i)
+        {
+            qint64 offset = edge_size + (middle_size - BLOCK_SIZE) * (i + 1) / (block_count + 1);
+            ranges.append(qMakePair(offset, BLOCK_SIZE));
+        }
+
+        ranges.append(qMakePair(file_size - edge_size, edge_size));
+    }
 
     EVP_MD_CTX *mdctx = EVP_MD_CTX_new();
     unsigned char hash[EVP_MAX_MD_SIZE];
     unsigned int digest_lenth;
 
-    if (mdctx == nullptr)
+    if(mdctx == nullptr)
+    {
         qWarning() << "mdctx == nullptr";
+        return QByteArray();
+    }
 
-
-    if (EVP_DigestInit_ex(mdctx, md, NULL) != 1)
+    if(EVP_DigestInit_ex(mdctx, EVP_sha256(), NULL) != 1)
         qWarning() << "EVP_DigestInit_ex != 1";
 
+    quint64 size_le = qToLittleEndian(quint64(file_size));
+    EVP_DigestUpdate(mdctx, &size_le, sizeof(size_le));
 
-    while(!file.atEnd())
+    for(const auto &range : ranges)
     {
-        qint64 bytes_read = file.read((char*)buffer, CHUNK_SIZE);
-        if(EVP_DigestUpdate(mdctx, buffer, bytes_read) != 1)
-            qWarning() << "EVP_DigestUpdate != 1";
+        if(!device.seek(range.first))
+            break;
+
+        qint64 remaining = range.second;
+        while(remaining > 0)
+        {
+            qint64 bytes_read = device.read((char*)buffer, qMin(remaining, CHUNK_SIZE));
+            if(bytes_read <= 0)
+                break;
+
+            if(EVP_DigestUpdate(mdctx, buffer, bytes_read) != 1)
+                qWarning() << "EVP_DigestUpdate != 1";
+
+            remaining -= bytes_read;
+        }
     }
 
     if(EVP_DigestFinal_ex(mdctx, hash, &digest_lenth) != 1)
         qWarning() << "VP_DigestFinal_ex != 1";
 
-    result = QByteArray(reinterpret_cast<char *>(hash), digest_lenth);
+    QByteArray result(reinterpret_cast<char *>(hash), digest_lenth);
 
     EVP_MD_CTX_free(mdctx);
 
@@ -116,8 +600,9 @@ QByteArray ItemProcessor::hashFile(QFile &file, const QString &algorithm)
 
 
 void ItemProcessor::onResultReady(int index) {
-    QString result = m_futureWatcher->resultAt(index);
-    emit resultReady(result);
+    const QList<HashResult> results = m_futureWatcher->resultAt(index);
+    for(const HashResult &result : results)
+        emit resultReady(result);
 }
 
 
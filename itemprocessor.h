@@ -6,6 +6,21 @@
 #include <QMultiHash>
 #include <QFile>
 
+#include "digest.h"
+
+class YaraProcessor;
+
+// one value computed for a file, digests stay binary until they are displayed
+struct HashResult
+{
+    QString algorithm;  // MD5, SHA1, SHA256, SAMPLED, TREE, SSDEEP, ENTROPY, MEMBER, MAGIC, YARA or ERROR
+    QString path;       // archive members have virtual paths like "outer.zip!/inner/file.exe"
+    Digest digest;
+    QString value;      // ssdeep, entropy, MIME type, YARA matches or the error message
+    QString detail;     // entropy profile or file type
+    qint64 size = -1;   // member size
+};
+
 class ItemProcessor : public QObject {
     Q_OBJECT
 public:
@@ -13,23 +28,53 @@ public:
 
     ~ItemProcessor();
 
-    void startProcessing(const QHash<QString, QStringList> *file_list, const bool &md5, const bool &sha1, const bool &sha256);
+    void startProcessing(const QStringList &file_paths, const bool &md5, const bool &sha1, const bool &sha256, const bool &sampled, const bool &tree, const bool &entropy, const bool &ssdeep);
+    void startVerification(const QStringList &file_paths, const QStringList &algorithms);
+    void startScanning(const QStringList &file_paths, const QStringList &algorithms);
+
+    void setSampling(const qint64 &edge_size, const int &block_count);
+    void setTreeBlockSize(const qint64 &block_size);
+    void setEntropyBlockSize(const qint64 &block_size);
+    void setArchives(const int &depth, const qint64 &max_member_size, const YaraProcessor *yara);
+    void setYaraScanner(const YaraProcessor *yara);
 
 signals:
     void processingFinished(const QString &results);
-    void resultReady(const QString result);
+    void resultReady(const HashResult &result);
 
 private:
-    static QString processItem(const QString &item);
-    static QByteArray hashFile(QFile &file, const QString &algorithm);
+    struct Options
+    {
+        qint64 sample_edge_size = 1024 * 1024;
+        int sample_block_count = 16;
+        qint64 tree_block_size = 4 * 1024 * 1024;
+        qint64 entropy_block_size = 1024 * 1024;
+        int archive_depth = 0;                          // 0 leaves archives closed
+        qint64 archive_member_size = 512 * 1024 * 1024;
+        const YaraProcessor *yara = nullptr;            // scans archive members and YARA items when set
+    };
+
+    static QList<HashResult> processItem(const QString &item, const Options &options);
+    static QList<HashResult> processFile(QFile &file, const QStringList &algorithms, const Options &options);
+    static QList<HashResult> processArchive(QFile &file, const QStringList &algorithms, const Options &options);
+    static QList<HashResult> streamFile(QIODevice &device, const QString &path, const QStringList &algorithms, const Options &options);
+    static QByteArray sampleFile(QIODevice &device, const qint64 &edge_size, const int &block_count);
+
+    static void countBytes(const unsigned char *data, const qint64 &size, quint64 *counts);
+    static double entropy(const quint64 *counts, const qint64 &total);
+    static QString entropyProfile(const QList<double> &block_entropies);
+
+    void startFuture();
 
     void onStarted();
     void onResultReady(int index);
     void onFinished();
 
     QStringList m_item_list;
-    QFutureWatcher<QString> *m_futureWatcher;
+    QFutureWatcher<QList<HashResult>> *m_futureWatcher;
     QElapsedTimer m_timer;
+
+    Options m_options;
 };
 
 #endif // ITEMPROCESSOR_H
@@ -0,0 +1,104 @@
+#include "knownhashloader.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include "hashdatabase.h"
+
+
+KnownHashLoader::KnownHashLoader(QObject *parent)
+    : QObject(parent)
+{
+}
+
+
+void KnownHashLoader::load()
+{
+    QString db_dir_path = QCoreApplication::applicationDirPath() + "/db";
+    QString db_path = db_dir_path + "/knownhashes.db";
+    QString record_path = db_dir_path + "/knownhashes.lists";
+
+    QStringList good_list_paths;
+    QStringList bad_list_paths;
+
+    for(const QString &status : {QString("good"), QString("bad")})
+    {
+        QDir list_dir(db_dir_path + "/known/" + status);
+
+        if(!list_dir.exists())
+            list_dir.mkpath(".");
+
+        QDirIterator it(list_dir.absolutePath(), QDir::NoDotAndDotDot | QDir::Files, QDirIterator::Subdirectories);
+
+        while(it.hasNext())
+            (status == "good" ? good_list_paths : bad_list_paths).append(it.next());
+    }
+
+    if(good_list_paths.isEmpty() && bad_list_paths.isEmpty())
+    {
+        QFile::remove(db_path);
+        QFile::remove(record_path);
+        return;
+    }
+
+    // sorted, so the record doesn't depend on the directory order
+    good_list_paths.sort();
+    bad_list_paths.sort();
+
+    const QString record = listRecord(good_list_paths, bad_list_paths);
+
+    QFile record_file(record_path);
+    const bool up_to_date = QFileInfo::exists(db_path) && record_file.open(QIODevice::ReadOnly)
+                            && QString::fromUtf8(record_file.readAll()) == record;
+    record_file.close();
+
+    if(!up_to_date)
+    {
+        // without a record, the next start tries again if this import fails
+        QFile::remove(record_path);
+
+        QString error;
+        const bool ok = HashDatabase::import(good_list_paths, bad_list_paths, db_path, error, [this](qint64 read_bytes, qint64 total_bytes)
+        {
+            emit importProgress(read_bytes, total_bytes);
+        });
+
+        emit importFinished(ok);
+
+        if(!ok)
+        {
+            qWarning() << "Unable to import known hashes:" << error;
+            return;
+        }
+
+        QSaveFile new_record(record_path);
+        if(!new_record.open(QIODevice::WriteOnly) || new_record.write(record.toUtf8()) < 0 || !new_record.commit())
+            qWarning() << "Unable to write" << record_path;
+    }
+
+    emit knownHashesReady(db_path);
+}
+
+
+// one line per list: status, size, modification time in ms and path
+QString KnownHashLoader::listRecord(const QStringList &good_list_paths, const QStringList &bad_list_paths)
+{
+    QString record;
+
+    for(const QString &status : {QString("good"), QString("bad")})
+    {
+        for(const QString &path : (status == "good" ? good_list_paths : bad_list_paths))
+        {
+            const QFileInfo info(path);
+            record += QString("%1\t%2\t%3\t%4\n").arg(status).arg(info.size()).arg(info.lastModified().toMSecsSinceEpoch()).arg(path);
+        }
+    }
+
+    return record;
+}
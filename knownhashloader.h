@@ -0,0 +1,34 @@
+#ifndef KNOWNHASHLOADER_H
+#define KNOWNHASHLOADER_H
+
+#include <QObject>
+#include <QStringList>
+
+// Imports the known hash lists dropped into db/known/good and db/known/bad, meant to run in
+// its own thread so drops are never queued behind a large import. The lists of the last
+// import are recorded with their sizes and modification times next to the database, which
+// is rebuilt only when that record no longer matches the lists.
+class KnownHashLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit KnownHashLoader(QObject *parent = nullptr);
+
+signals:
+    void startLoading();
+
+    // only sent when the lists changed and the database is rebuilt
+    void importProgress(qint64 read_bytes, qint64 total_bytes);
+    void importFinished(bool ok);
+
+    void knownHashesReady(const QString &db_path);
+
+public slots:
+    void load();
+
+private:
+    static QString listRecord(const QStringList &good_list_paths, const QStringList &bad_list_paths);
+};
+
+#endif // KNOWNHASHLOADER_H
@@ -1,9 +1,16 @@
+#include "commandline.h"
+#include "daemon.h"
 #include "widget.h"
 
 #include <QApplication>
 #include <QFontDatabase>
 #include <QFont>
 
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <cstdio>
+#endif
+
 
 QString readCSSFile(QString path)
 {
@@ -43,6 +50,39 @@ QString readCSSFile(QString path)
 
 int main(int argc, char *argv[])
 {
+    // headless runs get a core application, no window system is touched
+    if(CommandLine::requested(argc, argv))
+    {
+#ifdef Q_OS_WIN
+        // a windows subsystem program writes to the console it was started from only when attached to it
+        if(GetStdHandle(STD_OUTPUT_HANDLE) == nullptr && AttachConsole(ATTACH_PARENT_PROCESS))
+        {
+            std::freopen("CONOUT$", "w", stdout);
+            std::freopen("CONOUT$", "w", stderr);
+        }
+#endif
+        QCoreApplication a(argc, argv);
+
+        CommandLine command_line;
+        const int exit_code = command_line.start(a.arguments());
+        if(exit_code >= 0)
+            return exit_code;
+
+        return a.exec();
+    }
+
+    if(Daemon::requested(argc, argv))
+    {
+        QCoreApplication a(argc, argv);
+
+        Daemon daemon;
+        const int exit_code = daemon.start(a.arguments());
+        if(exit_code >= 0)
+            return exit_code;
+
+        return a.exec();
+    }
+
     QApplication a(argc, argv);
 
     QString css = readCSSFile(":/style/style.css");
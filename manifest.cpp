@@ -0,0 +1,219 @@
+#include "manifest.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+
+static const QStringList DIGEST_HEADERS = {"SHA256", "SHA1", "MD5"};    // strongest first
+
+
+// a relative path is relative to the manifest, like "sha256sum -c" run from its directory
+static QString resolvePath(const QDir &base, QString path)
+{
+    path = QDir::fromNativeSeparators(path);
+    if(path.startsWith("./"))
+        path.remove(0, 2);
+
+    return QDir::cleanPath(QDir::isAbsolutePath(path) ? path : base.absoluteFilePath(path));
+}
+
+
+bool Manifest::isManifest(const QString &file_path)
+{
+    const QFileInfo info(file_path);
+    if(!info.isFile())
+        return false;
+
+    const QString suffix = info.suffix().toLower();
+    const QString name = info.fileName().toLower();
+
+    if(suffix == "sha256" || suffix == "sha1" || suffix == "md5")
+        return true;
+
+    if(name == "sha256sums" || name == "sha1sums" || name == "md5sums" || name.endsWith("sums.txt"))
+        return true;
+
+    // a table export with the full path and at least one digest column
+    if(suffix == "tsv")
+    {
+        QFile file(file_path);
+        if(!file.open(QIODevice::ReadOnly))
+            return false;
+
+        const QStringList headers = QString::fromUtf8(file.readLine()).trimmed().split('\t');
+        if(!headers.contains("Fullpath"))
+            return false;
+
+        for(const QString &header : DIGEST_HEADERS)
+        {
+            if(headers.contains(header))
+                return true;
+        }
+    }
+
+    return false;
+}
+
+
+QList<Manifest::Entry> Manifest::load(const QString &file_path)
+{
+    QList<Entry> entries;
+
+    QFile file(file_path);
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        qWarning("Manifest: file.open(): %s", qPrintable(file.errorString()));
+        return entries;
+    }
+
+    const QDir base = QFileInfo(file_path).absoluteDir();
+
+    int path_column = -1;
+    int digest_column = -1;
+    bool tsv = false;
+
+    if(QFileInfo(file_path).suffix().compare("tsv", Qt::CaseInsensitive) == 0)
+    {
+        const QStringList headers = QString::fromUtf8(file.readLine()).trimmed().split('\t');
+        path_column = headers.indexOf("Fullpath");
+
+        for(const QString &header : DIGEST_HEADERS)
+        {
+            digest_column = headers.indexOf(header);
+            if(digest_column != -1)
+                break;
+        }
+
+        tsv = path_column != -1 && digest_column != -1;
+        if(!tsv)
+            return entries;
+    }
+
+    int skipped = 0;
+
+    while(!file.atEnd())
+    {
+        QString line = QString::fromUtf8(file.readLine());
+        while(line.endsWith('\n') || line.endsWith('\r'))
+            line.chop(1);
+
+        if(line.isEmpty() || line.startsWith('#'))
+            continue;
+
+        QString path;
+        Digest digest;
+
+        if(tsv)
+        {
+            const QStringList cells = line.split('\t');
+            path = cells.value(path_column);
+            digest = Digest::fromHex(cells.value(digest_column));    // "-" for rows without digest
+        }
+        else if(!parseChecksumLine(line, path, digest))
+        {
+            digest = Digest();
+        }
+
+        // sampled fingerprints can't be verified against a full hash
+        if(digest.isNull() || digest.isSampled() || path.isEmpty())
+        {
+            ++skipped;
+            continue;
+        }
+
+        entries.append({resolvePath(base, path), digest});
+    }
+
+    if(skipped > 0)
+        qWarning("Manifest: %d lines without a usable digest in %s", skipped, qPrintable(file_path));
+
+    return entries;
+}
+
+
+// "<hex>  <path>" or "<hex> *<path>" as written by sha256sum, "\<hex>  <path>" when the
+// path is escaped, and "SHA256 (<path>) = <hex>" as written by the BSD tools and --tag
+bool Manifest::parseChecksumLine(const QString &line, QString &path, Digest &digest)
+{
+    const qsizetype tag_end = line.indexOf(" (");
+    const qsizetype tag_digest = line.lastIndexOf(") = ");
+    if(tag_end > 0 && tag_digest > tag_end && DIGEST_HEADERS.contains(line.left(tag_end).toUpper().remove('-')))
+    {
+        path = line.mid(tag_end + 2, tag_digest - tag_end - 2);
+        digest = Digest::fromHex(QStringView(line).mid(tag_digest + 4));
+        return !digest.isNull();
+    }
+
+    const bool escaped = line.startsWith('\\');
+    const QStringView text = QStringView(line).mid(escaped ? 1 : 0);
+
+    const qsizetype space = text.indexOf(' ');
+    if(space <= 0 || space + 2 > text.size())
+        return false;
+
+    digest = Digest::fromHex(text.left(space));
+    if(digest.isNull())
+        return false;
+
+    // the second character is a space for text mode and a star for binary mode
+    const QStringView name = text.mid(space + 1);
+    path = (name.startsWith(u' ') || name.startsWith(u'*')) ? name.mid(1).toString() : name.toString();
+
+    if(escaped)
+    {
+        QString unescaped;
+        unescaped.reserve(path.size());
+        for(qsizetype i = 0; i < path.size(); ++i)
+        {
+            if(path.at(i) == '\\' && i + 1 < path.size())
+            {
+                const QChar next = path.at(++i);
+                unescaped.append(next == 'n' ? QChar('\n') : next == 'r' ? QChar('\r') : next);
+            }
+            else
+            {
+                unescaped.append(path.at(i));
+            }
+        }
+        path = unescaped;
+    }
+
+    return true;
+}
+
+
+QString Manifest::algorithm(const Digest &digest)
+{
+    switch(digest.size())
+    {
+    case 16:
+        return "MD5";
+    case 20:
+        return "SHA1";
+    case 32:
+        return "SHA256";
+    default:
+        return QString();
+    }
+}
+
+
+QString Manifest::statusText(Status status)
+{
+    switch(status)
+    {
+    case Verified:
+        return "OK";
+    case Mismatch:
+        return "MISMATCH";
+    case Missing:
+        return "MISSING";
+    case Extra:
+        return "EXTRA";
+    case Unreadable:
+        return "UNREADABLE";
+    }
+
+    return QString();
+}
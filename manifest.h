@@ -0,0 +1,35 @@
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include <QList>
+#include <QString>
+
+#include "digest.h"
+
+// Checksum manifests to verify against: sha256sum/sha1sum/md5sum output (GNU and BSD style)
+// and the table's own .tsv exports, which are read from their strongest digest column. Every
+// usable line is an entry, a path listed twice is verified against its first digest. Relative
+// paths are resolved against the directory of the manifest.
+class Manifest
+{
+public:
+    struct Entry
+    {
+        QString path;
+        Digest digest;
+    };
+
+    // row states of the verify column, also the values of the "verify = n" filter
+    enum Status { Verified, Mismatch, Missing, Extra, Unreadable };
+
+    static bool isManifest(const QString &file_path);
+    static QList<Entry> load(const QString &file_path);
+
+    static QString algorithm(const Digest &digest);    // MD5, SHA1 or SHA256 by digest size
+    static QString statusText(Status status);
+
+private:
+    static bool parseChecksumLine(const QString &line, QString &path, Digest &digest);
+};
+
+#endif // MANIFEST_H
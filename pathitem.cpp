@@ -0,0 +1,48 @@
+#include "pathitem.h"
+#include "pathtable.h"
+
+
+PathItem::PathItem(const PathTable *paths, int path_id, Format format)
+    : m_paths(paths),
+      m_path_id(path_id),
+      m_format(format)
+{
+}
+
+
+QVariant PathItem::data(int role) const
+{
+    if(m_path_id != -1)
+    {
+        if(role == Qt::DisplayRole || role == Qt::EditRole)
+            return m_format == FullPath ? m_paths->filePath(m_path_id) : m_paths->shortPath(m_path_id);
+        if(role == PathIdRole)
+            return m_path_id;
+    }
+
+    return QStandardItem::data(role);
+}
+
+
+// replacing the text turns the cell into a plain text cell
+void PathItem::setData(const QVariant &value, int role)
+{
+    if(role == Qt::DisplayRole || role == Qt::EditRole)
+        m_path_id = -1;
+
+    QStandardItem::setData(value, role);
+}
+
+
+QStandardItem *PathItem::clone() const
+{
+    return new PathItem(m_paths, m_path_id, m_format);
+}
+
+
+int PathItem::pathId(const QModelIndex &index)
+{
+    bool ok;
+    int path_id = index.data(PathIdRole).toInt(&ok);
+    return ok ? path_id : -1;
+}
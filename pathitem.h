@@ -0,0 +1,37 @@
+#ifndef PATHITEM_H
+#define PATHITEM_H
+
+#include <QStandardItem>
+
+class PathTable;
+
+// Fullpath and Dirpath cell that only keeps the id of its path in the shared path table,
+// the text is put together whenever the cell is read.
+class PathItem : public QStandardItem
+{
+public:
+    static const int PathIdRole = Qt::UserRole + 2;
+
+    enum Format
+    {
+        FullPath,
+        ShortPath   // "directory name/file name"
+    };
+
+    PathItem(const PathTable *paths, int path_id, Format format);
+
+    QVariant data(int role = Qt::UserRole + 1) const override;
+    void setData(const QVariant &value, int role = Qt::UserRole + 1) override;
+    QStandardItem *clone() const override;
+    int type() const override { return QStandardItem::UserType + 2; }
+
+    // the path id of an index, -1 for text cells
+    static int pathId(const QModelIndex &index);
+
+private:
+    const PathTable *m_paths;
+    int m_path_id;
+    Format m_format;
+};
+
+#endif // PATHITEM_H
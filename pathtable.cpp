@@ -0,0 +1,217 @@
+#include "pathtable.h"
+
+#include <QStringList>
+
+
+void PathTable::clear()
+{
+    QWriteLocker locker(&m_lock);
+
+    m_dirs.clear();
+    m_files.clear();
+    m_dir_ids.clear();
+    m_file_ids.clear();
+    m_last_dir_path.clear();
+    m_last_dir_id = -1;
+}
+
+
+int PathTable::add(const QString &file_path)
+{
+    QWriteLocker locker(&m_lock);
+
+    const qsizetype separator = file_path.lastIndexOf('/');
+    const QString name = file_path.mid(separator + 1);
+
+    int dir_id = -1;
+    if(separator >= 0)
+    {
+        const QString dir_path = file_path.left(separator);
+        if(m_last_dir_id == -1 || dir_path != m_last_dir_path)
+        {
+            m_last_dir_id = addDir(dir_path);
+            m_last_dir_path = dir_path;
+        }
+        dir_id = m_last_dir_id;
+    }
+
+    const Key key(dir_id, name);
+    auto it = m_file_ids.constFind(key);
+    if(it != m_file_ids.constEnd())
+        return it.value();
+
+    const int path_id = int(m_files.size());
+    m_files.append(Node{dir_id, name});
+    m_file_ids.insert(key, path_id);
+
+    return path_id;
+}
+
+
+int PathTable::find(const QString &file_path) const
+{
+    QReadLocker locker(&m_lock);
+
+    const qsizetype separator = file_path.lastIndexOf('/');
+
+    int dir_id = -1;
+    if(separator >= 0)
+    {
+        dir_id = findDir(file_path.left(separator));
+        if(dir_id == -1)
+            return -1;
+    }
+
+    return m_file_ids.value(Key(dir_id, file_path.mid(separator + 1)), -1);
+}
+
+
+int PathTable::fileCount() const
+{
+    QReadLocker locker(&m_lock);
+    return int(m_files.size());
+}
+
+
+int PathTable::dirCount() const
+{
+    QReadLocker locker(&m_lock);
+    return int(m_dirs.size());
+}
+
+
+QString PathTable::filePath(int path_id) const
+{
+    QReadLocker locker(&m_lock);
+
+    if(path_id < 0 || path_id >= m_files.size())
+        return QString();
+
+    const Node &file = m_files.at(path_id);
+    if(file.parent == -1)
+        return file.name;
+
+    return dirPathLocked(file.parent) + '/' + file.name;
+}
+
+
+QString PathTable::fileName(int path_id) const
+{
+    QReadLocker locker(&m_lock);
+    return (path_id < 0 || path_id >= m_files.size()) ? QString() : m_files.at(path_id).name;
+}
+
+
+QString PathTable::shortPath(int path_id) const
+{
+    QReadLocker locker(&m_lock);
+
+    if(path_id < 0 || path_id >= m_files.size())
+        return QString();
+
+    const Node &file = m_files.at(path_id);
+    if(file.parent == -1)
+        return file.name;
+
+    return m_dirs.at(file.parent).name + '/' + file.name;
+}
+
+
+int PathTable::dir(int path_id) const
+{
+    QReadLocker locker(&m_lock);
+    return (path_id < 0 || path_id >= m_files.size()) ? -1 : m_files.at(path_id).parent;
+}
+
+
+QString PathTable::dirPath(int dir_id) const
+{
+    QReadLocker locker(&m_lock);
+
+    if(dir_id < 0 || dir_id >= m_dirs.size())
+        return QString();
+
+    // the topmost directory of an absolute unix path has an empty name
+    QString dir_path = dirPathLocked(dir_id);
+    return dir_path.isEmpty() ? QString("/") : dir_path;
+}
+
+
+QString PathTable::dirName(int dir_id) const
+{
+    QReadLocker locker(&m_lock);
+    return (dir_id < 0 || dir_id >= m_dirs.size()) ? QString() : m_dirs.at(dir_id).name;
+}
+
+
+int PathTable::parentDir(int dir_id) const
+{
+    QReadLocker locker(&m_lock);
+    return (dir_id < 0 || dir_id >= m_dirs.size()) ? -1 : m_dirs.at(dir_id).parent;
+}
+
+
+int PathTable::findDir(const QString &dir_path) const
+{
+    int dir_id = -1;
+
+    const QStringList names = dir_path.split('/');
+    for(const QString &name : names)
+    {
+        dir_id = m_dir_ids.value(Key(dir_id, name), -1);
+        if(dir_id == -1)
+            break;
+    }
+
+    return dir_id;
+}
+
+
+int PathTable::addDir(const QString &dir_path)
+{
+    int dir_id = -1;
+
+    const QStringList names = dir_path.split('/');
+    for(const QString &name : names)
+    {
+        const Key key(dir_id, name);
+        auto it = m_dir_ids.constFind(key);
+        if(it != m_dir_ids.constEnd())
+        {
+            dir_id = it.value();
+            continue;
+        }
+
+        m_dirs.append(Node{dir_id, name});
+        dir_id = int(m_dirs.size()) - 1;
+        m_dir_ids.insert(key, dir_id);
+    }
+
+    return dir_id;
+}
+
+
+// joins the names from the topmost directory down, the inverse of splitting at '/'
+QString PathTable::dirPathLocked(int dir_id) const
+{
+    QList<int> chain;
+    qsizetype length = 0;
+
+    for(int id = dir_id; id != -1; id = m_dirs.at(id).parent)
+    {
+        chain.append(id);
+        length += m_dirs.at(id).name.size() + 1;
+    }
+
+    QString dir_path;
+    dir_path.reserve(length);
+
+    for(qsizetype i = chain.size() - 1; i >= 0; --i)
+    {
+        dir_path.append(m_dirs.at(chain.at(i)).name);
+        if(i > 0)
+            dir_path.append('/');
+    }
+
+    return dir_path;
+}
@@ -0,0 +1,59 @@
+#ifndef PATHTABLE_H
+#define PATHTABLE_H
+
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QReadWriteLock>
+#include <QString>
+
+// Interned file paths. Directories are nodes with a parent id and a name, every file keeps
+// the id of its directory and its leaf name, so a directory name is stored once no matter
+// how many files are below it. Full paths are put together when they are asked for.
+// Files are added on the file processor thread while the table shows them, hence the lock.
+class PathTable
+{
+public:
+    void clear();
+
+    // returns the id of the file, known paths keep their id
+    int add(const QString &file_path);
+    int find(const QString &file_path) const;     // -1 for unknown paths
+
+    int fileCount() const;
+    int dirCount() const;
+
+    QString filePath(int path_id) const;
+    QString fileName(int path_id) const;
+    QString shortPath(int path_id) const;         // "directory name/file name"
+    int dir(int path_id) const;
+
+    QString dirPath(int dir_id) const;
+    QString dirName(int dir_id) const;
+    int parentDir(int dir_id) const;              // -1 for the topmost directory
+
+private:
+    typedef QPair<int, QString> Key;              // (parent directory, name)
+
+    struct Node
+    {
+        int parent;
+        QString name;
+    };
+
+    int findDir(const QString &dir_path) const;
+    int addDir(const QString &dir_path);
+    QString dirPathLocked(int dir_id) const;
+
+    mutable QReadWriteLock m_lock;
+    QList<Node> m_dirs;
+    QList<Node> m_files;
+    QHash<Key, int> m_dir_ids;
+    QHash<Key, int> m_file_ids;
+
+    // directory iterators hand out the files of one directory in a row
+    QString m_last_dir_path;
+    int m_last_dir_id = -1;
+};
+
+#endif // PATHTABLE_H
@@ -0,0 +1,440 @@
+#include "searchindex.h"
+#include "Column.h"
+#include "tablesnapshot.h"
+
+#include <QHash>
+
+#include <algorithm>
+
+
+// a newer query cancels the digest scan after at most this many rows
+static const int CANCEL_CHECK_ROWS = 16384;
+
+
+static bool isDigestColumn(const int &column)
+{
+    return column == Column::MD5 || column == Column::SHA1 || column == Column::SHA256
+           || column == Column::TREEHASH || column == Column::SAMPLED || column == Column::SSDEEP
+           || column == Column::DIRHASH;
+}
+
+
+static quint64 trigramKey(const QChar *text)
+{
+    return (quint64(text[0].unicode()) << 32) | (quint64(text[1].unicode()) << 16) | quint64(text[2].unicode());
+}
+
+
+void SearchIndex::clear()
+{
+    m_row_count = 0;
+    m_snapshot.clear();
+
+    m_string_row_offsets.clear();
+    m_string_rows.clear();
+
+    m_trigrams.clear();
+    m_trigram_offsets.clear();
+    m_trigram_strings.clear();
+
+    m_prefixes.clear();
+    m_has_base64_digests = false;
+}
+
+
+void SearchIndex::build(const QSharedPointer<const TableSnapshot> &snapshot_pointer)
+{
+    clear();
+    m_snapshot = snapshot_pointer;
+
+    const TableSnapshot &snapshot = *m_snapshot;
+    m_row_count = snapshot.rowCount();
+
+    QHash<QString, quint32> string_ids;
+    std::vector<std::pair<quint32, quint32>> string_rows;    // (string id, row)
+    std::vector<std::pair<quint64, quint32>> trigram_strings; // (trigram, string id)
+
+    auto add_string = [&](const QString &text, const int &row)
+    {
+        if(text.isEmpty())
+            return;
+
+        auto it = string_ids.constFind(text);
+        quint32 id;
+
+        if(it != string_ids.constEnd())
+            id = it.value();
+        else
+        {
+            id = quint32(string_ids.size());
+            string_ids.insert(text, id);
+
+            const QString lower_text = text.toLower();
+            for(int i = 0; i + 2 < lower_text.size(); ++i)
+                trigram_strings.emplace_back(trigramKey(lower_text.constData() + i), id);
+        }
+
+        string_rows.emplace_back(id, quint32(row));
+    };
+
+    const int column_count = snapshot.columnCount();
+
+    for(int row = 0; row < m_row_count; ++row)
+    {
+        for(int col = 0; col < column_count; ++col)
+        {
+            // the dirpath column is part of the full path
+            if(col == Column::DIRPATH)
+                continue;
+
+            const QString &text = snapshot.text(row, col);
+            if(text.isEmpty() || text == "-")
+                continue;
+
+            if(isDigestColumn(col))
+            {
+                m_prefixes.push_back({prefixKey(text, 0), quint32(row)});
+                if(col == Column::SSDEEP)
+                    m_has_base64_digests = true;
+            }
+            else if(col == Column::FULLPATH)
+            {
+                // directories are shared by all their files, so paths are split up
+                int slash = text.lastIndexOf('/');
+                if(slash < 0)
+                    add_string(text, row);
+                else
+                {
+                    add_string(text.left(slash), row);
+                    add_string(text.mid(slash + 1), row);
+                }
+            }
+            else
+                add_string(text, row);
+        }
+    }
+
+    std::sort(string_rows.begin(), string_rows.end());
+    string_rows.erase(std::unique(string_rows.begin(), string_rows.end()), string_rows.end());
+
+    m_string_row_offsets.assign(string_ids.size() + 1, 0);
+    m_string_rows.reserve(string_rows.size());
+    for(const auto &pair : string_rows)
+    {
+        ++m_string_row_offsets[pair.first + 1];
+        m_string_rows.push_back(pair.second);
+    }
+    for(size_t i = 1; i < m_string_row_offsets.size(); ++i)
+        m_string_row_offsets[i] += m_string_row_offsets[i - 1];
+
+    std::sort(trigram_strings.begin(), trigram_strings.end());
+    trigram_strings.erase(std::unique(trigram_strings.begin(), trigram_strings.end()), trigram_strings.end());
+
+    m_trigram_strings.reserve(trigram_strings.size());
+    for(const auto &pair : trigram_strings)
+    {
+        if(m_trigrams.empty() || m_trigrams.back() != pair.first)
+        {
+            m_trigrams.push_back(pair.first);
+            m_trigram_offsets.push_back(quint32(m_trigram_strings.size()));
+        }
+        m_trigram_strings.push_back(pair.second);
+    }
+    m_trigram_offsets.push_back(quint32(m_trigram_strings.size()));
+
+    std::sort(m_prefixes.begin(), m_prefixes.end());
+}
+
+
+int SearchIndex::rowCount() const
+{
+    return m_row_count;
+}
+
+
+bool SearchIndex::candidates(const QString &query, Mode mode, QBitArray &rows, QPromise<QBitArray> &promise) const
+{
+    if(m_row_count == 0)
+        return false;
+
+    const bool plain = (mode == Wildcard) && !query.contains('*') && !query.contains('?')
+                       && !query.contains('[') && !query.contains('\\');
+
+    const QStringList literals = (mode == Regex) ? regexLiterals(query) : wildcardLiterals(query);
+    if(literals.isEmpty())
+        return false;
+
+    rows = QBitArray(m_row_count);
+
+    if(plain)
+    {
+        if(!textCandidates(literals, rows))
+            return false;
+
+        prefixCandidates(query, rows);
+        if(isHexQuery(query))
+            digestCandidates(query, rows, promise);
+        return true;
+    }
+
+    // a pattern that could match inside a digest has to be checked against every row
+    if(digestColumnsMayContain(literals))
+        return false;
+
+    return textCandidates(literals, rows);
+}
+
+
+void SearchIndex::trigramRows(const quint64 &trigram, QBitArray &rows) const
+{
+    auto it = std::lower_bound(m_trigrams.begin(), m_trigrams.end(), trigram);
+    if(it == m_trigrams.end() || *it != trigram)
+        return;
+
+    size_t index = size_t(it - m_trigrams.begin());
+    for(quint32 i = m_trigram_offsets[index]; i < m_trigram_offsets[index + 1]; ++i)
+    {
+        quint32 string_id = m_trigram_strings[i];
+        for(quint32 j = m_string_row_offsets[string_id]; j < m_string_row_offsets[string_id + 1]; ++j)
+            rows.setBit(int(m_string_rows[j]));
+    }
+}
+
+
+// rows containing all trigrams of the literals, false if the literals are too short
+bool SearchIndex::textCandidates(const QStringList &literals, QBitArray &rows) const
+{
+    QList<quint64> trigrams;
+
+    for(const QString &literal : literals)
+    {
+        const QString lower_literal = literal.toLower();
+        for(int i = 0; i + 2 < lower_literal.size(); ++i)
+        {
+            // trigrams across the directory/name split of a path are not indexed
+            const QChar *text = lower_literal.constData() + i;
+            if(text[0] == '/' || text[1] == '/' || text[2] == '/')
+                continue;
+
+            quint64 trigram = trigramKey(text);
+            if(!trigrams.contains(trigram))
+                trigrams.append(trigram);
+        }
+    }
+
+    if(trigrams.isEmpty())
+        return false;
+
+    QBitArray text_rows(m_row_count);
+    trigramRows(trigrams.first(), text_rows);
+
+    for(int i = 1; i < trigrams.size(); ++i)
+    {
+        QBitArray trigram_rows(m_row_count);
+        trigramRows(trigrams.at(i), trigram_rows);
+        text_rows &= trigram_rows;
+    }
+
+    rows |= text_rows;
+    return true;
+}
+
+
+void SearchIndex::prefixCandidates(const QString &query, QBitArray &rows) const
+{
+    PrefixEntry low = {prefixKey(query, 0x00), 0};
+    quint64 high = prefixKey(query, 0xff);
+
+    for(auto it = std::lower_bound(m_prefixes.begin(), m_prefixes.end(), low); it != m_prefixes.end() && it->key <= high; ++it)
+        rows.setBit(int(it->row));
+}
+
+
+// the digests are formatted one by one into a small buffer, no text of the cells is kept
+void SearchIndex::digestCandidates(const QString &query, QBitArray &rows, QPromise<QBitArray> &promise) const
+{
+    const QByteArray needle = query.toLatin1();
+    char hex[1 + 2 * Digest::MAX_SIZE];
+
+    for(int col = 0; col < m_snapshot->columnCount(); ++col)
+    {
+        if(!isDigestColumn(col))
+            continue;
+
+        for(int row = 0; row < m_row_count; ++row)
+        {
+            if(row % CANCEL_CHECK_ROWS == 0 && promise.isCanceled())
+                return;
+
+            if(rows.testBit(row))
+                continue;
+
+            const Digest digest = m_snapshot->digest(row, col);
+            if(digest.isNull())
+                continue;
+
+            int length = 0;
+            if(digest.isSampled())
+                hex[length++] = '~';
+            Digest::encodeHex(digest.constData(), digest.size(), hex + length);
+            length += 2 * digest.size();
+
+            if(QLatin1String(hex, length).contains(QLatin1String(needle), Qt::CaseInsensitive))
+                rows.setBit(row);
+        }
+    }
+}
+
+
+bool SearchIndex::digestColumnsMayContain(const QStringList &literals) const
+{
+    if(m_prefixes.empty())
+        return false;
+
+    // a match lies within one cell, so a single non digest character rules all digests out
+    for(const QString &literal : literals)
+    {
+        for(const QChar &c : literal)
+        {
+            bool hex = (c >= '0' && c <= '9') || (c.toLower() >= 'a' && c.toLower() <= 'f') || c == '~';
+            bool base64 = c.isLetterOrNumber() && c.unicode() < 128;
+
+            if(!hex && !(m_has_base64_digests && (base64 || c == '+' || c == '/' || c == ':')))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+
+QStringList SearchIndex::wildcardLiterals(const QString &pattern)
+{
+    QStringList literals;
+    QString literal;
+
+    for(int i = 0; i < pattern.size(); ++i)
+    {
+        const QChar c = pattern.at(i);
+
+        if(c == '*' || c == '?' || c == '\\' || c == '[')
+        {
+            if(!literal.isEmpty())
+                literals.append(literal);
+            literal.clear();
+
+            if(c == '[')
+            {
+                int end = pattern.indexOf(']', i + 2);
+                i = (end < 0) ? pattern.size() : end;
+            }
+        }
+        else
+            literal.append(c);
+    }
+
+    if(!literal.isEmpty())
+        literals.append(literal);
+
+    return literals;
+}
+
+
+// literal runs every match has to contain, empty for alternations
+QStringList SearchIndex::regexLiterals(const QString &pattern)
+{
+    QStringList literals;
+    QString literal;
+    int depth = 0;
+
+    auto flush = [&]()
+    {
+        if(!literal.isEmpty())
+            literals.append(literal);
+        literal.clear();
+    };
+
+    for(int i = 0; i < pattern.size(); ++i)
+    {
+        const QChar c = pattern.at(i);
+
+        if(c == '|')
+            return QStringList();
+
+        if(c == '\\' && i + 1 < pattern.size())
+        {
+            const QChar escaped = pattern.at(++i);
+            if(depth == 0 && !escaped.isLetterOrNumber())
+                literal.append(escaped);
+            else
+                flush();
+        }
+        else if(c == '[')
+        {
+            flush();
+            int end = i + 1;
+            if(end < pattern.size() && pattern.at(end) == '^')
+                ++end;
+            if(end < pattern.size() && pattern.at(end) == ']')
+                ++end;
+            while(end < pattern.size() && pattern.at(end) != ']')
+                end += (pattern.at(end) == '\\') ? 2 : 1;
+            i = end;
+        }
+        else if(c == '(')
+        {
+            flush();
+            ++depth;
+        }
+        else if(c == ')')
+        {
+            flush();
+            depth = qMax(0, depth - 1);
+        }
+        else if(c == '*' || c == '?' || c == '{')
+        {
+            // the quantified character is optional
+            literal.chop(1);
+            flush();
+
+            if(c == '{')
+            {
+                int end = pattern.indexOf('}', i);
+                i = (end < 0) ? pattern.size() : end;
+            }
+        }
+        else if(c == '+' || c == '.' || c == '^' || c == '$')
+            flush();
+        else if(depth == 0)
+            literal.append(c);
+    }
+
+    flush();
+    return literals;
+}
+
+
+// hex digits, with the "~" of a sampled fingerprint in front
+bool SearchIndex::isHexQuery(const QString &query)
+{
+    for(int i = 0; i < query.size(); ++i)
+    {
+        const QChar c = query.at(i).toLower();
+        if(!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (i == 0 && c == '~')))
+            return false;
+    }
+
+    return !query.isEmpty();
+}
+
+
+quint64 SearchIndex::prefixKey(const QString &text, uchar padding)
+{
+    quint64 key = 0;
+    for(int i = 0; i < 8; ++i)
+    {
+        uchar byte = (i < text.size()) ? uchar(text.at(i).toLower().toLatin1()) : padding;
+        key = (key << 8) | byte;
+    }
+    return key;
+}
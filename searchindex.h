@@ -0,0 +1,72 @@
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+#include <QBitArray>
+#include <QPromise>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+
+#include <vector>
+
+class TableSnapshot;
+
+// Narrows table searches down to candidate rows, so the proxy model only verifies those.
+// Name, path and type strings are interned and indexed by lowercase trigrams (directories
+// are shared by all their files), digest columns are indexed by a sorted 8 character prefix.
+// A plain hex query may also be a piece from the middle of a digest, the binary digests of
+// the snapshot are searched for it. Candidates are a superset of the matching rows. Building
+// and querying run on the worker threads of the proxy model's background filter pass.
+class SearchIndex
+{
+public:
+    enum Mode
+    {
+        Wildcard,
+        Regex
+    };
+
+    void clear();
+    void build(const QSharedPointer<const TableSnapshot> &snapshot);
+    int rowCount() const;
+
+    // false if the query can't be narrowed down and every row has to be checked
+    bool candidates(const QString &query, Mode mode, QBitArray &rows, QPromise<QBitArray> &promise) const;
+
+private:
+    struct PrefixEntry
+    {
+        quint64 key;
+        quint32 row;
+
+        bool operator<(const PrefixEntry &other) const { return key < other.key; }
+    };
+
+    void trigramRows(const quint64 &trigram, QBitArray &rows) const;
+    bool textCandidates(const QStringList &literals, QBitArray &rows) const;
+    void prefixCandidates(const QString &query, QBitArray &rows) const;
+    void digestCandidates(const QString &query, QBitArray &rows, QPromise<QBitArray> &promise) const;
+    bool digestColumnsMayContain(const QStringList &literals) const;
+
+    static QStringList wildcardLiterals(const QString &pattern);
+    static QStringList regexLiterals(const QString &pattern);
+    static bool isHexQuery(const QString &query);
+    static quint64 prefixKey(const QString &text, uchar padding);
+
+    int m_row_count = 0;
+    QSharedPointer<const TableSnapshot> m_snapshot;
+
+    // rows per interned string (compressed row storage)
+    std::vector<quint32> m_string_row_offsets;
+    std::vector<quint32> m_string_rows;
+
+    // trigram -> ids of the strings containing it
+    std::vector<quint64> m_trigrams;
+    std::vector<quint32> m_trigram_offsets;
+    std::vector<quint32> m_trigram_strings;
+
+    std::vector<PrefixEntry> m_prefixes;
+    bool m_has_base64_digests = false; // ssdeep digests are not limited to hex characters
+};
+
+#endif // SEARCHINDEX_H
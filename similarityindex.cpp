@@ -0,0 +1,168 @@
+#include "similarityindex.h"
+#include "fuzzy.h"
+
+#include <QSet>
+
+// buckets up to this size compare all their pairs. A larger bucket (a family of near-identical
+// files, log rotations, build outputs) compares each member with a bounded set of representatives
+// instead, near-identical members all join the first one they match
+static const int MAX_BUCKET_SIZE = 1000;
+static const int MAX_REPRESENTATIVES = 64;
+static const int GRAM_LENGTH = 7;
+
+
+// fuzzy_compare drops runs of more than three equal characters before it looks for a common
+// substring, the grams are taken from the same shortened signature
+static QByteArray eliminateSequences(const QByteArray &signature)
+{
+    QByteArray result;
+    result.reserve(signature.size());
+
+    for(int i = 0; i < signature.size(); ++i)
+    {
+        if(i >= 3 && signature.at(i) == signature.at(i - 1) && signature.at(i) == signature.at(i - 2) && signature.at(i) == signature.at(i - 3))
+            continue;
+        result.append(signature.at(i));
+    }
+
+    return result;
+}
+
+
+void SimilarityIndex::clear()
+{
+    m_digests.clear();
+    m_ids.clear();
+    m_digest_index.clear();
+    m_buckets.clear();
+}
+
+
+void SimilarityIndex::add(int id, const QString &digest)
+{
+    QByteArray digest_bytes = digest.toLatin1();
+
+    auto it = m_digest_index.constFind(digest_bytes);
+    if(it != m_digest_index.constEnd())
+    {
+        m_ids[it.value()].append(id);
+        return;
+    }
+
+    QList<QByteArray> parts = digest_bytes.split(':');
+    if(parts.size() < 3)
+        return;
+
+    bool ok;
+    quint64 block_size = parts.at(0).toULongLong(&ok);
+    if(!ok)
+        return;
+
+    int index = m_digests.size();
+    m_digests.append(digest_bytes);
+    m_ids.append(QList<int>() << id);
+    m_digest_index.insert(digest_bytes, index);
+
+    // the second signature part uses the doubled block size
+    for(int part = 1; part <= 2; ++part)
+    {
+        const QByteArray signature = eliminateSequences(parts.at(part));
+        QByteArray prefix = QByteArray::number(block_size * part) + ":";
+
+        QSet<QByteArray> grams;
+        for(int i = 0; i + GRAM_LENGTH <= signature.size(); ++i)
+            grams.insert(signature.mid(i, GRAM_LENGTH));
+
+        for(const QByteArray &gram : grams)
+            m_buckets[prefix + gram].append(index);
+    }
+}
+
+
+int SimilarityIndex::findRoot(QList<int> &parents, int index) const
+{
+    while(parents[index] != index)
+    {
+        parents[index] = parents[parents[index]];
+        index = parents[index];
+    }
+    return index;
+}
+
+
+QHash<int, int> SimilarityIndex::groups(int threshold) const
+{
+    QList<int> parents(m_digests.size());
+    for(int i = 0; i < parents.size(); ++i)
+        parents[i] = i;
+
+    QSet<quint64> compared_pairs;
+
+    // true if both are in one group afterwards
+    auto join = [&](int left, int right)
+    {
+        if(findRoot(parents, left) == findRoot(parents, right))
+            return true;
+
+        quint64 pair = (quint64(qMin(left, right)) << 32) | quint64(qMax(left, right));
+        if(compared_pairs.contains(pair))
+            return false;
+        compared_pairs.insert(pair);
+
+        if(fuzzy_compare(m_digests.at(left).constData(), m_digests.at(right).constData()) < threshold)
+            return false;
+
+        parents[findRoot(parents, left)] = findRoot(parents, right);
+        return true;
+    };
+
+    for(auto bucket = m_buckets.constBegin(); bucket != m_buckets.constEnd(); ++bucket)
+    {
+        const QList<int> &indexes = bucket.value();
+        if(indexes.size() < 2)
+            continue;
+
+        if(indexes.size() <= MAX_BUCKET_SIZE)
+        {
+            for(int i = 0; i < indexes.size(); ++i)
+            {
+                for(int j = i + 1; j < indexes.size(); ++j)
+                    join(indexes.at(i), indexes.at(j));
+            }
+            continue;
+        }
+
+        QList<int> representatives;
+        for(int index : indexes)
+        {
+            bool joined = false;
+            for(int i = 0; !joined && i < representatives.size(); ++i)
+                joined = join(index, representatives.at(i));
+
+            if(!joined && representatives.size() < MAX_REPRESENTATIVES)
+                representatives.append(index);
+        }
+    }
+
+    QHash<int, int> member_count;
+    for(int i = 0; i < m_digests.size(); ++i)
+        member_count[findRoot(parents, i)] += m_ids.at(i).size();
+
+    QHash<int, int> group_numbers;
+    QHash<int, int> result;
+
+    for(int i = 0; i < m_digests.size(); ++i)
+    {
+        int root = findRoot(parents, i);
+        if(member_count.value(root) < 2)
+            continue;
+
+        if(!group_numbers.contains(root))
+            group_numbers.insert(root, group_numbers.size() + 1);
+
+        for(int id : m_ids.at(i))
+            result.insert(id, group_numbers.value(root));
+    }
+
+    return result;
+}
@@ -0,0 +1,30 @@
+#ifndef SIMILARITYINDEX_H
+#define SIMILARITYINDEX_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+// Groups ssdeep digests into clusters of similar files. ssdeep only scores digests that
+// share a 7 character substring at the same (or a doubled) block size, so digests are
+// bucketed by (block size, 7-gram) and only digests sharing a bucket are compared.
+class SimilarityIndex
+{
+public:
+    void clear();
+    void add(int id, const QString &digest);
+
+    // id -> group number (starting at 1), ids without a similar partner are left out
+    QHash<int, int> groups(int threshold) const;
+
+private:
+    int findRoot(QList<int> &parents, int index) const;
+
+    QList<QByteArray> m_digests;            // unique digests
+    QList<QList<int>> m_ids;                // ids per unique digest
+    QHash<QByteArray, int> m_digest_index;
+    QHash<QByteArray, QList<int>> m_buckets; // "blocksize:7-gram" -> unique digest indices
+};
+
+#endif // SIMILARITYINDEX_H
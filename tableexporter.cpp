@@ -0,0 +1,238 @@
+#include "tableexporter.h"
+#include "Column.h"
+
+#include <cmath>
+
+
+static const qsizetype CHUNK_SIZE = 1024 * 1024;
+static const int PROGRESS_INTERVAL = 10000;
+
+
+TableExporter::TableExporter(const QString &file_path, Format format)
+    : file(file_path),
+      format(format)
+{
+    buffer.reserve(CHUNK_SIZE + 64 * 1024);
+}
+
+
+TableExporter::Format TableExporter::formatForFilter(const QString &name_filter)
+{
+    if(name_filter.startsWith("CSV"))
+        return Csv;
+    if(name_filter.startsWith("JSON"))
+        return JsonLines;
+    if(name_filter.startsWith("sha256sum"))
+        return Sha256Sum;
+    if(name_filter.startsWith("md5sum"))
+        return Md5Sum;
+
+    return Tsv;
+}
+
+
+void TableExporter::exportRows(const QSharedPointer<const TableSnapshot> &snapshot, const QList<int> &rows, const QList<int> &columns, const QStringList &headers)
+{
+    if(!file.open(QIODevice::WriteOnly))
+    {
+        qWarning("TableExporter: file.open(): %s", qPrintable(file.errorString()));
+        emit exportFinished(false);
+        return;
+    }
+
+    const bool manifest = (format == Sha256Sum || format == Md5Sum);
+    const int digest_column = (format == Sha256Sum) ? Column::SHA256 : Column::MD5;
+
+    if(format == Tsv || format == Csv)
+    {
+        const QString separator = (format == Tsv) ? QString("\t") : QString(",");
+        const QString line_end = (format == Tsv) ? QString("\n") : QString("\r\n");
+
+        QStringList labels;
+        for(const QString &header : headers)
+            labels.append(format == Tsv ? header : QString("\"%1\"").arg(QString(header).replace('"', "\"\"")));
+        buffer.append(labels.join(separator).toUtf8() + line_end.toUtf8());
+    }
+
+    int written = 0;
+    int skipped = 0;
+    bool ok = true;
+
+    for(int i = 0; i < rows.size() && ok; ++i)
+    {
+        if(manifest)
+        {
+            if(!appendManifestRow(*snapshot, rows.at(i), digest_column))
+                ++skipped;
+        }
+        else
+        {
+            appendTableRow(*snapshot, rows.at(i), columns, headers);
+        }
+
+        ok = flush();
+
+        if(++written % PROGRESS_INTERVAL == 0)
+            emit rowsWritten(written);
+    }
+
+    ok = ok && flush(true);
+    file.close();
+
+    if(skipped > 0)
+        qWarning("TableExporter: %d rows without digest left out of the manifest", skipped);
+
+    emit rowsWritten(written);
+    emit exportFinished(ok);
+}
+
+
+// empty cells are written as a dash, like the delegate draws them
+void TableExporter::appendTableRow(const TableSnapshot &snapshot, int row, const QList<int> &columns, const QStringList &headers)
+{
+    QString line;
+
+    if(format == JsonLines)
+    {
+        line.append('{');
+        for(int i = 0; i < columns.size(); ++i)
+        {
+            if(i > 0)
+                line.append(',');
+
+            // numbers stay numbers, empty cells become null
+            const int column = columns.at(i);
+            double value;
+            QString json_value;
+            if(snapshot.number(row, column, value))
+            {
+                json_value = QString::number(value, 'g', 15);
+            }
+            else
+            {
+                const QString text = snapshot.text(row, column);
+                json_value = text.isEmpty() ? QString("null") : jsonString(text);
+            }
+
+            line.append(jsonString(headers.value(i))).append(':').append(json_value);
+        }
+        line.append("}\n");
+    }
+    else if(format == Csv)
+    {
+        for(int i = 0; i < columns.size(); ++i)
+        {
+            if(i > 0)
+                line.append(',');
+
+            QString text = cellText(snapshot, row, columns.at(i));
+            if(text.contains(',') || text.contains('"') || text.contains('\n') || text.contains('\r'))
+                text = '"' + text.replace('"', "\"\"") + '"';
+            line.append(text);
+        }
+        line.append("\r\n");
+    }
+    else
+    {
+        for(int i = 0; i < columns.size(); ++i)
+        {
+            if(i > 0)
+                line.append('\t');
+
+            // tabs and line breaks would split the cell
+            QString text = cellText(snapshot, row, columns.at(i));
+            for(QChar &c : text)
+            {
+                if(c == '\t' || c == '\n' || c == '\r')
+                    c = ' ';
+            }
+            line.append(text);
+        }
+        line.append('\n');
+    }
+
+    buffer.append(line.toUtf8());
+}
+
+
+bool TableExporter::appendManifestRow(const TableSnapshot &snapshot, int row, int digest_column)
+{
+    const Digest digest = snapshot.digest(row, digest_column);
+    if(digest.isNull() || digest.isSampled())
+        return false;
+
+    buffer.append(manifestLine(digest, snapshot.text(row, Column::FULLPATH)));
+    return true;
+}
+
+
+// quoted, with quotes, backslashes and control characters escaped
+QString TableExporter::jsonString(const QString &text)
+{
+    QString json_value("\"");
+    for(const QChar c : text)
+    {
+        if(c == '"' || c == '\\')
+            json_value.append('\\').append(c);
+        else if(c == '\n')
+            json_value.append("\\n");
+        else if(c == '\t')
+            json_value.append("\\t");
+        else if(c.unicode() < 0x20)
+            json_value.append(QString("\\u%1").arg(c.unicode(), 4, 16, QChar('0')));
+        else
+            json_value.append(c);
+    }
+    json_value.append('"');
+
+    return json_value;
+}
+
+
+// "<hex>  <path>", names with a backslash or a line break are escaped like coreutils does
+QByteArray TableExporter::manifestLine(const Digest &digest, const QString &path)
+{
+    QByteArray line;
+
+    QString name = path;
+    if(name.contains('\\') || name.contains('\n') || name.contains('\r'))
+    {
+        name.replace('\\', "\\\\");
+        name.replace('\n', "\\n");
+        name.replace('\r', "\\r");
+        line.append('\\');
+    }
+
+    line.append(digest.toHexLatin1());
+    line.append("  ");
+    line.append(name.toUtf8());
+    line.append('\n');
+
+    return line;
+}
+
+
+// numeric cells are written raw, a file size without digit grouping
+QString TableExporter::cellText(const TableSnapshot &snapshot, int row, int column) const
+{
+    double value;
+    if(snapshot.number(row, column, value) && value == std::floor(value))
+        return QString::number(qint64(value));
+
+    const QString text = snapshot.text(row, column);
+    return text.isEmpty() ? QString("-") : text;
+}
+
+
+bool TableExporter::flush(bool force)
+{
+    if(buffer.isEmpty() || (!force && buffer.size() < CHUNK_SIZE))
+        return true;
+
+    const bool ok = file.write(buffer) == buffer.size();
+    if(!ok)
+        qWarning("TableExporter: file.write(): %s", qPrintable(file.errorString()));
+
+    buffer.resize(0);
+    return ok;
+}
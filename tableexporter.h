@@ -0,0 +1,54 @@
+#ifndef TABLEEXPORTER_H
+#define TABLEEXPORTER_H
+
+#include <QFile>
+#include <QList>
+#include <QObject>
+#include <QSharedPointer>
+#include <QStringList>
+
+#include "tablesnapshot.h"
+
+// Writes table rows to a file from its own thread. Rows are read from a snapshot in the
+// order of the view and encoded into a buffer that is flushed in chunks, so no export
+// is ever held in memory as a whole. Manifests are sha256sum/md5sum compatible and
+// contain only rows that have the digest.
+class TableExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Format { Tsv, Csv, JsonLines, Sha256Sum, Md5Sum };
+
+    TableExporter(const QString &file_path, Format format);
+
+    static Format formatForFilter(const QString &name_filter);
+
+    // shared with the command line output, so both write the same escaping
+    static QString jsonString(const QString &text);
+    static QByteArray manifestLine(const Digest &digest, const QString &path);
+
+signals:
+    // source rows in view order, visible columns with their header labels
+    void startExport(const QSharedPointer<const TableSnapshot> &snapshot, const QList<int> &rows, const QList<int> &columns, const QStringList &headers);
+
+    void rowsWritten(int count);
+
+    void exportFinished(bool ok);
+
+public slots:
+    void exportRows(const QSharedPointer<const TableSnapshot> &snapshot, const QList<int> &rows, const QList<int> &columns, const QStringList &headers);
+
+private:
+    void appendTableRow(const TableSnapshot &snapshot, int row, const QList<int> &columns, const QStringList &headers);
+    bool appendManifestRow(const TableSnapshot &snapshot, int row, int digest_column);
+    QString cellText(const TableSnapshot &snapshot, int row, int column) const;
+
+    bool flush(bool force = false);
+
+    QFile file;
+    Format format;
+    QByteArray buffer;
+};
+
+#endif // TABLEEXPORTER_H
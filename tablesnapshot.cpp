@@ -0,0 +1,189 @@
+#include "tablesnapshot.h"
+#include "Column.h"
+#include "digestitem.h"
+#include "pathitem.h"
+
+#include <cmath>
+#include <limits>
+
+
+TableSnapshot::TableSnapshot(const QAbstractItemModel *model, const QSet<int> &numeric_columns, const QSharedPointer<const PathTable> &paths)
+    : TableSnapshot(model, numeric_columns, paths, 0, model->rowCount())
+{
+}
+
+
+TableSnapshot::TableSnapshot(const QAbstractItemModel *model, const QSet<int> &numeric_columns, const QSharedPointer<const PathTable> &paths, int first_row, int row_count)
+    : TableSnapshot(model, numeric_columns, paths, row_count)
+{
+    for(int row = 0; row < m_row_count; ++row)
+        copyRow(model, first_row + row, row);
+}
+
+
+TableSnapshot::TableSnapshot(const QAbstractItemModel *model, const QSet<int> &numeric_columns, const QSharedPointer<const PathTable> &paths, const QList<int> &model_rows)
+    : TableSnapshot(model, numeric_columns, paths, int(model_rows.size()))
+{
+    for(int row = 0; row < m_row_count; ++row)
+        copyRow(model, model_rows.at(row), row);
+}
+
+
+// the rows are appended in order by copyRow
+TableSnapshot::TableSnapshot(const QAbstractItemModel *model, const QSet<int> &numeric_columns, const QSharedPointer<const PathTable> &paths, int row_count)
+    : m_row_count(row_count),
+      m_column_count(model->columnCount()),
+      m_paths(paths)
+{
+    m_texts.reserve(qsizetype(m_row_count) * m_column_count);
+    m_digests.resize(m_column_count);
+    m_path_ids.resize(m_column_count);
+
+    for(int column : numeric_columns)
+    {
+        if(column < m_column_count)
+            m_numbers[column].reserve(m_row_count);
+    }
+}
+
+
+void TableSnapshot::copyRow(const QAbstractItemModel *model, int model_row, int row)
+{
+    for(int column = 0; column < m_column_count; ++column)
+    {
+        QModelIndex index = model->index(model_row, column);
+
+        Digest digest = DigestItem::digest(index);
+        int path_id = PathItem::pathId(index);
+        if(!digest.isNull())
+        {
+            if(m_digests[column].isEmpty())
+                m_digests[column].resize(m_row_count);
+            m_digests[column][row] = digest;
+            m_texts.append(QString());
+        }
+        else if(path_id != -1 && m_paths)
+        {
+            if(m_path_ids[column].isEmpty())
+                m_path_ids[column].fill(-1, m_row_count);
+            m_path_ids[column][row] = path_id;
+            m_texts.append(QString());
+        }
+        else
+        {
+            m_texts.append(index.data().toString());
+        }
+
+        auto it = m_numbers.find(column);
+        if(it != m_numbers.end())
+        {
+            bool ok;
+            double value = index.data(Qt::UserRole).toDouble(&ok);
+            it->append(ok ? value : std::numeric_limits<double>::quiet_NaN());
+        }
+    }
+}
+
+
+// replaces removed_count entries at first with the entries of rows, or with inserted_count empty
+// ones when rows has none. Columns without any entries stay empty.
+template<typename T>
+static void splice(QList<T> &column, int row_count, int first, int removed_count, const QList<T> &rows, int inserted_count, const T &empty)
+{
+    if(column.isEmpty() && rows.isEmpty())
+        return;
+
+    if(column.isEmpty())
+        column.fill(empty, row_count);
+
+    // changed cells are overwritten in place
+    if(removed_count == inserted_count)
+    {
+        for(int i = 0; i < inserted_count; ++i)
+            column[first + i] = rows.isEmpty() ? empty : rows.at(i);
+        return;
+    }
+
+    QList<T> result;
+    result.reserve(row_count - removed_count + inserted_count);
+    result.append(column.mid(0, first));
+    if(rows.isEmpty())
+        result.append(QList<T>(inserted_count, empty));
+    else
+        result.append(rows);
+    result.append(column.mid(first + removed_count));
+
+    column = result;
+}
+
+
+QSharedPointer<const TableSnapshot> TableSnapshot::edited(const QSharedPointer<const TableSnapshot> &snapshot, const QList<Edit> &edits)
+{
+    QSharedPointer<TableSnapshot> result(new TableSnapshot(*snapshot));
+
+    for(const Edit &edit : edits)
+    {
+        const TableSnapshot *rows = edit.rows.data();
+        const int inserted_rows = rows ? rows->m_row_count : 0;
+        const int column_count = result->m_column_count;
+
+        splice(result->m_texts, result->m_row_count * column_count, edit.first * column_count, edit.removed_rows * column_count,
+               rows ? rows->m_texts : QList<QString>(), inserted_rows * column_count, QString());
+
+        for(int column = 0; column < column_count; ++column)
+        {
+            splice(result->m_digests[column], result->m_row_count, edit.first, edit.removed_rows,
+                   rows ? rows->m_digests.at(column) : QList<Digest>(), inserted_rows, Digest());
+            splice(result->m_path_ids[column], result->m_row_count, edit.first, edit.removed_rows,
+                   rows ? rows->m_path_ids.at(column) : QList<int>(), inserted_rows, -1);
+        }
+
+        for(auto it = result->m_numbers.begin(); it != result->m_numbers.end(); ++it)
+        {
+            splice(it.value(), result->m_row_count, edit.first, edit.removed_rows,
+                   rows ? rows->m_numbers.value(it.key()) : QList<double>(), inserted_rows, std::numeric_limits<double>::quiet_NaN());
+        }
+
+        result->m_row_count += inserted_rows - edit.removed_rows;
+    }
+
+    return result;
+}
+
+
+QString TableSnapshot::text(int row, int column) const
+{
+    const QList<Digest> &digests = m_digests.at(column);
+    if(!digests.isEmpty() && !digests.at(row).isNull())
+        return digests.at(row).toHex();
+
+    const QList<int> &path_ids = m_path_ids.at(column);
+    if(!path_ids.isEmpty() && path_ids.at(row) != -1)
+        return column == Column::DIRPATH ? m_paths->shortPath(path_ids.at(row)) : m_paths->filePath(path_ids.at(row));
+
+    return m_texts.at(row * m_column_count + column);
+}
+
+
+Digest TableSnapshot::digest(int row, int column) const
+{
+    const QList<Digest> &digests = m_digests.at(column);
+    return digests.isEmpty() ? Digest() : digests.at(row);
+}
+
+
+bool TableSnapshot::number(int row, int column, double &value) const
+{
+    auto it = m_numbers.constFind(column);
+    if(it == m_numbers.constEnd())
+        return false;
+
+    value = it->at(row);
+    return !std::isnan(value);
+}
+
+
+bool TableSnapshot::hasNumbers(int column) const
+{
+    return m_numbers.contains(column);
+}
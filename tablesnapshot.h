@@ -0,0 +1,63 @@
+#ifndef TABLESNAPSHOT_H
+#define TABLESNAPSHOT_H
+
+#include <QAbstractItemModel>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QSharedPointer>
+#include <QString>
+
+#include "digest.h"
+#include "pathtable.h"
+
+// Read-only copy of the table cells, taken in the GUI thread, so searching, filtering and
+// sorting can run on worker threads. The texts share their data with the model items,
+// digest cells are kept binary and path cells as path ids, both are formatted when their
+// text is read. Later edits of the model are replayed on a copy in a worker thread, only the
+// rows they touch are read in the GUI thread.
+class TableSnapshot
+{
+public:
+    // rows first to first + row_count - 1 of the model replace row_count rows of a snapshot
+    struct Edit
+    {
+        int first;
+        int removed_rows;
+        QSharedPointer<const TableSnapshot> rows;   // null when rows are only removed
+    };
+
+    TableSnapshot(const QAbstractItemModel *model, const QSet<int> &numeric_columns, const QSharedPointer<const PathTable> &paths);
+    TableSnapshot(const QAbstractItemModel *model, const QSet<int> &numeric_columns, const QSharedPointer<const PathTable> &paths, int first_row, int row_count);
+    // only the given model rows, in their order
+    TableSnapshot(const QAbstractItemModel *model, const QSet<int> &numeric_columns, const QSharedPointer<const PathTable> &paths, const QList<int> &model_rows);
+
+    // a copy of the snapshot with the edits applied in order
+    static QSharedPointer<const TableSnapshot> edited(const QSharedPointer<const TableSnapshot> &snapshot, const QList<Edit> &edits);
+
+    int rowCount() const { return m_row_count; }
+    int columnCount() const { return m_column_count; }
+
+    QString text(int row, int column) const;
+
+    // the raw digest of a digest cell, null for text cells
+    Digest digest(int row, int column) const;
+
+    // the UserRole value of a numeric column, false if the cell has none
+    bool number(int row, int column, double &value) const;
+    bool hasNumbers(int column) const;
+
+private:
+    TableSnapshot(const QAbstractItemModel *model, const QSet<int> &numeric_columns, const QSharedPointer<const PathTable> &paths, int row_count);
+    void copyRow(const QAbstractItemModel *model, int model_row, int row);
+
+    int m_row_count;
+    int m_column_count;
+    QList<QString> m_texts;
+    QList<QList<Digest>> m_digests;        // per column, empty for columns without digest cells
+    QList<QList<int>> m_path_ids;          // per column, -1 for text cells
+    QSharedPointer<const PathTable> m_paths;
+    QHash<int, QList<double>> m_numbers; // NaN for cells without a value
+};
+
+#endif // TABLESNAPSHOT_H
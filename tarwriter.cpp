@@ -0,0 +1,221 @@
+#include "tarwriter.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QThread>
+
+#include <zstd.h>
+#include <cstring>
+
+
+static const qint64 BLOCK_SIZE = 4 * 1024 * 1024;
+static const qint64 RECORD_SIZE = 512;
+static const qint64 MAX_OCTAL_SIZE = 077777777777;      // 11 octal digits, larger sizes live in the pax header
+static const int COMPRESSION_LEVEL = 1;                 // favours throughput, the workers add the rest
+
+static const char zero_block[64 * 1024] = {};
+
+
+TarWriter::TarWriter(const QString &archive_path)
+    : archive(archive_path),
+      context(ZSTD_createCCtx())
+{
+    if(!archive.open(QIODevice::WriteOnly))
+    {
+        qWarning("TarWriter(): archive.open(): %s", qPrintable(archive.errorString()));
+    }
+
+    ZSTD_CCtx_setParameter(context, ZSTD_c_compressionLevel, COMPRESSION_LEVEL);
+    ZSTD_CCtx_setParameter(context, ZSTD_c_checksumFlag, 1);
+
+    // fails on a zstd built without ZSTD_MULTITHREAD, compression then stays on this thread
+    if(ZSTD_isError(ZSTD_CCtx_setParameter(context, ZSTD_c_nbWorkers, qMax(1, QThread::idealThreadCount()))))
+    {
+        qWarning("TarWriter(): zstd has no worker threads, compressing single threaded");
+    }
+
+    out_buffer.resize(qsizetype(ZSTD_CStreamOutSize()));
+    in_buffer.resize(BLOCK_SIZE);
+}
+
+
+TarWriter::~TarWriter()
+{
+    ZSTD_freeCCtx(context);
+}
+
+
+void TarWriter::writeFileList(const QStringList &file_path_list, const QList<Digest> &sha256_digests)
+{
+    int counter = 0;
+
+    if(archive.isOpen())
+    {
+        for(qsizetype i = 0; i < file_path_list.size(); ++i)
+        {
+            if(!writeFile(file_path_list.at(i), sha256_digests.value(i)))
+            {
+                qWarning("TarWriter(): writing %s failed, archive is incomplete", qPrintable(archive.fileName()));
+                break;
+            }
+
+            emit fileFinished(++counter);
+        }
+    }
+
+    close();
+}
+
+
+// false only when the archive itself can't be written, unreadable files are skipped
+bool TarWriter::writeFile(const QString &file_path, const Digest &sha256)
+{
+    QFile in_file(file_path);
+    if(!in_file.open(QIODevice::ReadOnly))
+    {
+        qWarning("Failed to open file for reading: %s", qPrintable(file_path));
+        return true;
+    }
+
+    const QFileInfo file_info(file_path);
+    const QString name = file_info.fileName();
+    const qint64 size = in_file.size();
+    const qint64 mtime = file_info.lastModified().toSecsSinceEpoch();
+
+    QByteArray pax = paxRecord("path", name.toUtf8());
+    pax += paxRecord("size", QByteArray::number(size));
+    pax += paxRecord("mtime", QByteArray::number(mtime));
+
+    // stored as an extended attribute, GNU tar and bsdtar know the keyword and restore it with --xattrs
+    if(!sha256.isNull() && !sha256.isSampled())
+        pax += paxRecord("SCHILY.xattr.user.sha256", sha256.toHexLatin1());
+
+    if(!writeHeader("PaxHeaders/" + name, 'x', pax.size(), mtime)
+       || !compress(pax.constData(), pax.size())
+       || !pad(pax.size())
+       || !writeHeader(name, '0', size, mtime))
+        return false;
+
+    qint64 remaining = size;
+    while(remaining > 0)
+    {
+        const qint64 bytes_read = in_file.read(in_buffer.data(), qMin(BLOCK_SIZE, remaining));
+        if(bytes_read <= 0)
+            break;
+
+        if(!compress(in_buffer.constData(), bytes_read))
+            return false;
+
+        remaining -= bytes_read;
+    }
+
+    // the header already promised the size, a file that shrank meanwhile is filled with zeros
+    if(remaining > 0)
+    {
+        qWarning("TarWriter(): %s is shorter than expected, padding %lld bytes", qPrintable(file_path), remaining);
+        while(remaining > 0)
+        {
+            const qint64 chunk = qMin(remaining, qint64(sizeof(zero_block)));
+            if(!compress(zero_block, chunk))
+                return false;
+            remaining -= chunk;
+        }
+    }
+
+    return pad(size);
+}
+
+
+// ustar header, the pax header in front of it carries anything that doesn't fit
+bool TarWriter::writeHeader(const QString &name, char type, qint64 size, qint64 mtime)
+{
+    char header[RECORD_SIZE] = {};
+
+    auto octal = [&header](int offset, int width, qint64 value)
+    {
+        const QByteArray digits = QByteArray::number(qBound(Q_INT64_C(0), value, MAX_OCTAL_SIZE), 8).rightJustified(width - 1, '0');
+        std::memcpy(header + offset, digits.constData(), size_t(width - 1));
+    };
+
+    const QByteArray short_name = name.toUtf8().left(99);
+    std::memcpy(header, short_name.constData(), size_t(short_name.size()));
+
+    octal(100, 8, 0644);
+    octal(108, 8, 0);
+    octal(116, 8, 0);
+    octal(124, 12, size > MAX_OCTAL_SIZE ? 0 : size);
+    octal(136, 12, mtime);
+    header[156] = type;
+    std::memcpy(header + 257, "ustar", 6);
+    std::memcpy(header + 263, "00", 2);
+
+    std::memset(header + 148, ' ', 8);
+    unsigned int checksum = 0;
+    for(const char byte : header)
+        checksum += uchar(byte);
+    octal(148, 7, checksum);
+    header[154] = '\0';
+
+    return compress(header, RECORD_SIZE);
+}
+
+
+bool TarWriter::compress(const char *data, qint64 size, bool end)
+{
+    ZSTD_inBuffer input = {data, size_t(size), 0};
+
+    forever
+    {
+        ZSTD_outBuffer output = {out_buffer.data(), size_t(out_buffer.size()), 0};
+
+        const size_t remaining = ZSTD_compressStream2(context, &output, &input, end ? ZSTD_e_end : ZSTD_e_continue);
+        if(ZSTD_isError(remaining))
+        {
+            qWarning("TarWriter(): ZSTD_compressStream2(): %s", ZSTD_getErrorName(remaining));
+            return false;
+        }
+
+        if(output.pos > 0 && archive.write(out_buffer.constData(), qint64(output.pos)) != qint64(output.pos))
+        {
+            qWarning("TarWriter(): archive.write(): %s", qPrintable(archive.errorString()));
+            return false;
+        }
+
+        if(end ? remaining == 0 : input.pos == input.size)
+            return true;
+    }
+}
+
+
+// fills the last record of an entry
+bool TarWriter::pad(qint64 size)
+{
+    const qint64 padding = (RECORD_SIZE - size % RECORD_SIZE) % RECORD_SIZE;
+    return padding == 0 || compress(zero_block, padding);
+}
+
+
+// "<length> <key>=<value>\n", the length counts its own digits
+QByteArray TarWriter::paxRecord(const QByteArray &key, const QByteArray &value)
+{
+    const qsizetype payload = key.size() + value.size() + 3;
+
+    qsizetype length = payload + QByteArray::number(payload).size();
+    if(QByteArray::number(length).size() != QByteArray::number(payload).size())
+        ++length;
+
+    return QByteArray::number(length) + ' ' + key + '=' + value + '\n';
+}
+
+
+void TarWriter::close()
+{
+    // two empty records end the archive, the zstd frame is finished with them
+    if(archive.isOpen())
+    {
+        compress(zero_block, 2 * RECORD_SIZE, true);
+        archive.close();
+    }
+
+    emit writingFinished();
+}
@@ -0,0 +1,51 @@
+#ifndef TARWRITER_H
+#define TARWRITER_H
+
+#include <QFile>
+#include <QList>
+#include <QObject>
+
+#include "digest.h"
+
+struct ZSTD_CCtx_s;
+
+// Streams files into a pax tar archive compressed with multi-threaded zstd (.tar.zst).
+// Every entry gets a pax extended header with its full name, size and mtime, plus the
+// SHA256 from the table when it was computed. Files are read in large blocks and handed
+// to zstd, whose worker threads compress while the next block is read.
+class TarWriter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TarWriter(const QString &archive_path);
+    ~TarWriter();
+
+signals:
+    void startWriting(const QStringList &file_path_list, const QList<Digest> &sha256_digests);
+
+    void fileFinished(int counter);
+
+    void writingFinished();
+
+public slots:
+    void writeFileList(const QStringList &file_path_list, const QList<Digest> &sha256_digests);
+
+    void close();
+
+private:
+    bool writeFile(const QString &file_path, const Digest &sha256);
+    bool writeHeader(const QString &name, char type, qint64 size, qint64 mtime);
+
+    bool compress(const char *data, qint64 size, bool end = false);
+    bool pad(qint64 size);
+
+    static QByteArray paxRecord(const QByteArray &key, const QByteArray &value);
+
+    QFile archive;
+    ZSTD_CCtx_s *context;
+    QByteArray out_buffer;
+    QByteArray in_buffer;
+};
+
+#endif // TARWRITER_H
@@ -0,0 +1,179 @@
+#include "treehasher.h"
+#include "openssl/evp.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QtConcurrent>
+#include <QtEndian>
+
+static const quint32 CACHE_MAGIC = 0x484c5431; // "HLT1"
+
+// the oldest cache files are removed beyond this many
+static const int MAX_CACHE_FILES = 4096;
+
+
+QByteArray TreeHasher::hashFile(const QString &file_path, const qint64 &block_size)
+{
+    QFileInfo file_info(file_path);
+    const qint64 file_size = file_info.size();
+    const qint64 modified = file_info.lastModified().toMSecsSinceEpoch();
+    const qint64 block_count = qMax(qint64(1), (file_size + block_size - 1) / block_size);
+
+    qint64 cached_size;
+    qint64 cached_modified;
+    QList<QByteArray> cached_digests;
+
+    if(readCache(file_path, block_size, cached_size, cached_modified, cached_digests))
+    {
+        // anything but an unchanged file is read in full, a file that grew may also have been rewritten in place
+        if(cached_size == file_size && cached_modified == modified && cached_digests.size() == block_count)
+            return combine(cached_digests, block_size, file_size);
+    }
+
+    QList<qint64> offsets;
+    for(qint64 block = 0; block < block_count; ++block)
+        offsets.append(block * block_size);
+
+    const QList<QByteArray> block_digests = QtConcurrent::blockingMapped<QList<QByteArray>>(offsets, [&file_path, &block_size](const qint64 &offset) {
+        return TreeHasher::hashBlock(file_path, offset, block_size);
+    });
+
+    if(block_digests.size() != block_count || block_digests.contains(QByteArray()))
+        return QByteArray();
+
+    if(block_count > 1)
+        writeCache(file_path, block_size, file_size, modified, block_digests);
+
+    return combine(block_digests, block_size, file_size);
+}
+
+
+QByteArray TreeHasher::hashBlock(const QString &file_path, const qint64 &offset, const qint64 &length)
+{
+    const qint64 CHUNK_SIZE = 65536;
+    QByteArray buffer(CHUNK_SIZE, Qt::Uninitialized);
+
+    QFile file(file_path);
+    if(!file.open(QIODevice::ReadOnly) || !file.seek(offset))
+        return QByteArray();
+
+    EVP_MD_CTX *mdctx = EVP_MD_CTX_new();
+    unsigned char hash[EVP_MAX_MD_SIZE];
+    unsigned int digest_lenth;
+
+    if(mdctx == nullptr)
+    {
+        qWarning() << "mdctx == nullptr";
+        return QByteArray();
+    }
+
+    if(EVP_DigestInit_ex(mdctx, EVP_sha256(), NULL) != 1)
+        qWarning() << "EVP_DigestInit_ex != 1";
+
+    qint64 remaining = length;
+    while(remaining > 0)
+    {
+        qint64 bytes_read = file.read(buffer.data(), qMin(remaining, CHUNK_SIZE));
+        if(bytes_read <= 0)
+            break;
+
+        if(EVP_DigestUpdate(mdctx, buffer.constData(), bytes_read) != 1)
+            qWarning() << "EVP_DigestUpdate != 1";
+
+        remaining -= bytes_read;
+    }
+
+    if(EVP_DigestFinal_ex(mdctx, hash, &digest_lenth) != 1)
+        qWarning() << "VP_DigestFinal_ex != 1";
+
+    QByteArray result(reinterpret_cast<char *>(hash), digest_lenth);
+
+    EVP_MD_CTX_free(mdctx);
+
+    return result;
+}
+
+
+QByteArray TreeHasher::combine(const QList<QByteArray> &block_digests, const qint64 &block_size, const qint64 &file_size)
+{
+    QCryptographicHash root(QCryptographicHash::Sha256);
+
+    quint64 block_size_le = qToLittleEndian(quint64(block_size));
+    quint64 file_size_le = qToLittleEndian(quint64(file_size));
+    root.addData(QByteArrayView(reinterpret_cast<const char *>(&block_size_le), sizeof(block_size_le)));
+    root.addData(QByteArrayView(reinterpret_cast<const char *>(&file_size_le), sizeof(file_size_le)));
+
+    for(const QByteArray &block_digest : block_digests)
+        root.addData(block_digest);
+
+    return root.result();
+}
+
+
+QString TreeHasher::cachePath(const QString &file_path)
+{
+    QByteArray key = QCryptographicHash::hash(QFileInfo(file_path).absoluteFilePath().toUtf8(), QCryptographicHash::Sha1).toHex();
+    return QCoreApplication::applicationDirPath() + "/db/treehash/" + QString::fromLatin1(key) + ".bin";
+}
+
+
+bool TreeHasher::readCache(const QString &file_path, const qint64 &block_size, qint64 &file_size, qint64 &modified, QList<QByteArray> &block_digests)
+{
+    QFile cache_file(cachePath(file_path));
+    if(!cache_file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&cache_file);
+
+    quint32 magic;
+    qint64 cached_block_size;
+    QString cached_path;
+
+    in >> magic >> cached_block_size >> cached_path >> file_size >> modified >> block_digests;
+
+    if(in.status() != QDataStream::Ok || magic != CACHE_MAGIC)
+        return false;
+
+    return cached_block_size == block_size && cached_path == QFileInfo(file_path).absoluteFilePath();
+}
+
+
+void TreeHasher::writeCache(const QString &file_path, const qint64 &block_size, const qint64 &file_size, const qint64 &modified, const QList<QByteArray> &block_digests)
+{
+    QString cache_path = cachePath(file_path);
+    QDir().mkpath(QFileInfo(cache_path).absolutePath());
+
+    QFile cache_file(cache_path);
+    if(!cache_file.open(QIODevice::WriteOnly))
+    {
+        qWarning() << "Failed to write tree hash cache:" << cache_path;
+        return;
+    }
+
+    QDataStream out(&cache_file);
+    out << CACHE_MAGIC << block_size << QFileInfo(file_path).absoluteFilePath() << file_size << modified << block_digests;
+}
+    cache_file.close();
+
+    pruneCache(QFileInfo(cache_path).absolutePath());
+}
+
+
+void TreeHasher::pruneCache(const QString &cache_dir)
+{
+    static QMutex mutex;
+    if(!mutex.tryLock())
+        return;
+
+    QFileInfoList cache_files = QDir(cache_dir).entryInfoList(QStringList("*.bin"), QDir::Files, QDir::Time);
+    while(cache_files.size() > MAX_CACHE_FILES)
+        QFile::remove(cache_files.takeLast().absoluteFilePath());
+
+    mutex.unlock();
+}
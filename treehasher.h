@@ -0,0 +1,28 @@
+#ifndef TREEHASHER_H
+#define TREEHASHER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+// SHA256 Merkle tree hash: fixed-size blocks are digested in parallel and the root is a
+// SHA256 over the block size, the file size and all block digests. Block digests of
+// larger files are cached under db/treehash, so files with an unchanged size and modification
+// time are not read again; any other file is read in full. Only the most recently written
+// cache files are kept.
+class TreeHasher
+{
+public:
+    static QByteArray hashFile(const QString &file_path, const qint64 &block_size);
+
+private:
+    static QByteArray hashBlock(const QString &file_path, const qint64 &offset, const qint64 &length);
+    static QByteArray combine(const QList<QByteArray> &block_digests, const qint64 &block_size, const qint64 &file_size);
+
+    static QString cachePath(const QString &file_path);
+    static bool readCache(const QString &file_path, const qint64 &block_size, qint64 &file_size, qint64 &modified, QList<QByteArray> &block_digests);
+    static void writeCache(const QString &file_path, const qint64 &block_size, const qint64 &file_size, const qint64 &modified, const QList<QByteArray> &block_digests);
+    static void pruneCache(const QString &cache_dir);
+};
+
+#endif // TREEHASHER_H
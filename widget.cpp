@@ -6,8 +6,20 @@
 #include "headersortingadapter.h"
 #include "customsortfilterproxymodel.h"
 #include "itemprocessor.h"
+#include "manifest.h"
+#include "pathitem.h"
 #include "fileprocessor.h"
-
+#include "digestitem.h"
+#include "dirhasher.h"
+#include "dirwatcher.h"
+#include "hashdatabase.h"
+#include "knownhashloader.h"
+#include "searchindex.h"
+#include "tableexporter.h"
+#include "tablesnapshot.h"
+#include "similarityindex.h"
+
+#include "tarwriter.h"
 #include "zipper.h"
 
 #include <QClipboard>
@@ -16,16 +28,23 @@
 #include <QDropEvent>
 #include <QFileInfo>
 #include <QLabel>
+#include <QLocale>
 #include <QMimeData>
 #include <QMovie>
 #include <QRegularExpression>
 #include <QFileDialog>
 #include <QTimer>
+#include <QtConcurrent>
 #include <QSettings>
+#include <QDebug>
+#include <QSet>
 
 #include <QSvgWidget>
 #include <QDesktopServices>
 
+// tables from this size on are filtered and sorted on worker threads
+static const int BACKGROUND_FILTER_ROWS = 10000;
+
 
 Widget::Widget(QWidget *parent)
     : QWidget(parent),
@@ -36,6 +55,11 @@ Widget::Widget(QWidget *parent)
     md5 = true;
     sha1 = true;
     sha256 = true;
+    treehash = false;
+    sampled = false;
+    dirhash = false;
+    entropy = false;
+    ssdeep = false;
     yara = false;
     show_filesize = true;
     show_extension = true;
@@ -45,6 +69,7 @@ Widget::Widget(QWidget *parent)
     show_fullpath = true;
 
     doubles_found = false;
+    verifying = false;
 
     setAcceptDrops(true);
 
@@ -59,13 +84,10 @@ Widget::Widget(QWidget *parent)
 
     proxyModel = new CustomSortFilterProxyModel(ui->tableView, this);
     proxyModel->setSourceModel(model);
-    proxyModel->setFilterCaseSensitivity(Qt::CaseInsensitive);
 
-    QSet<int> numeric_columns = {Column::FILESIZE};
+    QSet<int> numeric_columns = {Column::FILESIZE, Column::ENTROPY, Column::SIMILAR, Column::KNOWN, Column::VERIFY};
     proxyModel->setNumericSortingColumns(numeric_columns);
 
-    proxyModel->setDynamicSortFilter(false);
-
     headerSortingAdapter = new HeaderSortingAdapter(ui->tableView);
 
     ui->tableView->setModel(proxyModel);
@@ -74,19 +96,31 @@ Widget::Widget(QWidget *parent)
     ui->tableView->horizontalHeader()->setDefaultAlignment(Qt::AlignHCenter | Qt::AlignVCenter);
     ui->tableView->setIconSize(QSize(13,13));
 
-    CustomDelegate *custom_delegate = new CustomDelegate(ui->tableView);
-    ui->tableView->setItemDelegate(custom_delegate);
+    customDelegate = new CustomDelegate(ui->tableView);
+    ui->tableView->setItemDelegate(customDelegate);
 
-    connect(model, &QStandardItemModel::itemChanged, this, &Widget::onCellItemChanged);
     connect(model, &QStandardItemModel::itemChanged, this, &Widget::showFileStatistics);
-    connect(model, &QAbstractItemModel::rowsRemoved, this, &Widget::showFileStatistics);
+    connect(ui->tableView, &CustomTableView::rowsDeleted, this, &Widget::showFileStatistics);
+
+    pathTable = QSharedPointer<PathTable>::create();
+
+    snapshot_dirty = true;
+
+    snapshotWatcher = new QFutureWatcher<QSharedPointer<const TableSnapshot>>(this);
+    connect(snapshotWatcher, &QFutureWatcher<QSharedPointer<const TableSnapshot>>::finished, this, &Widget::onSnapshotEdited);
+
+    connect(model, &QAbstractItemModel::dataChanged, this, &Widget::onModelDataChanged);
+    connect(model, &QAbstractItemModel::rowsInserted, this, &Widget::onModelRowsInserted);
+    connect(model, &QAbstractItemModel::rowsRemoved, this, &Widget::onModelRowsRemoved);
+    connect(model, &QAbstractItemModel::modelReset, this, &Widget::invalidateSnapshot);
+    connect(proxyModel, &CustomSortFilterProxyModel::filterFinished, this, &Widget::showFileStatistics);
 
     connect(ui->tableView, &CustomTableView::copyRequested, this, &Widget::copySelectedCells);
     connect(ui->tableView->selectionModel(), &QItemSelectionModel::selectionChanged, this, &Widget::showFileStatistics);
     connect(ui->tableView->selectionModel(), &QItemSelectionModel::selectionChanged, this, &Widget::showSelectedFiles);
 
-    connect(custom_delegate, &CustomDelegate::duplicatesFound, this, &Widget::onDoublesFound);
-    connect(custom_delegate, &CustomDelegate::noDuplicatesFound, this, &Widget::onMissingDoubles);
+    connect(customDelegate, &CustomDelegate::duplicatesFound, this, &Widget::onDoublesFound);
+    connect(customDelegate, &CustomDelegate::noDuplicatesFound, this, &Widget::onMissingDoubles);
 
     connect(ui->stackedWidget, &QStackedWidget::currentChanged, this, &Widget::onPageChanged);
 
@@ -100,6 +134,11 @@ Widget::Widget(QWidget *parent)
     connect(fileProcessor, &FileProcessor::updateModel, this, &Widget::onFileProcessorUpdateModel);
     connect(fileProcessor, &FileProcessor::finishedProcessing, this, &Widget::onFileProcessingFinished);
 
+    connect(fileProcessor, &FileProcessor::startLoadingManifest, fileProcessor, &FileProcessor::loadManifest);
+    connect(fileProcessor, &FileProcessor::manifestLoaded, this, &Widget::onManifestLoaded);
+    connect(fileProcessor, &FileProcessor::startVerifying, fileProcessor, &FileProcessor::verifyManifest);
+    connect(fileProcessor, &FileProcessor::finishedVerifying, this, &Widget::onFileVerifyingFinished);
+
     connect(fileProcessor, &FileProcessor::startInitializingYara, fileProcessor, &FileProcessor::initializeYara);
     connect(fileProcessor, &FileProcessor::startLoadingCompilingYaraRules, fileProcessor, &FileProcessor::loadAndCompileYaraRules);
     connect(fileProcessor, &FileProcessor::finishedLoadingYaraRules, this, &Widget::onFinishedLoadingYaraRules);
@@ -109,6 +148,38 @@ Widget::Widget(QWidget *parent)
 
     file_processor_thread->start();
 
+    // a large import must not hold up the drops queued on the file processor
+    knownHashes = new HashDatabase();
+    importing_known_hashes = false;
+
+    knownHashLoader = new KnownHashLoader();
+    QThread *known_hash_thread = new QThread();
+    knownHashLoader->moveToThread(known_hash_thread);
+
+    connect(knownHashLoader, &KnownHashLoader::startLoading, knownHashLoader, &KnownHashLoader::load);
+    connect(knownHashLoader, &KnownHashLoader::importProgress, this, &Widget::onKnownHashImportProgress);
+    connect(knownHashLoader, &KnownHashLoader::importFinished, this, &Widget::onKnownHashImportFinished);
+    connect(knownHashLoader, &KnownHashLoader::knownHashesReady, this, &Widget::onKnownHashesReady);
+
+    known_hash_thread->start();
+    emit knownHashLoader->startLoading();
+
+    dirHasher = new DirHasher();
+
+    dirWatcher = new DirWatcher();
+    QThread *dir_watcher_thread = new QThread();
+    dirWatcher->moveToThread(dir_watcher_thread);
+
+    connect(dirWatcher, &DirWatcher::startWatching, dirWatcher, &DirWatcher::watch);
+    connect(dirWatcher, &DirWatcher::stopWatching, dirWatcher, &DirWatcher::clear);
+    connect(dirWatcher, &DirWatcher::filesChanged, this, &Widget::onWatchedFilesChanged);
+
+    dir_watcher_thread->start();
+
+    zipper = nullptr;
+    tarWriter = nullptr;
+    tableExporter = nullptr;
+
     processor = new ItemProcessor(this);
     connect(processor, &ItemProcessor::resultReady, this, &Widget::onResultReady);
     connect(processor, &ItemProcessor::processingFinished, this, &Widget::onProcessingFinished);
@@ -124,6 +195,11 @@ Widget::Widget(QWidget *parent)
     ui->btn_md5->setToolTip("MD5");
     ui->btn_sha1->setToolTip("SHA1");
     ui->btn_sha256->setToolTip("SHA256");
+    ui->btn_treehash->setToolTip("SHA256 Tree (parallel block hashing, cached)");
+    ui->btn_sampled->setToolTip("Quick Fingerprint (sampled, not a full digest)");
+    ui->btn_dirhash->setToolTip("Directory Tree Hash");
+    ui->btn_ssdeep->setToolTip("ssdeep (groups similar files)");
+    ui->btn_entropy->setToolTip("Entropy (search e.g. \"entropy > 7.5\")");
     ui->btn_yara->setToolTip("YARA");
 
     ui->btn_hide_doubles->setToolTip("Filter Out Doubles");
@@ -134,7 +210,7 @@ Widget::Widget(QWidget *parent)
     ui->btn_dirpath->setToolTip("Show Dirpath");
     ui->btn_fullpath->setToolTip("Show Fullpath");
     ui->btn_clipboard->setToolTip("Copy To Clipboard");
-    ui->btn_save->setToolTip("Save As .tsv");
+    ui->btn_save->setToolTip("Export (.tsv, .csv, .jsonl, sha256sum, md5sum)");
     ui->btn_zip->setToolTip("Zip File(s)");
     ui->btn_clear->setToolTip("Clear Table");
     ui->btn_about->setToolTip("Show Info");
@@ -142,6 +218,7 @@ Widget::Widget(QWidget *parent)
     ui->btn_match_case->setToolTip("Case Sensitive");
     ui->btn_whole_word->setToolTip("Whole Words");
     ui->btn_regex->setToolTip("Regex");
+    ui->btn_hash_list->setToolTip("Load Hash List (pasted lists are detected automatically)");
 
     ui->btn_yara_status->setToolTip("Show YARA Output");
 
@@ -182,6 +259,8 @@ Widget::Widget(QWidget *parent)
 Widget::~Widget()
 {
     delete ui;
+    delete dirHasher;
+    delete knownHashes;
     writeSettings();
 }
 
@@ -221,14 +300,26 @@ void Widget::dragLeaveEvent(QDragLeaveEvent *event)
 
 void Widget::dropEvent(QDropEvent *event)
 {
-    row_count = model->rowCount();
-
     drop_area_svg->load(QString(":/img/drop-area-normal.svg"));
     urls = event->mimeData()->urls();
 
     if(urls.isEmpty())
         return;
 
+    // a single dropped checksum manifest is verified instead of listed, unless it has no usable lines
+    if(urls.size() == 1 && Manifest::isManifest(urls.first().toLocalFile()))
+    {
+        startVerification(urls.first().toLocalFile());
+        return;
+    }
+
+    startListing();
+}
+
+
+// the dropped urls are listed by the file processor and hashed once all of them are known
+void Widget::startListing()
+{
     bool all_dirs_empty = true;
     for(const QUrl &url : urls)
     {
@@ -245,9 +336,54 @@ void Widget::dropEvent(QDropEvent *event)
     if(all_dirs_empty)
         return;
 
+    // verify states only make sense for the manifest's own files
+    if(verifying)
+        on_btn_clear_clicked();
+
+    row_count = model->rowCount();
+    prepareTable(QSet<QString>());
+
+    // directory hashes are built from the strongest selected full digest
+    dirHasher->clear();
+    dir_hash_algorithm = sha256 ? "SHA256" : sha1 ? "SHA1" : md5 ? "MD5" : treehash ? "TREE" : "";
+
+    if(dirhash && !dir_hash_algorithm.isEmpty())
+    {
+        for(const QUrl &url : urls)
+        {
+            if(QFileInfo(url.toLocalFile()).isDir())
+                dirHasher->addRoot(url.toLocalFile());
+        }
+    }
+
+    // the empty result cells of the new rows show the loading animation until all files are processed and hashed
+    customDelegate->setPending(true);
+
+    emit fileProcessor->startProcessing(urls, yara, pathTable);
+
+    if(watch_folders)
+    {
+        QStringList dir_paths;
+        for(const QUrl &url : urls)
+        {
+            if(QFileInfo(url.toLocalFile()).isDir())
+                dir_paths.append(url.toLocalFile());
+        }
+
+        if(!dir_paths.isEmpty())
+            emit dirWatcher->startWatching(dir_paths, watch_quiet_ms);
+    }
+}
+
+
+// an empty set of algorithms lists dropped files, otherwise a manifest is verified
+void Widget::prepareTable(const QSet<QString> &verify_algorithms)
+{
+    verifying = !verify_algorithms.isEmpty();
+
     setAcceptDrops(false);
 
-    file_hash_list.clear();
+    hardlink_list.clear();
 
     processed_items = 0;
 
@@ -281,16 +417,25 @@ void Widget::dropEvent(QDropEvent *event)
 
     model->setColumnCount(Column::NUM_COLUMNS);
 
+    // a verification shows the digests the manifest lists and nothing that isn't computed for it
     QStringList header_labels;
     header_labels << "Filename"
-                  << (md5 ? "MD5" : "")
-                  << (sha1 ? "SHA1" : "")
-                  << (sha256 ? "SHA256" : "")
-                  << (yara ? "YARA" : "")
+                  << ((verifying ? verify_algorithms.contains("MD5") : md5) ? "MD5" : "")
+                  << ((verifying ? verify_algorithms.contains("SHA1") : sha1) ? "SHA1" : "")
+                  << ((verifying ? verify_algorithms.contains("SHA256") : sha256) ? "SHA256" : "")
+                  << (treehash && !verifying ? "SHA256 Tree" : "")
+                  << (sampled && !verifying ? "Quick (sampled)" : "")
+                  << (ssdeep && !verifying ? "ssdeep" : "")
+                  << (ssdeep && !verifying ? "Similar" : "")
+                  << (dirhash && !verifying ? "Dir Hash" : "")
+                  << (yara && !verifying ? "YARA" : "")
+                  << (knownHashes->isOpen() && !verifying ? "Known" : "")
+                  << (verifying ? "Verify" : "")
                   << (show_filesize ? "Filesize" : "")
+                  << (entropy && !verifying ? "Entropy" : "")
                   << (show_extension ? "Ext" : "")
-                  << (show_mimetype ? "MIME type" : "")
-                  << (show_filetype ? "Filetype" : "")
+                  << (show_mimetype && !verifying ? "MIME type" : "")
+                  << (show_filetype && !verifying ? "Filetype" : "")
                   << (show_dirpath ? "Dirpath" : "")
                   << (show_fullpath ? "Fullpath" : "")
         ;
@@ -304,64 +449,96 @@ void Widget::dropEvent(QDropEvent *event)
             ui->tableView->setColumnHidden(i, false);
     }
     setColumnHeaders();
+}
 
-    emit fileProcessor->startProcessing(urls, yara);
+
+// the manifest is parsed on the file processor thread, drops wait until it is verified or listed
+void Widget::startVerification(const QString &manifest_path)
+{
+    setAcceptDrops(false);
+    emit fileProcessor->startLoadingManifest(manifest_path);
 }
 
 
-void Widget::addLoadingGifToEmptyCells(QTableView *tableView)
+// a manifest without usable lines is listed like any other dropped file
+void Widget::onManifestLoaded(const QStringList &algorithms)
 {
-    for(int row = 0; row < model->rowCount(); ++row)
+    if(algorithms.isEmpty())
     {
-        for(int col = 0; col < model->columnCount(); ++col)
-        {
-            QStandardItem *item = model->item(row, col);
+        startListing();
+        return;
+    }
 
-            if(!item || item->text().isEmpty())
-            {
-                QLabel *gif_label = new QLabel();
-                gif_label->setMovie(movie);
+    if(model->rowCount() > 0)
+        on_btn_clear_clicked();
 
-                gif_label->setAlignment(Qt::AlignCenter);
-                gif_label->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+    row_count = 0;
+    prepareTable(QSet<QString>(algorithms.constBegin(), algorithms.constEnd()));
 
-                gif_label->setAttribute(Qt::WA_TranslucentBackground, true);
+    dirHasher->clear();
+    dir_hash_algorithm.clear();
 
-                QModelIndex source_index = model->index(row, col);
-                QModelIndex proxy_index = proxyModel->mapFromSource(source_index);
-                tableView->setIndexWidget(proxy_index, gif_label);
-            }
-        }
-    }
+    expected_digests.clear();
+    verify_rows.clear();
+
+    customDelegate->setPending(true);
+
+    emit fileProcessor->startVerifying(pathTable);
 }
 
 
-void Widget::addDashToEmptyCells(QTableView *tableView)
+// missing and unlisted files were decided while the rows came in, the listed files are hashed
+// with only the algorithm of their digest
+void Widget::onFileVerifyingFinished(const QHash<int, Digest> *expected_digests, const QStringList *file_paths, const QStringList *file_algorithms)
 {
-    for (int row = 0; row < proxyModel->rowCount(); ++row)
-    {
-        for (int col = 0; col < proxyModel->columnCount(); ++col)
-        {
-            QModelIndex proxyIndex = proxyModel->index(row, col);
-            QModelIndex sourceIndex = proxyModel->mapToSource(proxyIndex);
-            QStandardItem *item = model->itemFromIndex(sourceIndex);
-            QWidget *cell_widget = tableView->indexWidget(proxyIndex);
+    ui->progressBar->hide();
+    ui->lbl_status_files->show();
 
-            if (cell_widget)
-            {
-                tableView->setIndexWidget(proxyIndex, nullptr);
-                delete cell_widget;
-                item->setText("-");
-            } else if(item->text().isEmpty())
-            {
-                item->setText("-");
-            }
-        }
+    this->expected_digests = *expected_digests;
+
+    // paths listed twice have no row of their own
+    model->setRowCount(row_count);
+
+    file_count = file_paths->size();
+    item_count = file_paths->size();
+
+    if(file_paths->isEmpty())
+    {
+        onProcessingFinished("0");
+        return;
     }
+
+    processor->startVerification(*file_paths, *file_algorithms);
+
+    ui->progressBar->show();
+    ui->progressBar->setRange(0, item_count);
+    ui->progressBar->setValue(processed_items);
+    ui->progressBar->setFormat(QString("verifying: %1/%2").arg(ui->progressBar->value()).arg(ui->progressBar->maximum()));
+}
+
+
+void Widget::setVerifyState(int row, Manifest::Status status, const QString &tool_tip)
+{
+    QStandardItem *verify_item = new QStandardItem(Manifest::statusText(status));
+    verify_item->setData(int(status), Qt::UserRole);
+
+    if(status == Manifest::Verified)
+        verify_item->setData(QColor(118,189,140,255), Qt::ForegroundRole);
+    else if(status == Manifest::Missing)
+        verify_item->setData(QColor(255,200,121,255), Qt::ForegroundRole);
+    else if(status == Manifest::Extra)
+        verify_item->setData(QColor(118,164,189,255), Qt::ForegroundRole);
+    else
+        verify_item->setData(QColor(255,75,92,255), Qt::ForegroundRole);
+
+    if(!tool_tip.isEmpty())
+        verify_item->setToolTip(tool_tip);
+
+    model->setItem(row, Column::VERIFY, verify_item);
 }
 
 
-void Widget::copySelectedCells(QTableView *tableView, bool copy_headers, bool copy_to_file)
+void Widget::copySelectedCells(QTableView *tableView)
 {
     QItemSelectionModel *selectionModel = tableView->selectionModel();
     QModelIndexList selectedIndexes = selectionModel->selectedIndexes();
@@ -384,22 +561,6 @@ void Widget::copySelectedCells(QTableView *tableView, bool copy_headers, bool co
 
     QString copiedData;
 
-    if(copy_headers)
-    {
-        QAbstractItemModel *headerModel = tableView->horizontalHeader()->model();
-        int headerCount = headerModel->columnCount();
-        for(int i = 0; i < headerCount; ++i)
-        {
-            if(!tableView->isColumnHidden(i))
-            {
-                QVariant headerData = headerModel->headerData(i, Qt::Horizontal);
-                copiedData.append(headerData.toString().append("\t"));
-            }
-        }
-        copiedData.chop(1);
-        copiedData.append("\n");
-    }
-
     int previousRow = visibleSelectedIndexes.first().row();
     for (const QModelIndex &index : visibleSelectedIndexes) {
         if (index.row() != previousRow) {
@@ -413,38 +574,15 @@ void Widget::copySelectedCells(QTableView *tableView, bool copy_headers, bool co
             cellData = index.data(Qt::UserRole);
         else
             cellData = index.data();
-        copiedData.append(cellData.toString()).append("\t");
+
+        // empty cells are drawn as a dash by the delegate
+        QString cellText = cellData.toString();
+        copiedData.append(cellText.isEmpty() ? QString("-") : cellText).append("\t");
     }
     copiedData.chop(1);
 
     QClipboard *clipboard = QApplication::clipboard();
     clipboard->setText(copiedData);
-
-    if(copy_to_file)
-    {
-        QFileDialog file_dialog(this, "Save to .tsv");
-        file_dialog.setAcceptMode(QFileDialog::AcceptSave);
-        file_dialog.setFileMode(QFileDialog::AnyFile);
-        file_dialog.setNameFilter("Tab Separated Value Files (*.tsv);;All Files (*)");
-        file_dialog.setDefaultSuffix("tsv");
-
-        if(file_dialog.exec() == QDialog::Accepted)
-        {
-            QString file_path = file_dialog.selectedFiles().at(0);
-            if(clipboard->mimeData()->hasText())
-            {
-                QString text_data = clipboard->text();
-
-                QFile file(file_path);
-                if(file.open(QIODevice::WriteOnly | QIODevice::Text))
-                {
-                    QTextStream out(&file);
-                    out << text_data;
-                    file.close();
-                }
-            }
-        }
-    }
 }
 
 
@@ -499,8 +637,16 @@ void Widget::setColumnHeaders()
     ui->tableView->setColumnWidth(Column::MD5, 245);
     ui->tableView->setColumnWidth(Column::SHA1, 300);
     ui->tableView->setColumnWidth(Column::SHA256, 465);
+    ui->tableView->setColumnWidth(Column::TREEHASH, 465);
+    ui->tableView->setColumnWidth(Column::SAMPLED, 475);
+    ui->tableView->setColumnWidth(Column::SSDEEP, 300);
+    ui->tableView->setColumnWidth(Column::SIMILAR, 70);
+    ui->tableView->setColumnWidth(Column::DIRHASH, 465);
     ui->tableView->setColumnWidth(Column::YARA, 300);
+    ui->tableView->setColumnWidth(Column::KNOWN, 90);
+    ui->tableView->setColumnWidth(Column::VERIFY, 90);
     ui->tableView->setColumnWidth(Column::FILESIZE, 100);
+    ui->tableView->setColumnWidth(Column::ENTROPY, 70);
     ui->tableView->setColumnWidth(Column::FILE_EXTENSION, 50);
     ui->tableView->setColumnWidth(Column::MIMETYPE, 300);
     ui->tableView->setColumnWidth(Column::FILETYPE, 300);
@@ -573,48 +719,128 @@ void Widget::showButtons()
 }
 
 
-void Widget::onResultReady(const QString &result)
+void Widget::onResultReady(const HashResult &result)
 {
+    // archive members become rows of their own before their digests arrive
+    if(result.algorithm == "MEMBER")
+    {
+        addMemberRow(result);
+        return;
+    }
+
+    if(result.algorithm == "YARA")
+    {
+        const int path_id = pathTable->find(result.path);
+        for(int row = model->rowCount() - 1; row >= 0; --row)
+        {
+            if(PathItem::pathId(model->index(row, Column::FULLPATH)) != path_id)
+                continue;
+
+            QStandardItem *yara_item = new QStandardItem(result.value);
+            if(!result.value.isEmpty())
+                yara_item->setData(QColor(255,200,121,255), Qt::ForegroundRole);
+            model->setItem(row, Column::YARA, yara_item);
+            break;
+        }
+        return;
+    }
+
     ui->progressBar->setValue(++processed_items);
     ui->progressBar->setFormat(QString("hashing files: %1/%2").arg(ui->progressBar->value()).arg(ui->progressBar->maximum()));
 
-    QStringList columns = result.split("\t");
-    QString hash_type = columns[0];
-    QString hash_value = columns[1];
-    QString file_path = columns[2];
+    if(result.algorithm == "ERROR")
+    {
+        qWarning() << result.value;
+
+        const int path_id = pathTable->find(result.path);
+        customDelegate->removePendingPath(path_id);
+        for(int linked_id : hardlink_list.value(path_id))
+            customDelegate->removePendingPath(linked_id);
+
+        const int row = verifying ? verify_rows.value(path_id, -1) : -1;
+        if(row != -1)
+            setVerifyState(row, Manifest::Unreadable, result.value);
+
+        // the directory hashes above an unreadable file still complete, marked as failed
+        if(!dirHasher->roots().isEmpty())
+        {
+            QStringList completed_dirs = dirHasher->setFileFailed(result.path);
+            for(int linked_id : hardlink_list.value(path_id))
+                completed_dirs.append(dirHasher->setFileFailed(pathTable->filePath(linked_id)));
+
+            if(!completed_dirs.isEmpty())
+                updateDirHashes(completed_dirs);
+        }
+        return;
+    }
+
+    static const QHash<QString, int> digest_columns = {
+        {"MD5", Column::MD5},
+        {"SHA1", Column::SHA1},
+        {"SHA256", Column::SHA256},
+        {"TREE", Column::TREEHASH},
+        {"SAMPLED", Column::SAMPLED}
+    };
 
-    if(!file_hash_list.contains(file_path))
+    const int digest_column = digest_columns.value(result.algorithm, -1);
+    const int path_id = pathTable->find(result.path);
+    if(path_id == -1)
+        return;
+
+    // a verified file has exactly one row and one digest, no row scan needed
+    if(verifying)
     {
-        file_hash_list[file_path] = QStringList() << "" //MD5
-                                                  << "" //SHA1
-                                                  << ""; //SHA256
+        const int row = verify_rows.value(path_id, -1);
+        if(row == -1 || digest_column == -1)
+            return;
+
+        model->setItem(row, digest_column, new DigestItem(result.digest));
+
+        const Digest expected = expected_digests.value(path_id);
+        if(result.digest == expected)
+            setVerifyState(row, Manifest::Verified, QString());
+        else
+            setVerifyState(row, Manifest::Mismatch, "Expected " + expected.toHex());
+        return;
     }
 
-    if(hash_type == "MD5")
-        file_hash_list[file_path][0] = hash_value;
-    else if(hash_type == "SHA1")
-        file_hash_list[file_path][1] = hash_value;
-    else if(hash_type == "SHA256")
-        file_hash_list[file_path][2] = hash_value;
+    const QList<int> linked_ids = hardlink_list.value(path_id);
+    QStringList completed_dirs;
 
     int rows = model->rowCount();
     for(int row = 0; row < rows; ++row)
     {
-        QStandardItem *full_path_column = model->item(row, Column::FULLPATH);
-        if(file_path == full_path_column->text())
+        const int row_path_id = PathItem::pathId(model->index(row, Column::FULLPATH));
+        if(row_path_id == path_id || linked_ids.contains(row_path_id))
         {
-            QStandardItem *md5_item = new QStandardItem(file_hash_list[file_path].at(0));
-            model->setItem(row, Column::MD5, md5_item);
+            if(digest_column != -1)
+                model->setItem(row, digest_column, new DigestItem(result.digest));
+
+            if(result.algorithm == "ENTROPY")
+            {
+                QStandardItem *entropy_item = new QStandardItem(result.value);
+                entropy_item->setData(result.value.toDouble(), Qt::UserRole);
+                entropy_item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+                if(!result.detail.isEmpty())
+                    entropy_item->setToolTip(result.detail);
+                model->setItem(row, Column::ENTROPY, entropy_item);
+            }
+
+            if(result.algorithm == "SSDEEP")
+                model->setItem(row, Column::SSDEEP, new QStandardItem(result.value));
 
-            QStandardItem *sha1_item = new QStandardItem(file_hash_list[file_path].at(1));
-            model->setItem(row, Column::SHA1, sha1_item);
+            if(result.algorithm == "MD5" || result.algorithm == "SHA1" || result.algorithm == "SHA256")
+                markKnownHash(row, result.digest);
 
-            QStandardItem *sha256_item = new QStandardItem(file_hash_list[file_path].at(2));
-            model->setItem(row, Column::SHA256, sha256_item);
+            if(result.algorithm == dir_hash_algorithm)
+                completed_dirs.append(dirHasher->setFileDigest(pathTable->filePath(row_path_id), result.digest.toRawByteArray()));
 
             setColumnHeaders();
         }
     }
+
+    if(!completed_dirs.isEmpty())
+        updateDirHashes(completed_dirs);
 }
 
 
@@ -622,36 +848,53 @@ void Widget::onProcessingFinished(const QString &result)
 {
     ui->progressBar->hide();
 
-    if(!(model->rowCount() > 1000))
-        ui->frame_search->show();
+    ui->frame_search->show();
 
     ui->lbl_clock->show();
     ui->lbl_status->show();
     ui->lbl_status->setText((QString::number(file_count) + " %1 hashed in " + result + " seconds").arg((file_count == 1) ? "File" : "Files"));
 
-    ui->tableView->setSortingEnabled(true);
+    if(verifying)
+    {
+        QList<int> state_counts(5, 0);
+        for(int row = 0; row < model->rowCount(); ++row)
+        {
+            const QStandardItem *verify_item = model->item(row, Column::VERIFY);
+            if(verify_item)
+                ++state_counts[verify_item->data(Qt::UserRole).toInt()];
+        }
+
+        ui->lbl_status->setText(ui->lbl_status->text() + QString(" | %1 ok, %2 mismatched, %3 missing, %4 unreadable, %5 extra")
+                                    .arg(state_counts.at(Manifest::Verified)).arg(state_counts.at(Manifest::Mismatch))
+                                    .arg(state_counts.at(Manifest::Missing)).arg(state_counts.at(Manifest::Unreadable))
+                                    .arg(state_counts.at(Manifest::Extra)));
+
+        // rows are looked up by position only while the results come in
+        verify_rows.clear();
+    }
+
+    if(!dirHasher->roots().isEmpty())
+    {
+        // refresh the ancestor chains in the tooltips once all directories are complete
+        updateDirHashes(QStringList());
+        markTreeDifferences();
+    }
 
-    addDashToEmptyCells(ui->tableView);
+    if(ssdeep && !verifying)
+        groupSimilarFiles();
+
+    customDelegate->setPending(false);
     setColumnHeaders();
 
+    // with the snapshot in place, sorting a large table runs in the background
+    takeSnapshot();
+    ui->tableView->setSortingEnabled(true);
+
     showButtons();
     setAcceptDrops(true);
-}
 
-
-void Widget::onCellItemChanged(QStandardItem *item)
-{
-    if(!item->text().isEmpty())
-    {
-        QModelIndex source_index = item->index();
-        QModelIndex proxy_index = proxyModel->mapFromSource(source_index);
-        QWidget *cell_widget = ui->tableView->indexWidget(proxy_index);
-        if(cell_widget)
-        {
-            ui->tableView->setIndexWidget(proxy_index, nullptr);
-            delete cell_widget;
-        }
-    }
+    if(!pending_changed_paths.isEmpty() || !pending_removed_paths.isEmpty())
+        QTimer::singleShot(0, this, &Widget::applyWatchedChanges);
 }
 
 
@@ -739,7 +982,7 @@ void Widget::onFileProcessorFileCountSum(int count)
     model->setRowCount(model->rowCount() + count);
     file_count = count;
 
-    if(!md5 && !sha1 && !sha256)
+    if(!md5 && !sha1 && !sha256 && !treehash && !sampled && !entropy && !ssdeep)
         item_count = file_count;
     else
     {
@@ -750,6 +993,14 @@ void Widget::onFileProcessorFileCountSum(int count)
             ++multiplicator;
         if(sha256)
             ++multiplicator;
+        if(treehash)
+            ++multiplicator;
+        if(sampled)
+            ++multiplicator;
+        if(entropy)
+            ++multiplicator;
+        if(ssdeep)
+            ++multiplicator;
 
         item_count = multiplicator * file_count;
     }
@@ -767,9 +1018,46 @@ void Widget::onFileProcessorFileCount(int count)
 }
 
 
-void Widget::onFileProcessorUpdateModel(const QStringList &data)
+void Widget::onFileProcessorUpdateModel(int path_id, const QStringList &data)
+{
+    // a verify cell is only filled, with the Manifest::Status value, for rows that aren't hashed,
+    // the others are found by path id
+    if(verifying)
+    {
+        const int row = row_count;
+        addRow(path_id, data);
+
+        bool has_state;
+        const int state = data.at(Column::VERIFY).toInt(&has_state);
+        if(!has_state)
+        {
+            verify_rows.insert(path_id, row);
+            customDelegate->addPendingPath(path_id);
+        }
+        else if(state == Manifest::Missing)
+            setVerifyState(row, Manifest::Missing, "Listed in the manifest, but not found");
+        else
+            setVerifyState(row, Manifest::Extra, "Not listed in the manifest");
+        return;
+    }
+
+    if(!dirHasher->roots().isEmpty())
+        dirHasher->addFile(pathTable->filePath(path_id));
+
+    addRow(path_id, data);
+    customDelegate->addPendingPath(path_id);
+}
+
+
+void Widget::addRow(int path_id, const QStringList &data)
 {
     for(int col = 0; col < data.size(); ++col){
+        if(col == Column::FULLPATH || col == Column::DIRPATH)
+        {
+            model->setItem(row_count, col, new PathItem(pathTable.data(), path_id, col == Column::FULLPATH ? PathItem::FullPath : PathItem::ShortPath));
+            continue;
+        }
+
         QStandardItem *item = new QStandardItem(data.at(col));
 
         if(col == Column::FILESIZE)
@@ -814,17 +1102,57 @@ void Widget::onFileProcessorUpdateModel(const QStringList &data)
 }
 
 
-void Widget::onFileProcessingFinished(const QHash<QString, QStringList> *file_list)
+// members are left out of the directory hashes, their digests extend the hashing progress
+void Widget::addMemberRow(const HashResult &result)
+{
+    const int path_id = pathTable->add(result.path);
+    const QString file_name = pathTable->fileName(path_id);
+
+    QStringList data;
+    for(int i = 0; i < Column::NUM_COLUMNS; ++i)
+        data.append("");
+
+    QLocale locale;
+    data.replace(Column::FILENAME, file_name);
+    data.replace(Column::FILESIZE, locale.toString(result.size));
+    data.replace(Column::FILE_EXTENSION, QFileInfo(file_name).suffix());
+    data.replace(Column::MIMETYPE, result.value);
+    data.replace(Column::FILETYPE, result.detail);
+
+    addRow(path_id, data);
+    customDelegate->addPendingPath(path_id);
+
+    item_count += int(md5) + int(sha1) + int(sha256) + int(sampled) + int(entropy) + int(ssdeep);
+    ui->progressBar->setMaximum(item_count);
+}
+
+
+void Widget::onFileProcessingFinished(const QHash<int, QStringList> *file_list, const QHash<int, QList<int>> *hardlink_list)
 {
     ui->progressBar->hide();
     ui->lbl_status_files->show();
 
-    if(file_list->size() < 500)
-        addLoadingGifToEmptyCells(ui->tableView);
+    this->hardlink_list = *hardlink_list;
+    if(!this->hardlink_list.isEmpty())
+        markHardlinkedFiles();
 
-    if(md5 || sha1 || sha256)
+    // hardlinked paths are hashed only once, so only unique files produce results
+    if(md5 || sha1 || sha256 || treehash || sampled || entropy || ssdeep)
+        item_count = (int(md5) + int(sha1) + int(sha256) + int(treehash) + int(sampled) + int(entropy) + int(ssdeep)) * file_list->size();
+
+    if(md5 || sha1 || sha256 || treehash || sampled || entropy || ssdeep)
     {
-        processor->startProcessing(file_list, md5, sha1, sha256);
+        processor->setSampling(sample_edge_size, sample_block_count);
+        processor->setTreeBlockSize(tree_block_size);
+        processor->setEntropyBlockSize(entropy_block_size);
+        processor->setArchives(archive_depth, archive_member_size, yara ? fileProcessor->yaraScanner() : nullptr);
+
+        QStringList file_paths;
+        file_paths.reserve(file_list->size());
+        for(auto it = file_list->constBegin(); it != file_list->constEnd(); ++it)
+            file_paths.append(pathTable->filePath(it.key()));
+
+        processor->startProcessing(file_paths, md5, sha1, sha256, sampled, treehash, entropy, ssdeep);
 
         ui->progressBar->show();
         ui->progressBar->setRange(0, item_count);
@@ -836,102 +1164,636 @@ void Widget::onFileProcessingFinished(const QHash<QString, QStringList> *file_li
     {
         ui->progressBar->hide();
         ui->lbl_status->show();
+        customDelegate->setPending(false);
+
+        takeSnapshot();
         ui->tableView->setSortingEnabled(true);
         setAcceptDrops(true);
-        addDashToEmptyCells(ui->tableView);
-
-        if(!(model->rowCount() > 1000))
-            ui->frame_search->show();
+        ui->frame_search->show();
 
         showButtons();
 
+        if(!pending_changed_paths.isEmpty() || !pending_removed_paths.isEmpty())
+            QTimer::singleShot(0, this, &Widget::applyWatchedChanges);
+
         setColumnHeaders();
     }
 }
 
 
-void Widget::on_btn_clear_clicked()
+void Widget::markHardlinkedFiles()
 {
-    model->clear();
-    hideButtons();
-    ui->stackedWidget->setCurrentWidget(ui->page_drop);
-    doubles_found = false;
-    ui->btn_hide_doubles->setDisabled(true);
-}
+    QHash<int, QStringList> link_groups;
+    for(auto it = hardlink_list.constBegin(); it != hardlink_list.constEnd(); ++it)
+    {
+        QList<int> group_ids = QList<int>() << it.key() << it.value();
 
+        QStringList group;
+        for(int path_id : group_ids)
+            group.append(pathTable->filePath(path_id));
 
-void Widget::on_btn_clipboard_clicked()
-{
-    copySelectedCells(ui->tableView, false, false);
-}
+        for(int path_id : group_ids)
+            link_groups[path_id] = group;
+    }
 
+    QColor foreground_color(118,164,189,255);
 
-void Widget::on_btn_save_clicked()
-{
-    copySelectedCells(ui->tableView, true, true);
+    for(int row = 0; row < model->rowCount(); ++row)
+    {
+        const int path_id = PathItem::pathId(model->index(row, Column::FULLPATH));
+        if(!link_groups.contains(path_id))
+            continue;
+
+        const QStringList &group = link_groups[path_id];
+
+        QStandardItem *file_name_item = model->item(row, Column::FILENAME);
+        file_name_item->setData(foreground_color, Qt::ForegroundRole);
+        file_name_item->setToolTip(QString("Hardlinked (%1 paths, hashed once):\n%2").arg(group.size()).arg(group.join("\n")));
+    }
 }
 
 
-void Widget::on_lineEdit_search_textChanged(const QString &arg1)
+void Widget::updateDirHashes(const QStringList &dir_paths)
 {
-    if (ui->btn_regex->isChecked())
-    {
-        QRegularExpression regex(arg1, proxyModel->filterCaseSensitivity() == Qt::CaseSensitive ? QRegularExpression::NoPatternOption : QRegularExpression::CaseInsensitiveOption);
-        if(regex.isValid())
-        {
-            proxyModel->setFilterRegularExpression(regex);
-            ui->lineEdit_search->setStyleSheet("");
-        }
-        else
-            ui->lineEdit_search->setStyleSheet("background-color: rgba(255, 75, 92, .5); border-color: rgba(255, 75, 92, .5);");
-    }
-    else if(ui->btn_whole_word->isChecked())
+    QSet<QString> dir_set(dir_paths.constBegin(), dir_paths.constEnd());
+
+    for(int row = 0; row < model->rowCount(); ++row)
     {
-        QString whole_word_pattern = QString("\\b%1\\b").arg(arg1);
-        QRegularExpression regex(whole_word_pattern, proxyModel->filterCaseSensitivity() == Qt::CaseSensitive ? QRegularExpression::NoPatternOption : QRegularExpression::CaseInsensitiveOption);
-        if(regex.isValid())
+        QStandardItem *full_path_item = model->item(row, Column::FULLPATH);
+        if(!full_path_item)
+            continue;
+
+        QString file_path = full_path_item->text();
+        QString dir_path = QFileInfo(file_path).absolutePath();
+
+        if(dir_set.isEmpty() ? dirHasher->root(dir_path).isEmpty() : !dir_set.contains(dir_path))
+            continue;
+
+        QByteArray dir_hash = dirHasher->digest(dir_path);
+        if(dir_hash.isEmpty())
+            continue;
+
+        QStandardItem *dir_hash_item = new DigestItem(Digest(dir_hash.constData(), dir_hash.size()));
+        dir_hash_item->setToolTip(dirHasher->hashChain(file_path));
+
+        if(dirHasher->failed(dir_path))
         {
-            proxyModel->setFilterRegularExpression(regex);
-            ui->lineEdit_search->setStyleSheet("");
+            dir_hash_item->setData(QColor(255,75,92,255), Qt::ForegroundRole);
+            dir_hash_item->setToolTip("Includes files that couldn't be read\n" + dir_hash_item->toolTip());
         }
-        else
-            ui->lineEdit_search->setStyleSheet("background-color: rgba(255, 75, 92, .5); border-color: rgba(255, 75, 92, .5);");
-    }
-    else
-    {
-        proxyModel->setFilterWildcard(arg1);
-        ui->lineEdit_search->setStyleSheet("");
+        model->setItem(row, Column::DIRHASH, dir_hash_item);
     }
 }
 
 
-void Widget::on_btn_match_case_toggled(bool checked)
+void Widget::markTreeDifferences()
 {
-    if(checked)
+    const QStringList roots = dirHasher->roots();
+    if(roots.size() != 2)
+        return;
+
+    const QStringList differences = dirHasher->diff(roots.at(0), roots.at(1));
+
+    if(differences.isEmpty())
     {
-        case_option_set = true;
-        proxyModel->setFilterCaseSensitivity(Qt::CaseSensitive);
+        ui->lbl_status->setText(ui->lbl_status->text() + " | dropped trees are identical");
+        return;
     }
-    else
+
+    ui->lbl_status->setText(ui->lbl_status->text() + QString(" | %1 %2 between dropped trees").arg(differences.size()).arg(differences.size() == 1 ? "difference" : "differences"));
+
+    QSet<QString> different_files;
+    QStringList different_dirs;
+    for(const QString &difference : differences)
     {
-        case_option_set = false;
-        proxyModel->setFilterCaseSensitivity(Qt::CaseInsensitive);
+        if(difference.endsWith('/'))
+            different_dirs.append(difference);
+        else
+            different_files.insert(difference);
     }
 
-    ui->lineEdit_search->setFocus();
-}
+    QColor foreground_color(255,75,92,255);
 
+    for(int row = 0; row < model->rowCount(); ++row)
+    {
+        QStandardItem *full_path_item = model->item(row, Column::FULLPATH);
+        if(!full_path_item)
+            continue;
 
-void Widget::on_btn_whole_word_toggled(bool checked)
+        QString file_path = full_path_item->text();
+        QString root_path = dirHasher->root(file_path);
+        if(root_path.isEmpty())
+            continue;
+
+        QString relative_path = file_path.mid(root_path.size() + (root_path.endsWith('/') ? 0 : 1));
+
+        bool differs = different_files.contains(relative_path);
+        for(int i = 0; !differs && i < different_dirs.size(); ++i)
+            differs = relative_path.startsWith(different_dirs.at(i));
+
+        if(differs)
+        {
+            QStandardItem *file_name_item = model->item(row, Column::FILENAME);
+            file_name_item->setData(foreground_color, Qt::ForegroundRole);
+            file_name_item->setToolTip("Differs between the dropped trees");
+        }
+    }
+}
+
+
+void Widget::groupSimilarFiles()
+{
+    SimilarityIndex similarity_index;
+
+    for(int row = 0; row < model->rowCount(); ++row)
+    {
+        QStandardItem *ssdeep_item = model->item(row, Column::SSDEEP);
+        if(ssdeep_item && !ssdeep_item->text().isEmpty())
+            similarity_index.add(row, ssdeep_item->text());
+    }
+
+    const QHash<int, int> groups = similarity_index.groups(ssdeep_threshold);
+
+    QHash<int, int> group_sizes;
+    for(auto it = groups.constBegin(); it != groups.constEnd(); ++it)
+        ++group_sizes[it.value()];
+
+    for(auto it = groups.constBegin(); it != groups.constEnd(); ++it)
+    {
+        QStandardItem *similar_item = new QStandardItem(QString::number(it.value()));
+        similar_item->setData(it.value(), Qt::UserRole);
+        similar_item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+        similar_item->setToolTip(QString("Similarity group %1 (%2 files, ssdeep score >= %3)").arg(it.value()).arg(group_sizes.value(it.value())).arg(ssdeep_threshold));
+        model->setItem(it.key(), Column::SIMILAR, similar_item);
+    }
+}
+
+
+void Widget::markKnownHash(int row, const Digest &digest)
+{
+    if(!knownHashes->isOpen())
+        return;
+
+    HashDatabase::Status status = knownHashes->lookup(digest.toRawByteArray());
+
+    // a row keeps the worst verdict of its digests
+    QStandardItem *known_item = model->item(row, Column::KNOWN);
+    if(known_item && !known_item->text().isEmpty() && known_item->data(Qt::UserRole).toInt() >= status)
+        return;
+
+    known_item = new QStandardItem(HashDatabase::statusText(status));
+    known_item->setData(int(status), Qt::UserRole);
+
+    if(status == HashDatabase::KnownBad)
+        known_item->setData(QColor(255,75,92,255), Qt::ForegroundRole);
+    else if(status == HashDatabase::KnownGood)
+        known_item->setData(QColor(118,189,140,255), Qt::ForegroundRole);
+
+    model->setItem(row, Column::KNOWN, known_item);
+}
+
+
+void Widget::on_btn_clear_clicked()
+{
+    model->clear();
+
+    // snapshots still held by background passes keep the old table alive
+    pathTable = QSharedPointer<PathTable>::create();
+    hideButtons();
+    ui->stackedWidget->setCurrentWidget(ui->page_drop);
+    doubles_found = false;
+    ui->btn_hide_doubles->setDisabled(true);
+
+    verifying = false;
+    expected_digests.clear();
+    verify_rows.clear();
+
+    emit dirWatcher->stopWatching();
+    pending_changed_paths.clear();
+    pending_removed_paths.clear();
+}
+
+
+// a pass that is still running finishes first, the changes are applied after it
+void Widget::onWatchedFilesChanged(const QStringList &changed_paths, const QStringList &removed_paths)
+{
+    pending_changed_paths.append(changed_paths);
+    pending_removed_paths.append(removed_paths);
+
+    if(acceptDrops())
+        applyWatchedChanges();
+}
+
+
+// the rows of changed and deleted files are removed in one go, changed files come back through
+// the file processor and the hashing like a drop of just those files
+void Widget::applyWatchedChanges()
+{
+    if(!acceptDrops() || (pending_changed_paths.isEmpty() && pending_removed_paths.isEmpty()))
+        return;
+
+    const QSet<QString> changed_paths(pending_changed_paths.constBegin(), pending_changed_paths.constEnd());
+    QSet<int> path_ids;
+    QStringList member_prefixes;
+    for(const QString &path : pending_changed_paths + pending_removed_paths)
+    {
+        const int path_id = pathTable->find(path);
+        if(path_id != -1)
+            path_ids.insert(path_id);
+        member_prefixes.append(path + "!/");
+    }
+
+    pending_changed_paths.clear();
+    pending_removed_paths.clear();
+
+    // the members of a changed archive go with it, they are listed again when it is rehashed.
+    // Members are files below an "archive!" directory, so the check is made once per directory
+    QHash<int, bool> member_dirs;
+    auto isAffected = [&](int path_id)
+    {
+        if(path_ids.contains(path_id))
+            return true;
+
+        const int dir_id = pathTable->dir(path_id);
+        auto it = member_dirs.constFind(dir_id);
+        if(it == member_dirs.constEnd())
+        {
+            const QString dir_path = pathTable->dirPath(dir_id) + '/';
+            bool member = false;
+            for(int i = 0; !member && i < member_prefixes.size(); ++i)
+                member = dir_path.startsWith(member_prefixes.at(i));
+            it = member_dirs.insert(dir_id, member);
+        }
+        return it.value();
+    };
+
+    // contiguous rows are removed as one range, from the bottom up
+    int range_end = -1;
+    for(int row = model->rowCount() - 1; row >= -1; --row)
+    {
+        const bool affected = row >= 0 && isAffected(PathItem::pathId(model->index(row, Column::FULLPATH)));
+
+        if(affected && range_end == -1)
+            range_end = row;
+        else if(!affected && range_end != -1)
+        {
+            model->removeRows(row + 1, range_end - row);
+            range_end = -1;
+        }
+    }
+
+    showFileStatistics();
+
+    if(changed_paths.isEmpty())
+        return;
+
+    // directory hashes were built over the dropped trees, a partial update can't refresh them
+    if(!dirHasher->roots().isEmpty())
+    {
+        dirHasher->clear();
+        for(int row = 0; row < model->rowCount(); ++row)
+        {
+            if(model->item(row, Column::DIRHASH))
+                model->setItem(row, Column::DIRHASH, new QStandardItem());
+        }
+    }
+
+    urls.clear();
+    for(const QString &path : changed_paths)
+        urls.append(QUrl::fromLocalFile(path));
+
+    row_count = model->rowCount();
+    processed_items = 0;
+
+    setAcceptDrops(false);
+    ui->tableView->setSortingEnabled(false);
+    hideButtons();
+
+    customDelegate->setPending(true);
+
+    emit fileProcessor->startProcessing(urls, yara, pathTable);
+}
+
+
+void Widget::on_btn_clipboard_clicked()
+{
+    copySelectedCells(ui->tableView);
+}
+
+
+// selected or all rows in view order, written by a TableExporter thread from a snapshot
+void Widget::on_btn_save_clicked()
+{
+    QFileDialog file_dialog(this, "Export");
+    file_dialog.setAcceptMode(QFileDialog::AcceptSave);
+    file_dialog.setFileMode(QFileDialog::AnyFile);
+    file_dialog.setNameFilters({"Tab Separated Value Files (*.tsv)", "CSV Files (*.csv)", "JSON Lines (*.jsonl)",
+                                "sha256sum Manifest (*.sha256)", "md5sum Manifest (*.md5)", "All Files (*)"});
+    file_dialog.setDefaultSuffix("tsv");
+
+    connect(&file_dialog, &QFileDialog::filterSelected, &file_dialog, [&file_dialog](const QString &filter)
+    {
+        static const QRegularExpression suffix_pattern("\\(\\*\\.(\\w+)\\)");
+        QRegularExpressionMatch match = suffix_pattern.match(filter);
+        if(match.hasMatch())
+            file_dialog.setDefaultSuffix(match.captured(1));
+    });
+
+    if(file_dialog.exec() != QDialog::Accepted)
+        return;
+
+    QString file_path = file_dialog.selectedFiles().at(0);
+
+    // the view shows the proxy, or the model itself while sorting is switched off
+    QItemSelectionModel *selection = ui->tableView->selectionModel();
+    const bool proxy_view = (ui->tableView->model() == proxyModel);
+    const int view_rows = ui->tableView->model()->rowCount();
+
+    QBitArray selected_rows(view_rows, !selection->hasSelection());
+    for(const QItemSelectionRange &range : selection->selection())
+        selected_rows.fill(true, range.top(), range.bottom() + 1);
+
+    QList<int> rows;
+    for(int view_row = 0; view_row < view_rows; ++view_row)
+    {
+        if(selected_rows.testBit(view_row))
+            rows.append(proxy_view ? proxyModel->mapToSource(proxyModel->index(view_row, 0)).row() : view_row);
+    }
+
+    QList<int> columns;
+    QStringList headers;
+    for(int column = 0; column < model->columnCount(); ++column)
+    {
+        if(ui->tableView->isColumnHidden(column))
+            continue;
+
+        columns.append(column);
+        headers.append(model->headerData(column, Qt::Horizontal).toString());
+    }
+
+    // the snapshot the proxy works on is reused while it is current, otherwise only the
+    // exported rows are copied
+    QSharedPointer<const TableSnapshot> export_snapshot;
+    if(snapshot && !snapshot_dirty && snapshot_edits.isEmpty() && !edited_snapshot)
+    {
+        export_snapshot = snapshot;
+    }
+    else
+    {
+        export_snapshot.reset(new TableSnapshot(model, proxyModel->numericColumns(), pathTable, rows));
+        for(int i = 0; i < rows.size(); ++i)
+            rows[i] = i;
+    }
+
+    tableExporter = new TableExporter(file_path, TableExporter::formatForFilter(file_dialog.selectedNameFilter()));
+
+    QThread *exporter_thread = new QThread();
+    tableExporter->moveToThread(exporter_thread);
+
+    connect(tableExporter, &TableExporter::startExport, tableExporter, &TableExporter::exportRows);
+    connect(tableExporter, &TableExporter::rowsWritten, this, &Widget::onExportRowsWritten);
+    connect(tableExporter, &TableExporter::exportFinished, this, &Widget::onExportFinished);
+
+    exporter_thread->start();
+
+    emit tableExporter->startExport(export_snapshot, rows, columns, headers);
+
+    ui->progressBar->setRange(0, rows.size());
+    ui->progressBar->setValue(0);
+    ui->progressBar->show();
+
+    ui->btn_save->setEnabled(false);
+}
+
+
+void Widget::onExportRowsWritten(int count)
+{
+    ui->progressBar->setValue(count);
+    ui->progressBar->setFormat(QString("exporting: %1/%2").arg(ui->progressBar->value()).arg(ui->progressBar->maximum()));
+}
+
+
+void Widget::onExportFinished(bool ok)
+{
+    if(!ok)
+        qWarning() << "Export failed";
+
+    delete tableExporter;
+    tableExporter = nullptr;
+    ui->progressBar->hide();
+    ui->btn_save->setEnabled(true);
+}
+
+
+void Widget::on_lineEdit_search_textChanged(const QString &arg1)
+{
+    // numeric comparisons like "entropy > 7.5", "size <= 4096", "known = 2" or "verify > 0" filter on the raw column values
+    static const QRegularExpression numeric_query("^\\s*(size|entropy|known|verify)\\s*(<=|>=|<|>|=)\\s*(\\d+(?:\\.\\d+)?)\\s*$", QRegularExpression::CaseInsensitiveOption);
+    QRegularExpressionMatch numeric_match = numeric_query.match(arg1);
+
+    if(numeric_match.hasMatch())
+    {
+        QString column_name = numeric_match.captured(1).toLower();
+        int column = (column_name == "size") ? Column::FILESIZE : (column_name == "known") ? Column::KNOWN : (column_name == "verify") ? Column::VERIFY : Column::ENTROPY;
+        proxyModel->clearSearchQuery();
+        proxyModel->startWildcardFilter("");
+        proxyModel->setNumericFilter(column, numeric_match.captured(2), numeric_match.captured(3).toDouble());
+        ui->lineEdit_search->setStyleSheet("");
+        return;
+    }
+
+    proxyModel->clearNumericFilter();
+
+    // a pasted list of digests is matched as a set instead of a giant regex alternation
+    QSet<Digest> pasted_hashes;
+    if(parseHashList(arg1, true, pasted_hashes) && pasted_hashes.size() > 1)
+    {
+        proxyModel->clearSearchQuery();
+        proxyModel->startWildcardFilter("");
+        proxyModel->setHashListFilter(pasted_hashes);
+        ui->lineEdit_search->setStyleSheet("");
+        return;
+    }
+
+    proxyModel->setHashListFilter(loaded_hash_list);
+
+    updateSearchCandidates(arg1, ui->btn_regex->isChecked() || ui->btn_whole_word->isChecked());
+
+    if (ui->btn_regex->isChecked())
+    {
+        QRegularExpression regex(arg1, proxyModel->filterCaseSensitivity() == Qt::CaseSensitive ? QRegularExpression::NoPatternOption : QRegularExpression::CaseInsensitiveOption);
+        if(regex.isValid())
+        {
+            proxyModel->startFilter(regex);
+            ui->lineEdit_search->setStyleSheet("");
+        }
+        else
+            ui->lineEdit_search->setStyleSheet("background-color: rgba(255, 75, 92, .5); border-color: rgba(255, 75, 92, .5);");
+    }
+    else if(ui->btn_whole_word->isChecked())
+    {
+        QString whole_word_pattern = QString("\\b%1\\b").arg(arg1);
+        QRegularExpression regex(whole_word_pattern, proxyModel->filterCaseSensitivity() == Qt::CaseSensitive ? QRegularExpression::NoPatternOption : QRegularExpression::CaseInsensitiveOption);
+        if(regex.isValid())
+        {
+            proxyModel->startFilter(regex);
+            ui->lineEdit_search->setStyleSheet("");
+        }
+        else
+            ui->lineEdit_search->setStyleSheet("background-color: rgba(255, 75, 92, .5); border-color: rgba(255, 75, 92, .5);");
+    }
+    else
+    {
+        proxyModel->startWildcardFilter(arg1);
+        ui->lineEdit_search->setStyleSheet("");
+    }
+}
+
+
+void Widget::invalidateSnapshot()
+{
+    if(snapshot_dirty)
+        return;
+
+    // the snapshot and its search index refer to the old rows
+    snapshot_dirty = true;
+    snapshot.clear();
+    snapshot_edits.clear();
+    proxyModel->setSnapshot(QSharedPointer<const TableSnapshot>());
+}
+
+
+// small tables are filtered synchronously and don't need a snapshot
+void Widget::takeSnapshot()
+{
+    snapshot_dirty = false;
+    snapshot_edits.clear();
+
+    if(model->rowCount() < BACKGROUND_FILTER_ROWS)
+    {
+        snapshot.clear();
+        proxyModel->setSnapshot(QSharedPointer<const TableSnapshot>());
+        return;
+    }
+
+    snapshot.reset(new TableSnapshot(model, proxyModel->numericColumns(), pathTable));
+    proxyModel->setSnapshot(snapshot);
+}
+
+
+void Widget::onModelDataChanged(const QModelIndex &top_left, const QModelIndex &bottom_right)
+{
+    const int row_count = bottom_right.row() - top_left.row() + 1;
+    editSnapshot(top_left.row(), row_count, row_count);
+}
+
+
+void Widget::onModelRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    if(!parent.isValid())
+        editSnapshot(first, 0, last - first + 1);
+}
+
+
+void Widget::onModelRowsRemoved(const QModelIndex &parent, int first, int last)
+{
+    if(!parent.isValid())
+        editSnapshot(first, last - first + 1, 0);
+}
+
+
+// while files are processed the snapshot is taken again once they are done. Later edits, like
+// deleted rows, only read the rows they touch here and are applied to a copy in a worker thread
+void Widget::editSnapshot(int first, int removed_rows, int inserted_rows)
+{
+    if(snapshot_dirty)
+        return;
+
+    if(!snapshot || !acceptDrops())
+    {
+        invalidateSnapshot();
+        return;
+    }
+
+    QSharedPointer<const TableSnapshot> rows;
+    if(inserted_rows > 0)
+        rows.reset(new TableSnapshot(model, proxyModel->numericColumns(), pathTable, first, inserted_rows));
+
+    snapshot_edits.append(TableSnapshot::Edit{first, removed_rows, rows});
+    proxyModel->setSnapshot(QSharedPointer<const TableSnapshot>());
+
+    if(!edited_snapshot)
+        startSnapshotEdits();
+}
+
+
+void Widget::startSnapshotEdits()
+{
+    edited_snapshot = snapshot;
+    snapshotWatcher->setFuture(QtConcurrent::run(&TableSnapshot::edited, snapshot, snapshot_edits));
+    snapshot_edits.clear();
+}
+
+
+// edits made in the meantime start the next round, the proxy gets the snapshot once it is current.
+// A snapshot taken in the meantime makes the result obsolete.
+void Widget::onSnapshotEdited()
+{
+    const QSharedPointer<const TableSnapshot> base = edited_snapshot;
+    edited_snapshot.clear();
+
+    if(snapshot_dirty || !snapshot)
+        return;
+
+    QFuture<QSharedPointer<const TableSnapshot>> future = snapshotWatcher->future();
+    const bool applied = snapshot == base && future.resultCount() > 0;
+    if(applied)
+        snapshot = future.result();
+
+    if(!snapshot_edits.isEmpty())
+        startSnapshotEdits();
+    else if(applied)
+        proxyModel->setSnapshot(snapshot);
+}
+
+
+// lets the background filter pass skip every row the search index rules out
+void Widget::updateSearchCandidates(const QString &query, bool regex)
+{
+    if(snapshot_dirty)
+        takeSnapshot();
+
+    proxyModel->setSearchQuery(query, regex ? SearchIndex::Regex : SearchIndex::Wildcard);
+}
+
+
+void Widget::on_btn_match_case_toggled(bool checked)
+{
+    if(checked)
+    {
+        case_option_set = true;
+        proxyModel->startFilterCase(Qt::CaseSensitive);
+    }
+    else
+    {
+        case_option_set = false;
+        }
+
+    ui->lineEdit_search->setFocus();
+}
+
+
+void Widget::on_btn_whole_word_toggled(bool checked)
 {
     if (checked)
     {
         wholeword_option_set = true;
+        updateSearchCandidates(ui->lineEdit_search->text(), true);
         QString whole_word_pattern = QString("\\b%1\\b").arg(ui->lineEdit_search->text());
         QRegularExpression regex(whole_word_pattern, proxyModel->filterCaseSensitivity() == Qt::CaseSensitive ? QRegularExpression::NoPatternOption : QRegularExpression::CaseInsensitiveOption);
         if(regex.isValid())
         {
-            proxyModel->setFilterRegularExpression(regex);
+            proxyModel->startFilter(regex);
             ui->lineEdit_search->setStyleSheet("");
         }
         else
@@ -940,7 +1802,8 @@ void Widget::on_btn_whole_word_toggled(bool checked)
     else
     {
         wholeword_option_set = false;
-        proxyModel->setFilterWildcard(ui->lineEdit_search->text());
+        updateSearchCandidates(ui->lineEdit_search->text(), false);
+        proxyModel->startWildcardFilter(ui->lineEdit_search->text());
         ui->lineEdit_search->setStyleSheet("");
     }
 
@@ -954,10 +1817,11 @@ void Widget::on_btn_regex_toggled(bool checked)
     if (checked)
     {
         regex_option_set = true;
+        updateSearchCandidates(ui->lineEdit_search->text(), true);
         QRegularExpression regex(ui->lineEdit_search->text(), proxyModel->filterCaseSensitivity() == Qt::CaseSensitive ? QRegularExpression::NoPatternOption : QRegularExpression::CaseInsensitiveOption);
         if(regex.isValid())
         {
-            proxyModel->setFilterRegularExpression(regex);
+            proxyModel->startFilter(regex);
             ui->lineEdit_search->setStyleSheet("");
         }
         else
@@ -966,7 +1830,8 @@ void Widget::on_btn_regex_toggled(bool checked)
     else
     {
         regex_option_set = false;
-        proxyModel->setFilterWildcard(ui->lineEdit_search->text());
+        updateSearchCandidates(ui->lineEdit_search->text(), false);
+        proxyModel->startWildcardFilter(ui->lineEdit_search->text());
         ui->lineEdit_search->setStyleSheet("");
     }
 
@@ -974,6 +1839,58 @@ void Widget::on_btn_regex_toggled(bool checked)
 }
 
 
+void Widget::on_btn_hash_list_toggled(bool checked)
+{
+    loaded_hash_list.clear();
+
+    if(checked)
+    {
+        QString file_path = QFileDialog::getOpenFileName(this, "Load Hash List", QString(), "Hash Lists (*.txt *.csv *.tsv *.md5 *.sha1 *.sha256);;All Files (*)");
+
+        QFile list_file(file_path);
+        if(!file_path.isEmpty() && list_file.open(QIODevice::ReadOnly | QIODevice::Text))
+            parseHashList(QString::fromUtf8(list_file.readAll()), false, loaded_hash_list);
+
+        if(loaded_hash_list.isEmpty())
+        {
+            ui->btn_hash_list->setChecked(false);
+            return;
+        }
+
+        ui->lineEdit_search->setPlaceholderText(QString("Search %1 Listed Hashes...").arg(loaded_hash_list.size()));
+        ui->btn_hash_list->setToolTip(QString("Hash List: %1 (%2 hashes)").arg(QFileInfo(file_path).fileName()).arg(loaded_hash_list.size()));
+    }
+    else
+    {
+        ui->lineEdit_search->setPlaceholderText("Search Table...");
+        ui->btn_hash_list->setToolTip("Load Hash List (pasted lists are detected automatically)");
+    }
+
+    on_lineEdit_search_textChanged(ui->lineEdit_search->text());
+    showFileStatistics();
+    ui->lineEdit_search->setFocus();
+}
+
+
+// collects the MD5, SHA1 and SHA256 digests of a hash list, a strict list must not contain anything else
+bool Widget::parseHashList(const QString &text, bool strict, QSet<Digest> &hashes)
+{
+    static const QRegularExpression separators("[\\s,;|\"']+");
+    static const QRegularExpression digest("^(?:[0-9a-fA-F]{32}|[0-9a-fA-F]{40}|[0-9a-fA-F]{64})$");
+
+    const QStringList tokens = text.split(separators, Qt::SkipEmptyParts);
+    for(const QString &token : tokens)
+    {
+        if(digest.match(token).hasMatch())
+            hashes.insert(Digest::fromHex(token));
+        else if(strict)
+            return false;
+    }
+
+    return true;
+}
+
+
 void Widget::on_btn_hide_doubles_toggled(bool checked)
 {
     proxyModel->setFilterDuplicates(checked);
@@ -1120,6 +2037,85 @@ void Widget::on_btn_sha256_toggled(bool checked)
 }
 
 
+void Widget::on_btn_treehash_toggled(bool checked)
+{
+    treehash = checked ? true : false;
+    if(model->rowCount())
+    {
+        if(model->horizontalHeaderItem(Column::TREEHASH)->text().isEmpty())
+            model->setHorizontalHeaderItem(Column::TREEHASH, new QStandardItem("SHA256 Tree"));
+    }
+    ui->tableView->setColumnHidden(Column::TREEHASH, !treehash);
+
+    if(allHashboxesUnchecked() && doubles_found)
+    {
+        ui->btn_hide_doubles->setDisabled(true);
+        ui->btn_hide_doubles->setChecked(false);
+    }
+    else if(doubles_found)
+        ui->btn_hide_doubles->show();
+}
+
+
+void Widget::on_btn_sampled_toggled(bool checked)
+{
+    sampled = checked ? true : false;
+    if(model->rowCount())
+    {
+        if(model->horizontalHeaderItem(Column::SAMPLED)->text().isEmpty())
+            model->setHorizontalHeaderItem(Column::SAMPLED, new QStandardItem("Quick (sampled)"));
+    }
+    ui->tableView->setColumnHidden(Column::SAMPLED, !sampled);
+
+    if(allHashboxesUnchecked() && doubles_found)
+    {
+        ui->btn_hide_doubles->setDisabled(true);
+        ui->btn_hide_doubles->setChecked(false);
+    }
+    else if(doubles_found)
+        ui->btn_hide_doubles->show();
+}
+
+
+void Widget::on_btn_dirhash_toggled(bool checked)
+{
+    dirhash = checked ? true : false;
+    if(model->rowCount())
+    {
+        if(model->horizontalHeaderItem(Column::DIRHASH)->text().isEmpty())
+            model->setHorizontalHeaderItem(Column::DIRHASH, new QStandardItem("Dir Hash"));
+    }
+    ui->tableView->setColumnHidden(Column::DIRHASH, !dirhash);
+}
+
+
+void Widget::on_btn_entropy_toggled(bool checked)
+{
+    entropy = checked ? true : false;
+    if(model->rowCount())
+    {
+        if(model->horizontalHeaderItem(Column::ENTROPY)->text().isEmpty())
+            model->setHorizontalHeaderItem(Column::ENTROPY, new QStandardItem("Entropy"));
+    }
+    ui->tableView->setColumnHidden(Column::ENTROPY, !entropy);
+}
+
+
+void Widget::on_btn_ssdeep_toggled(bool checked)
+{
+    ssdeep = checked ? true : false;
+    if(model->rowCount())
+    {
+        if(model->horizontalHeaderItem(Column::SSDEEP)->text().isEmpty())
+            model->setHorizontalHeaderItem(Column::SSDEEP, new QStandardItem("ssdeep"));
+        if(model->horizontalHeaderItem(Column::SIMILAR)->text().isEmpty())
+            model->setHorizontalHeaderItem(Column::SIMILAR, new QStandardItem("Similar"));
+    }
+    ui->tableView->setColumnHidden(Column::SSDEEP, !ssdeep);
+    ui->tableView->setColumnHidden(Column::SIMILAR, !ssdeep);
+}
+
+
 void Widget::on_btn_about_toggled(bool checked)
 {
     toggleFrameButtons(ui->frame_btn_hashes->children());
@@ -1155,6 +2151,41 @@ void Widget::readSettings()
     sha256 = settings.value("sha256").toBool();
     ui->btn_sha256->setChecked(sha256);
 
+    treehash = settings.value("treehash").toBool();
+    ui->btn_treehash->setChecked(treehash);
+
+    tree_block_size = qMax(qint64(1), settings.value("tree_block_mib", 4).toLongLong()) * 1024 * 1024;
+
+    sampled = settings.value("sampled").toBool();
+    ui->btn_sampled->setChecked(sampled);
+
+    dirhash = settings.value("dirhash").toBool();
+    ui->btn_dirhash->setChecked(dirhash);
+
+    // entropy column, the tooltip shows the per block entropy profile
+    entropy = settings.value("entropy").toBool();
+    ui->btn_entropy->setChecked(entropy);
+
+    // ssdeep digest and the minimum match score (0 - 100) for the similarity groups
+    ssdeep = settings.value("ssdeep").toBool();
+    ui->btn_ssdeep->setChecked(ssdeep);
+
+    ssdeep_threshold = qBound(1, settings.value("ssdeep_threshold", 50).toInt(), 100);
+
+    entropy_block_size = qMax(qint64(64), settings.value("entropy_block_kib", 1024).toLongLong()) * 1024;
+
+    // quick fingerprint: first and last n MiB plus k evenly spaced 64k blocks
+    sample_edge_size = settings.value("sample_mib", 1).toLongLong() * 1024 * 1024;
+    sample_block_count = qMax(0, settings.value("sample_blocks", 16).toInt());
+
+    // zip, tar and gzip members are hashed in memory down to this nesting depth, 0 leaves archives closed
+    archive_depth = qBound(0, settings.value("archive_depth", 0).toInt(), 16);
+    archive_member_size = qMax(qint64(1), settings.value("archive_member_mib", 512).toLongLong()) * 1024 * 1024;
+
+    // dropped folders stay watched, created and modified files are rehashed after the quiet period
+    watch_folders = settings.value("watch_folders", false).toBool();
+    watch_quiet_ms = qMax(100, settings.value("watch_quiet_ms", 2000).toInt());
+
     // column option settings
     show_filesize = settings.value("filesize").toBool();
     ui->btn_filesize->setChecked(show_filesize);
@@ -1183,6 +2214,20 @@ void Widget::writeSettings()
     settings.setValue("md5", md5);
     settings.setValue("sha1", sha1);
     settings.setValue("sha256", sha256);
+    settings.setValue("treehash", treehash);
+    settings.setValue("tree_block_mib", tree_block_size / (1024 * 1024));
+    settings.setValue("sampled", sampled);
+    settings.setValue("sample_mib", sample_edge_size / (1024 * 1024));
+    settings.setValue("sample_blocks", sample_block_count);
+    settings.setValue("dirhash", dirhash);
+    settings.setValue("entropy", entropy);
+    settings.setValue("ssdeep", ssdeep);
+    settings.setValue("ssdeep_threshold", ssdeep_threshold);
+    settings.setValue("entropy_block_kib", entropy_block_size / 1024);
+    settings.setValue("archive_depth", archive_depth);
+    settings.setValue("archive_member_mib", archive_member_size / (1024 * 1024));
+    settings.setValue("watch_folders", watch_folders);
+    settings.setValue("watch_quiet_ms", watch_quiet_ms);
 
     settings.setValue("filesize", show_filesize);
     settings.setValue("mime_type", show_mimetype);
@@ -1379,6 +2424,37 @@ void Widget::onFinishedLoadingYaraRules()
 }
 
 
+// the progress bar belongs to the file processing while files are hashed
+void Widget::onKnownHashImportProgress(qint64 read_bytes, qint64 total_bytes)
+{
+    importing_known_hashes = true;
+
+    if(!acceptDrops())
+        return;
+
+    ui->progressBar->setRange(0, 1000);
+    ui->progressBar->setValue(total_bytes > 0 ? int(read_bytes * 1000 / total_bytes) : 1000);
+    ui->progressBar->setFormat(QString("importing known hashes: %1/%2 MiB").arg(read_bytes >> 20).arg(total_bytes >> 20));
+    ui->progressBar->show();
+}
+
+
+void Widget::onKnownHashImportFinished()
+{
+    if(importing_known_hashes && acceptDrops())
+        ui->progressBar->hide();
+
+    importing_known_hashes = false;
+}
+
+
+void Widget::onKnownHashesReady(const QString &db_path)
+{
+    if(!knownHashes->open(db_path))
+        qWarning() << "Unable to open known hash database" << db_path;
+}
+
+
 bool Widget::dir_contains_file(const QDir &dir)
 {
     if(!dir.entryInfoList(QDir::NoDotAndDotDot | QDir::Files).isEmpty())
@@ -1406,6 +2482,8 @@ void Widget::on_btn_zip_clicked()
     }
 
     QStringList file_paths;
+    QStringList mime_types;
+    QList<Digest> sha256_digests;
 
     for(int i = 0; i < indexes.count(); ++i)
     {
@@ -1414,19 +2492,52 @@ void Widget::on_btn_zip_clicked()
         QStandardItem *item = model->itemFromIndex(col_index);
 
         if(item)
+        {
             file_paths << item->text();
+            mime_types << model->index(index.row(), Column::MIMETYPE).data().toString();
+            sha256_digests << DigestItem::digest(model->index(index.row(), Column::SHA256));
+        }
     }
 
-    QFileDialog file_dialog(this, "Save to .zip");
+    QFileDialog file_dialog(this, "Save to .zip or .tar.zst");
     file_dialog.setAcceptMode(QFileDialog::AcceptSave);
     file_dialog.setFileMode(QFileDialog::AnyFile);
-    file_dialog.setNameFilter("ZIP (*.zip);;All Files (*)");
+    file_dialog.setNameFilter("ZIP (*.zip);;Zstandard compressed tar (*.tar.zst);;All Files (*)");
     file_dialog.setDefaultSuffix("zip");
 
+    connect(&file_dialog, &QFileDialog::filterSelected, &file_dialog, [&file_dialog](const QString &filter)
+    {
+        file_dialog.setDefaultSuffix(filter.startsWith("Zstandard") ? "tar.zst" : "zip");
+    });
+
     if(file_dialog.exec() == QDialog::Accepted)
     {
         QString file_path = file_dialog.selectedFiles().at(0);
 
+        ui->progressBar->setRange(0, file_paths.size());
+        ui->progressBar->setValue(0);
+        ui->progressBar->show();
+
+        ui->btn_zip->setEnabled(false);
+
+        // tar.zst for bulk exports, the sha256 column goes into the pax headers
+        if(file_path.endsWith(".tar.zst", Qt::CaseInsensitive))
+        {
+            tarWriter = new TarWriter(file_path);
+
+            QThread *tar_thread = new QThread();
+            tarWriter->moveToThread(tar_thread);
+
+            connect(tarWriter, &TarWriter::startWriting, tarWriter, &TarWriter::writeFileList);
+            connect(tarWriter, &TarWriter::fileFinished, this, &Widget::onZipFileFinished);
+            connect(tarWriter, &TarWriter::writingFinished, this, &Widget::onFinishedZipping);
+
+            tar_thread->start();
+
+            emit tarWriter->startWriting(file_paths, sha256_digests);
+            return;
+        }
+
         zipper = new Zipper(file_path);
 
         QThread *zipper_thread = new QThread();
@@ -1434,17 +2545,13 @@ void Widget::on_btn_zip_clicked()
 
         connect(zipper, &Zipper::startZipping, zipper, &Zipper::zipFileList);
         connect(zipper, &Zipper::fileFinished, this, &Widget::onZipFileFinished);
+        connect(zipper, &Zipper::filesSkipped, this, &Widget::onZipFilesSkipped);
+        connect(zipper, &Zipper::zippingFailed, this, &Widget::onZippingFailed);
         connect(zipper, &Zipper::zippingFinished, this, &Widget::onFinishedZipping);
 
         zipper_thread->start();
 
-        emit zipper->startZipping(file_paths);
-
-        ui->progressBar->setRange(0, file_paths.size());
-        ui->progressBar->setValue(0);
-        ui->progressBar->show();
-
-        ui->btn_zip->setEnabled(false);
+        emit zipper->startZipping(file_paths, mime_types);
     }
 }
 
@@ -1456,10 +2563,29 @@ void Widget::onZipFileFinished(int counter)
 }
 
 
+void Widget::onZipFilesSkipped(const QStringList &file_paths)
+{
+    ui->lbl_status->setText(ui->lbl_status->text() + QString(" | %1 unreadable %2 left out of the zip")
+                                                     .arg(file_paths.size()).arg(file_paths.size() == 1 ? "file" : "files"));
+    ui->lbl_status->setToolTip(file_paths.join('\n'));
+    ui->lbl_status->show();
+}
+
+
+void Widget::onZippingFailed(const QString &file_path)
+{
+    ui->lbl_status->setText(ui->lbl_status->text() + " | zip failed at " + QFileInfo(file_path).fileName() + " and was removed");
+    ui->lbl_status->setToolTip(file_path);
+    ui->lbl_status->show();
+}
+
+
 void Widget::onFinishedZipping()
 {
     delete zipper;
     zipper = nullptr;
+    delete tarWriter;
+    tarWriter = nullptr;
     ui->progressBar->hide();
     ui->btn_zip->setEnabled(true);
 }
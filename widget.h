@@ -7,11 +7,26 @@
 #include <QLabel>
 #include <QSvgWidget>
 #include <QDir>
+#include <QFutureWatcher>
+#include <QSet>
+#include <QSharedPointer>
+
+#include "digest.h"
+#include "itemprocessor.h"
+#include "manifest.h"
+#include "pathtable.h"
+#include "tablesnapshot.h"
 
 class HeaderSortingAdapter;
+class CustomDelegate;
 class CustomSortFilterProxyModel;
-class ItemProcessor;
 class FileProcessor;
+class DirHasher;
+class DirWatcher;
+class HashDatabase;
+class KnownHashLoader;
+class TableExporter;
+class TarWriter;
 class Zipper;
 
 QT_BEGIN_NAMESPACE
@@ -34,20 +49,31 @@ protected:
 private slots:
     void onFinishedZipping();
     void onZipFileFinished(int counter);
+    void onZipFilesSkipped(const QStringList &file_paths);
+    void onZippingFailed(const QString &file_path);
+    void onExportRowsWritten(int count);
+    void onExportFinished(bool ok);
 
     void onProcessingFinished(const QString &result);
-    void onResultReady(const QString &result);
-    void onCellItemChanged(QStandardItem *item);
+    void onResultReady(const HashResult &result);
     void onSortIndicatorChanged(int logical_index, Qt::SortOrder order);
     void onDoublesFound();
     void onMissingDoubles();
     void onPageChanged();
 
+    void onWatchedFilesChanged(const QStringList &changed_paths, const QStringList &removed_paths);
+    void applyWatchedChanges();
+
     void on_btn_clear_clicked();
     void on_btn_clipboard_clicked();
     void on_btn_save_clicked();
 
     void on_lineEdit_search_textChanged(const QString &arg1);
+    void invalidateSnapshot();
+    void onModelDataChanged(const QModelIndex &top_left, const QModelIndex &bottom_right);
+    void onModelRowsInserted(const QModelIndex &parent, int first, int last);
+    void onModelRowsRemoved(const QModelIndex &parent, int first, int last);
+    void onSnapshotEdited();
 
     void on_btn_match_case_toggled(bool checked);
     void on_btn_hide_doubles_toggled(bool checked);
@@ -56,8 +82,14 @@ private slots:
     void on_btn_md5_toggled(bool checked);
     void on_btn_sha1_toggled(bool checked);
     void on_btn_sha256_toggled(bool checked);
+    void on_btn_treehash_toggled(bool checked);
+    void on_btn_sampled_toggled(bool checked);
+    void on_btn_dirhash_toggled(bool checked);
+    void on_btn_entropy_toggled(bool checked);
+    void on_btn_ssdeep_toggled(bool checked);
 
     void on_btn_regex_toggled(bool checked);
+    void on_btn_hash_list_toggled(bool checked);
 
     void on_btn_about_toggled(bool checked);
 
@@ -69,8 +101,11 @@ private slots:
 
     void onFileProcessorFileCountSum(int count);
     void onFileProcessorFileCount(int count);
-    void onFileProcessorUpdateModel(const QStringList &data);
-    void onFileProcessingFinished(const QHash<QString, QStringList> *file_list);
+    void onFileProcessorUpdateModel(int path_id, const QStringList &data);
+    void onFileProcessingFinished(const QHash<int, QStringList> *file_list, const QHash<int, QList<int>> *hardlink_list);
+
+    void onManifestLoaded(const QStringList &algorithms);
+    void onFileVerifyingFinished(const QHash<int, Digest> *expected_digests, const QStringList *file_paths, const QStringList *file_algorithms);
 
     void on_btn_filesize_toggled(bool checked);
 
@@ -88,6 +123,10 @@ private slots:
 
     void onFinishedLoadingYaraRules();
 
+    void onKnownHashImportProgress(qint64 read_bytes, qint64 total_bytes);
+    void onKnownHashImportFinished();
+    void onKnownHashesReady(const QString &db_path);
+
     void on_btn_reload_rules_clicked();
 
     void on_btn_open_yaradir_clicked();
@@ -102,17 +141,27 @@ private:
 
     ItemProcessor *processor;
     Zipper *zipper;
+    TarWriter *tarWriter;
+    TableExporter *tableExporter;
 
     void readSettings();
     void writeSettings();
 
-    void addLoadingGifToEmptyCells(QTableView *tableView);
+    CustomDelegate *customDelegate;
     QMovie *movie;
 
     QIcon file_icon;
 
-    void addDashToEmptyCells(QTableView *tableView);
-    void copySelectedCells(QTableView *tableView, bool copy_headers, bool copy_to_file);
+    void prepareTable(const QSet<QString> &verify_algorithms);
+
+    bool verifying;
+    QHash<int, Digest> expected_digests;   // path id -> digest listed in the manifest
+    QHash<int, int> verify_rows;           // path id -> row of the files being hashed
+    void startListing();
+    void startVerification(const QString &manifest_path);
+    void setVerifyState(int row, Manifest::Status status, const QString &tool_tip);
+
+    void copySelectedCells(QTableView *tableView);
     bool allHashboxesUnchecked();
     void showFileStatistics();
     void setColumnHeaders();
@@ -122,7 +171,41 @@ private:
     void hideButtons();
     void showButtons();
 
-    QHash<QString, QStringList> file_hash_list;
+    QSharedPointer<PathTable> pathTable;  // shared with the file processor and the table snapshots
+    QHash<int, QList<int>> hardlink_list;
+
+    void markHardlinkedFiles();
+
+    void addRow(int path_id, const QStringList &data);
+    void addMemberRow(const HashResult &result);
+
+    DirHasher *dirHasher;
+    void updateDirHashes(const QStringList &dir_paths);
+    void markTreeDifferences();
+
+    void groupSimilarFiles();
+
+    DirWatcher *dirWatcher;
+    QStringList pending_changed_paths;
+    QStringList pending_removed_paths;
+
+    bool snapshot_dirty;
+    QSharedPointer<const TableSnapshot> snapshot;          // matches the model once the edits are applied
+    QSharedPointer<const TableSnapshot> edited_snapshot;   // the one the running edits start from, null when none run
+    QList<TableSnapshot::Edit> snapshot_edits;
+    QFutureWatcher<QSharedPointer<const TableSnapshot>> *snapshotWatcher;
+    void takeSnapshot();
+    void editSnapshot(int first, int removed_rows, int inserted_rows);
+    void startSnapshotEdits();
+    void updateSearchCandidates(const QString &query, bool regex);
+
+    QSet<Digest> loaded_hash_list;
+    static bool parseHashList(const QString &text, bool strict, QSet<Digest> &hashes);
+
+    HashDatabase *knownHashes;
+    KnownHashLoader *knownHashLoader;
+    bool importing_known_hashes;
+    void markKnownHash(int row, const Digest &digest);
 
     QList<QUrl> urls;
     FileProcessor *fileProcessor;
@@ -134,6 +217,21 @@ private:
     bool md5;
     bool sha1;
     bool sha256;
+    bool treehash;
+    qint64 tree_block_size;
+    bool sampled;
+    qint64 sample_edge_size;
+    int sample_block_count;
+    bool dirhash;
+    QString dir_hash_algorithm;
+    bool entropy;
+    qint64 entropy_block_size;
+    int archive_depth;
+    qint64 archive_member_size;
+    bool watch_folders;
+    int watch_quiet_ms;
+    bool ssdeep;
+    int ssdeep_threshold;
     bool yara;
     bool show_filesize;
     bool show_extension;
@@ -22,6 +22,8 @@ YaraProcessor::~YaraProcessor()
 
 void YaraProcessor::clearRules()
 {
+    QWriteLocker locker(&m_lock);
+
     for(auto rule_set : m_rule_sets)
     {
         yr_rules_destroy(rule_set);
@@ -101,7 +103,9 @@ void YaraProcessor::compileYaraRules(const QStringList &rule_file_path_list)
         return;
     }
 
+    m_lock.lockForWrite();
     m_rule_sets.push_back(m_rules);
+    m_lock.unlock();
     yr_compiler_destroy(m_compiler);
     m_rules = NULL;
 }
@@ -122,6 +126,7 @@ void YaraProcessor::loadCompiledYaraRules(const QStringList &compiled_rule_path_
         else
             emit yaraSuccess("<font color='#81bd76'>[ + ] Loaded compiled rules: </font>" + file_path.at(1));
 
+        QWriteLocker locker(&m_lock);
         m_rule_sets.push_back(compiled_rules);
     }
 }
@@ -167,3 +172,54 @@ QString YaraProcessor::scanFile(const QString &file_path)
     return match;
 }
 
+
+int YaraProcessor::dataCallback(YR_SCAN_CONTEXT*, int message, void *message_data, void *user_data)
+{
+    if(message == CALLBACK_MSG_RULE_MATCHING)
+    {
+        YR_RULE *rule = (YR_RULE*)message_data;
+        static_cast<QString*>(user_data)->append(QString(rule->identifier) + " | ");
+    }
+
+    return CALLBACK_CONTINUE;
+}
+
+
+QString YaraProcessor::scanData(const QByteArray &data) const
+{
+    QReadLocker locker(&m_lock);
+
+    QString data_match;
+
+    for(auto rule_set : m_rule_sets)
+    {
+        int result = yr_rules_scan_mem(rule_set, reinterpret_cast<const uint8_t*>(data.constData()), size_t(data.size()), 0, dataCallback, &data_match, 0);
+
+        if(result != ERROR_SUCCESS)
+            qWarning("YaraProcessor: yr_rules_scan_mem(): %d", result);
+    }
+
+    data_match.chop(3);
+    return data_match;
+}
+
+
+QString YaraProcessor::scanPath(const QString &file_path) const
+{
+    QReadLocker locker(&m_lock);
+
+    QString file_match;
+    const QByteArray file_bytes = file_path.toLocal8Bit();
+
+    for(auto rule_set : m_rule_sets)
+    {
+        int result = yr_rules_scan_file(rule_set, file_bytes.constData(), 0, dataCallback, &file_match, 0);
+
+        if(result != ERROR_SUCCESS)
+            qWarning("YaraProcessor: yr_rules_scan_file(): %d", result);
+    }
+
+    file_match.chop(3);
+    return file_match;
+}
+
@@ -2,6 +2,7 @@
 #define YARAPROCESSOR_H
 
 #include <QObject>
+#include <QReadWriteLock>
 
 #include "yara.h"
 
@@ -19,6 +20,10 @@ public:
 
     QString scanFile(const QString &file_path);
 
+    // thread-safe, archive members are scanned from the hashing threads
+    QString scanData(const QByteArray &data) const;
+    QString scanPath(const QString &file_path) const;
+
     void clearRules();
 
 signals:
@@ -31,12 +36,14 @@ private:
     static void compilerCallback(int error_level, const char *file_name, int line_number, const YR_RULE *rule, const char* message, void *user_data);
 
     static int yaraCallback(YR_SCAN_CONTEXT *context, int message, void *message_data, void *user_data);
+    static int dataCallback(YR_SCAN_CONTEXT *context, int message, void *message_data, void *user_data);
 
     QString match;
 
     YR_COMPILER *m_compiler;
     YR_RULES *m_rules;
     QVector<YR_RULES*> m_rule_sets;
+    mutable QReadWriteLock m_lock;      // rule sets are replaced while members may be scanned
 
     const QStringList m_rule_file_paths;
     const QStringList m_compiled_rule_paths;
@@ -1,76 +1,338 @@
-#include "zipper.h"
-#include <quazip/quazipfile.h>
-
-
-Zipper::Zipper(const QString &archive_path)
-{
-    zip.setZipName(archive_path);
-
-    if(!zip.open(QuaZip::mdCreate))
-    {
-        qWarning("Zipper(): zip.open(): %d", zip.getZipError());
-    }
-}
-
-
-void Zipper::zipFileList(const QStringList &file_path_list)
-{
-
-    if(!zip.isOpen())
-        return;
-
-    int counter = 0;
-
-    for(const auto &file_path : file_path_list)
-    {
-        QFile in_file(file_path);
-        if(!in_file.open(QIODevice::ReadOnly))
-        {
-            qWarning("Failed to open file for reading: %s", qPrintable(file_path));
-            return;
-        }
-
-        QuaZipFile out_file(&zip);
-        QuaZipNewInfo new_info(QFileInfo(file_path).fileName(), file_path);
-        if(!out_file.open(QIODevice::WriteOnly, new_info))
-        {
-            qWarning("Failed to open zip file for writing: %s", qPrintable(file_path));
-            return;
-        }
-
-        out_file.write(in_file.readAll());
-        if(out_file.getZipError() != UNZ_OK)
-            qWarning("addFile(): out_file.close(): %d", out_file.getZipError());
-
-        out_file.close();
-        if(out_file.getZipError()!=UNZ_OK) {
-            qWarning("addFile(): outFile.close(): %d", out_file.getZipError());
-        }
-
-        in_file.close();
-        if(in_file.error() != QFile::NoError)
-            qWarning("addFile(): in_file.close(): %d", in_file.error());
-
-        emit fileFinished(++counter);
-    }
-
-    close();
-}
-
-
-void Zipper::close()
-{
-    zip.close();
-    if(zip.getZipError() != UNZ_OK)
-    {
-        qWarning("Zipper(): zip.close(): %d", zip.getZipError());
-    }
-
-    emit zippingFinished();
-}
-
-
-
-
-
-
+#include "zipper.h"
+#include <quazip/zip.h>
+
+#include <QDateTime>
+#include <QFile>
+#include <QQueue>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <zlib.h>
+#include <cmath>
+
+
+static const qint64 BLOCK_SIZE = 1024 * 1024;
+static const qint64 DICTIONARY_SIZE = 32768;
+static const uLong UTF8_FILE_NAMES = 0x0800;
+static const qint64 SAMPLE_SIZE = 64 * 1024;
+static const double STORE_ENTROPY = 7.5;
+static const qint64 MAX_HELD_BACK = 64 * 1024 * 1024;   // compressed bytes of an entry held back until its last block is read
+
+// formats that carry their own compression, deflate gains next to nothing on them
+static const char *const STORED_MIME_TYPES[] = {
+    "image/jpeg", "image/png", "image/gif", "image/webp", "image/heic", "image/avif",
+    "video/", "audio/mpeg", "audio/mp4", "audio/ogg", "audio/flac", "audio/aac",
+    "application/zip", "application/gzip", "application/x-gzip", "application/x-bzip2",
+    "application/x-xz", "application/x-7z-compressed", "application/x-rar", "application/vnd.rar",
+    "application/zstd", "application/x-zstd", "application/java-archive",
+    "application/vnd.openxmlformats-officedocument", "application/vnd.oasis.opendocument",
+    "application/epub+zip", "application/x-lzip", "application/x-lzma"
+};
+
+
+Zipper::Zipper(const QString &archive_path)
+{
+    zip.setZipName(archive_path);
+
+    // ZIP64 headers lift the 4 GB limit per file and per archive
+    zip.setZip64Enabled(true);
+
+    if(!zip.open(QuaZip::mdCreate))
+    {
+        qWarning("Zipper(): zip.open(): %d", zip.getZipError());
+    }
+}
+
+
+void Zipper::zipFileList(const QStringList &file_path_list, const QStringList &mime_types)
+{
+
+    if(!zip.isOpen())
+        return;
+
+    int counter = 0;
+
+    // unreadable files are left out instead of ending up as broken entries
+    QList<QFileInfo> files;
+    QList<Block> blocks;
+    QStringList skipped_paths;
+
+    for(qsizetype i = 0; i < file_path_list.size(); ++i)
+    {
+        const QString &file_path = file_path_list.at(i);
+
+        QFile in_file(file_path);
+        if(!in_file.open(QIODevice::ReadOnly))
+        {
+            qWarning("Failed to open file for reading: %s", qPrintable(file_path));
+            skipped_paths.append(file_path);
+            emit fileFinished(++counter);
+            continue;
+        }
+
+        const qint64 file_size = in_file.size();
+        const int file_index = int(files.size());
+        const bool store = !isCompressible(in_file, mime_types.value(i));
+        files.append(QFileInfo(file_path));
+
+        qint64 offset = 0;
+        do
+        {
+            Block block;
+            block.file_index = file_index;
+            block.offset = offset;
+            block.length = qMin(BLOCK_SIZE, file_size - offset);
+            block.last = offset + block.length >= file_size;
+            block.store = store;
+            blocks.append(block);
+
+            offset += block.length;
+        } while(offset < file_size);
+    }
+
+    // a bounded window of blocks is compressed ahead of the writer
+    const int max_pending = 2 * qMax(1, QThread::idealThreadCount());
+    QQueue<QFuture<CompressedBlock>> pending;
+    qsizetype next_block = 0;
+
+    // the blocks of an entry are held back until its last block is read, so a file that fails
+    // to read is left out. Once a larger entry is being written, a read failure fails the archive.
+    qint64 entry_size = 0;
+    quint32 entry_crc = 0;
+    QList<QByteArray> held_back;
+    qint64 held_back_size = 0;
+    bool entry_open = false;
+    bool entry_skipped = false;
+    QString failed_path;
+
+    for(qsizetype i = 0; i < blocks.size() && failed_path.isEmpty(); ++i)
+    {
+        while(next_block < blocks.size() && pending.size() < max_pending)
+        {
+            const Block &block = blocks.at(next_block++);
+            pending.enqueue(QtConcurrent::run(&Zipper::compressBlock, files.at(block.file_index).filePath(), block));
+        }
+
+        const Block &block = blocks.at(i);
+        const CompressedBlock compressed = pending.dequeue().result();
+        const QFileInfo &file_info = files.at(block.file_index);
+
+        if(block.offset == 0)
+        {
+            entry_size = 0;
+            entry_crc = crc32(0, Z_NULL, 0);
+            held_back.clear();
+            held_back_size = 0;
+            entry_open = false;
+            entry_skipped = false;
+        }
+
+        if(!entry_skipped && !compressed.ok)
+        {
+            qWarning("addFile(): compressBlock(): %s", qPrintable(file_info.filePath()));
+
+            if(entry_open)
+            {
+                failed_path = file_info.filePath();
+                break;
+            }
+
+            skipped_paths.append(file_info.filePath());
+            held_back.clear();
+            entry_skipped = true;
+        }
+
+        if(entry_skipped)
+        {
+            if(block.last)
+                emit fileFinished(++counter);
+            continue;
+        }
+
+        entry_crc = quint32(crc32_combine(entry_crc, compressed.crc, z_off_t(block.length)));
+        entry_size += block.length;
+
+        held_back.append(compressed.data);
+        held_back_size += compressed.data.size();
+
+        if(!block.last && held_back_size < MAX_HELD_BACK)
+            continue;
+
+        if(!entry_open && !openEntry(file_info, block.store))
+        {
+            qWarning("addFile(): zipOpenNewFileInZip4_64(): %s", qPrintable(file_info.filePath()));
+            failed_path = file_info.filePath();
+            break;
+        }
+        entry_open = true;
+
+        for(const QByteArray &data : held_back)
+        {
+            if(zipWriteInFileInZip(zip.getZipFile(), data.constData(), unsigned(data.size())) != ZIP_OK)
+            {
+                qWarning("addFile(): zipWriteInFileInZip(): %s", qPrintable(file_info.filePath()));
+                failed_path = file_info.filePath();
+                break;
+            }
+        }
+        held_back.clear();
+        held_back_size = 0;
+
+        if(block.last && failed_path.isEmpty())
+        {
+            if(!closeEntry(entry_size, entry_crc))
+            {
+                qWarning("addFile(): zipCloseFileInZipRaw64(): %s", qPrintable(file_info.filePath()));
+                failed_path = file_info.filePath();
+                break;
+            }
+
+            emit fileFinished(++counter);
+        }
+    }
+
+    // a broken entry would fail the whole archive for unzip, nothing is kept of it
+    if(!failed_path.isEmpty())
+    {
+        for(QFuture<CompressedBlock> &future : pending)
+            future.waitForFinished();
+
+        zip.close();
+        QFile::remove(zip.getZipName());
+
+        emit zippingFailed(failed_path);
+        emit zippingFinished();
+        return;
+    }
+
+    if(!skipped_paths.isEmpty())
+        emit filesSkipped(skipped_paths);
+
+    close();
+}
+
+
+// reads the block together with up to 32 KB in front of it, which primes the deflate window
+Zipper::CompressedBlock Zipper::compressBlock(const QString &file_path, const Block &block)
+{
+    CompressedBlock compressed;
+
+    QFile file(file_path);
+    if(!file.open(QIODevice::ReadOnly))
+        return compressed;
+
+    const qint64 dictionary_size = block.store ? 0 : qMin(block.offset, DICTIONARY_SIZE);
+    if(!file.seek(block.offset - dictionary_size))
+        return compressed;
+
+    const QByteArray input = file.read(dictionary_size + block.length);
+    if(input.size() != dictionary_size + block.length)
+        return compressed;
+
+    const Bytef *data = reinterpret_cast<const Bytef *>(input.constData()) + dictionary_size;
+
+    compressed.crc = quint32(crc32(0, data, uInt(block.length)));
+
+    // stored blocks go into the archive as they were read
+    if(block.store)
+    {
+        compressed.data = input;
+        compressed.ok = true;
+        return compressed;
+    }
+
+    z_stream stream = {};
+    if(deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return compressed;
+
+    if(dictionary_size > 0)
+        deflateSetDictionary(&stream, reinterpret_cast<const Bytef *>(input.constData()), uInt(dictionary_size));
+
+    // the bound covers Z_FINISH, a sync flush adds an empty stored block of at most 5 bytes
+    compressed.data.resize(qsizetype(deflateBound(&stream, uLong(block.length))) + 16);
+
+    stream.next_in = const_cast<Bytef *>(data);
+    stream.avail_in = uInt(block.length);
+    stream.next_out = reinterpret_cast<Bytef *>(compressed.data.data());
+    stream.avail_out = uInt(compressed.data.size());
+
+    const int result = deflate(&stream, block.last ? Z_FINISH : Z_SYNC_FLUSH);
+    compressed.ok = stream.avail_in == 0 && (block.last ? result == Z_STREAM_END : result == Z_OK);
+    compressed.data.resize(compressed.data.size() - qsizetype(stream.avail_out));
+
+    deflateEnd(&stream);
+
+    return compressed;
+}
+
+
+// known compressed formats are stored, anything else unless its first 64 KB look random
+bool Zipper::isCompressible(QFile &file, const QString &mime_type)
+{
+    for(const char *stored_type : STORED_MIME_TYPES)
+    {
+        if(mime_type.startsWith(QLatin1String(stored_type)))
+            return false;
+    }
+
+    const QByteArray sample = file.read(SAMPLE_SIZE);
+    if(sample.size() < 1024)
+        return true;
+
+    quint64 counts[256] = {};
+    for(const char byte : sample)
+        ++counts[uchar(byte)];
+
+    double entropy = 0.0;
+    for(const quint64 count : counts)
+    {
+        if(count == 0)
+            continue;
+
+        const double probability = double(count) / double(sample.size());
+        entropy -= probability * std::log2(probability);
+    }
+
+    return entropy < STORE_ENTROPY;
+}
+
+
+// entries are written raw, the blocks are already deflated or stored and crc and size are known at close
+bool Zipper::openEntry(const QFileInfo &file_info, bool store)
+{
+    zip_fileinfo info = {};
+
+    const QDateTime modified = file_info.lastModified();
+    info.tmz_date.tm_sec = uInt(modified.time().second());
+    info.tmz_date.tm_min = uInt(modified.time().minute());
+    info.tmz_date.tm_hour = uInt(modified.time().hour());
+    info.tmz_date.tm_mday = uInt(modified.date().day());
+    info.tmz_date.tm_mon = uInt(modified.date().month() - 1);
+    info.tmz_date.tm_year = uInt(modified.date().year());
+
+    const QByteArray file_name = file_info.fileName().toUtf8();
+
+    return zipOpenNewFileInZip4_64(zip.getZipFile(), file_name.constData(), &info,
+                                   nullptr, 0, nullptr, 0, nullptr,
+                                   store ? 0 : Z_DEFLATED, store ? 0 : Z_DEFAULT_COMPRESSION, 1,
+                                   -MAX_WBITS, 8, Z_DEFAULT_STRATEGY,
+                                   nullptr, 0, 0, UTF8_FILE_NAMES, 1) == ZIP_OK;
+}
+
+
+bool Zipper::closeEntry(qint64 size, quint32 crc)
+{
+    return zipCloseFileInZipRaw64(zip.getZipFile(), ZPOS64_T(size), uLong(crc)) == ZIP_OK;
+}
+
+
+void Zipper::close()
+{
+    zip.close();
+    if(zip.getZipError() != UNZ_OK)
+    {
+        qWarning("Zipper(): zip.close(): %d", zip.getZipError());
+    }
+
+    emit zippingFinished();
+}
@@ -1,31 +1,67 @@
-#ifndef ZIPPER_H
-#define ZIPPER_H
-
-#include <quazip/quazip.h>
-#include <QObject>
-
-
-class Zipper : public QObject
-{
-    Q_OBJECT
-
-public:
-    explicit Zipper(const QString &archive_path);
-
-signals:
-    void startZipping(const QStringList &file_path_list);
-
-    void fileFinished(int counter);
-
-    void zippingFinished();
-
-public slots:
-    void zipFileList(const QStringList &file_path_list);
-
-    void close();
-
-private:
-    QuaZip zip;
-};
-
-#endif // ZIPPER_H
+#ifndef ZIPPER_H
+#define ZIPPER_H
+
+#include <quazip/quazip.h>
+#include <QByteArray>
+#include <QFileInfo>
+#include <QObject>
+
+
+// Writes a standard deflate zip archive. Files are cut into blocks that are compressed on
+// the thread pool, pigz style: every block is primed with the last 32 KB before it and ends
+// on a byte boundary, so the blocks of an entry form one deflate stream. A single writer
+// appends the compressed blocks in order as raw entry data. Files that are compressed
+// already (by MIME type or a high entropy sample) are stored instead of deflated. Files that
+// can't be read are left out and reported.
+class Zipper : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Zipper(const QString &archive_path);
+
+signals:
+    void startZipping(const QStringList &file_path_list, const QStringList &mime_types);
+
+    void fileFinished(int counter);
+
+    // files that couldn't be read completely and were left out of the archive
+    void filesSkipped(const QStringList &file_paths);
+    // an entry couldn't be written, or its file failed to read after part of it was written.
+    // The archive is removed
+    void zippingFailed(const QString &file_path);
+
+    void zippingFinished();
+
+public slots:
+    void zipFileList(const QStringList &file_path_list, const QStringList &mime_types);
+
+    void close();
+
+private:
+    struct Block
+    {
+        int file_index = 0;
+        qint64 offset = 0;
+        qint64 length = 0;
+        bool last = false;
+        bool store = false;
+    };
+
+    struct CompressedBlock
+    {
+        QByteArray data;
+        quint32 crc = 0;
+        bool ok = false;
+    };
+
+    static CompressedBlock compressBlock(const QString &file_path, const Block &block);
+    static bool isCompressible(QFile &file, const QString &mime_type);
+
+    bool openEntry(const QFileInfo &file_info, bool store);
+    bool closeEntry(qint64 size, quint32 crc);
+
+    QuaZip zip;
+};
+
+#endif // ZIPPER_H